@@ -0,0 +1,35 @@
+#include <Arduino.h>
+#include <ESPDate.h>
+#include <ESPScheduler.h>
+
+ESPDate date;
+ESPScheduler scheduler(date);
+
+void blink(void* userData) {
+  (void)userData;
+  Serial.println("[scheduler] every 250 ms (inline, fixed rate)");
+}
+
+void pollSensor(void* userData) {
+  (void)userData;
+  Serial.println("[scheduler] sensor poll, 5 s after the previous one finished");
+  delay(300);  // slow I/O does not make fixed-delay runs pile up
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(200);
+  Serial.println("ESPScheduler interval jobs example");
+  Serial.println("Interval jobs use the monotonic timer, so they run before SNTP sets the clock.");
+
+  scheduler.addJob(Schedule::everyMs(250), SchedulerJobMode::Inline, &blink, nullptr);
+  scheduler.addJob(Schedule::everyMs(5000, SchedulerIntervalMode::FixedDelay),
+                   SchedulerJobMode::WorkerTask,
+                   &pollSensor,
+                   nullptr);
+}
+
+void loop() {
+  scheduler.tick();  // inline interval resolution is bounded by how often tick() runs
+  delay(10);
+}
@@ -0,0 +1,47 @@
+#include <Arduino.h>
+#include <ESPDate.h>
+#include <ESPScheduler.h>
+
+ESPDate date;
+
+// Two dispatcher tasks serve every WorkerTask job, no matter how many are scheduled.
+ESPSchedulerConfig makeSchedulerConfig() {
+  ESPSchedulerConfig cfg{};
+  cfg.workerPoolSize = 2;
+  cfg.workerPoolTask.stackSize = 6 * 1024;
+  cfg.workerPoolTask.priority = 2;
+  return cfg;
+}
+
+ESPScheduler scheduler(date, makeSchedulerConfig());
+
+void sensorJob(void* userData) {
+  const int sensor = static_cast<int>(reinterpret_cast<intptr_t>(userData));
+  Serial.printf("[scheduler] sampling sensor %d\n", sensor);
+  vTaskDelay(pdMS_TO_TICKS(500));
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(200);
+  Serial.println("ESPScheduler worker pool example");
+  Serial.println("Configure SNTP/time zone so local matching works.");
+
+  // Twenty jobs share the pool instead of spawning twenty tasks.
+  for (int sensor = 0; sensor < 20; ++sensor) {
+    scheduler.addJob(
+        Schedule::custom(ScheduleField::every(5), ScheduleField::any(), ScheduleField::any(),
+                         ScheduleField::any(), ScheduleField::any()),
+        SchedulerJobMode::WorkerTask,
+        &sensorJob,
+        reinterpret_cast<void*>(static_cast<intptr_t>(sensor)));
+  }
+}
+
+void loop() {
+  scheduler.tick();  // frees finished worker metadata
+  Serial.printf("pool queue depth=%u peak=%u\n",
+                static_cast<unsigned>(scheduler.workerQueueDepth()),
+                static_cast<unsigned>(scheduler.workerQueueHighWater()));
+  vTaskDelay(pdMS_TO_TICKS(10000));
+}
@@ -1,3 +1,4 @@
 #pragma once
 
 #include "esp_scheduler/scheduler.h"
+#include "esp_scheduler/static_scheduler.h"
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Spots wall-clock discontinuities from one task's point of view. Every
+// observation pairs the wall clock with esp_timer time; wall-clock movement that
+// the monotonic clock does not account for is a step (SNTP correction, manual
+// set). Not thread-safe: the tick loop, each worker task and the pool own one.
+class SchedulerClockWatch {
+public:
+    // Seconds the wall clock moved beyond elapsed esp_timer time since the last
+    // observation: > 0 stepped forward, < 0 stepped back, 0 on the first call.
+    // The wall clock has whole-second resolution, so +-1 is ordinary jitter.
+    int64_t observe(int64_t nowUtcSeconds, int64_t nowUs) {
+        int64_t stepSeconds = 0;
+        if (m_started) {
+            const int64_t wallUs = (nowUtcSeconds - m_lastUtcSeconds) * 1000000;
+            stepSeconds = (wallUs - (nowUs - m_lastUs)) / 1000000;
+        }
+        m_started = true;
+        m_lastUtcSeconds = nowUtcSeconds;
+        m_lastUs = nowUs;
+        return stepSeconds;
+    }
+
+    // Forget the last observation, e.g. while the clock is invalid.
+    void reset() { m_started = false; }
+
+    // True when TZ differs from the previous call; the first call only records it.
+    bool timeZoneChanged();
+
+private:
+    static constexpr size_t kTzKeySize = 48;
+
+    int64_t m_lastUtcSeconds = 0;
+    int64_t m_lastUs = 0;
+    char m_tzKey[kTzKeySize] = {};
+    bool m_started = false;
+    bool m_tzKnown = false;
+};
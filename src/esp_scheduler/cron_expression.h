@@ -0,0 +1,290 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace cron_expression_detail {
+// Deliberately not constexpr: reaching it while evaluating CronExpression::compile()
+// in a constant expression turns a malformed cron string into a compile error.
+inline void cronExpressionIsInvalid() {}
+
+struct FieldSpec {
+    int min;
+    int max;
+    const char* names;  // three letters per value starting at min, or nullptr
+};
+
+constexpr FieldSpec kFields[5] = {
+    {0, 59, nullptr},
+    {0, 23, nullptr},
+    {1, 31, nullptr},
+    {1, 12, "JANFEBMARAPRMAYJUNJULAUGSEPOCTNOVDEC"},
+    {0, 7, "SUNMONTUEWEDTHUFRISAT"},  // 7 is Sunday as well
+};
+
+constexpr bool isSpace(char c) { return c == ' ' || c == '\t'; }
+constexpr bool isDigit(char c) { return c >= '0' && c <= '9'; }
+constexpr char toUpper(char c) { return (c >= 'a' && c <= 'z') ? static_cast<char>(c - 'a' + 'A') : c; }
+
+constexpr uint64_t rangeMask(int from, int to) {
+    const uint64_t upper = (to >= 63) ? ~static_cast<uint64_t>(0) : ((1ULL << (to + 1)) - 1);
+    const uint64_t lower = (from <= 0) ? 0 : ((1ULL << from) - 1);
+    return upper & ~lower;
+}
+
+// from, from + step, ... up to to; the pattern doubles per pass instead of setting bit by bit.
+constexpr uint64_t stepMask(int from, int to, int step) {
+    uint64_t mask = 1ULL << from;
+    for (int shift = step; shift < 64; shift *= 2) {
+        mask |= mask << shift;
+    }
+    return mask & rangeMask(from, to);
+}
+
+constexpr bool sameText(const char* a, size_t length, const char* b) {
+    size_t i = 0;
+    for (; i < length; ++i) {
+        if (b[i] == '\0' || toUpper(a[i]) != b[i]) {
+            return false;
+        }
+    }
+    return b[i] == '\0';
+}
+}  // namespace cron_expression_detail
+
+// Standard five-field cron expression ("minute hour day-of-month month day-of-week")
+// parsed into the bitmasks a Schedule uses. Fields accept `*`, `?` (day fields),
+// values, `a-b` ranges, `/step` on any of those, comma lists and three-letter
+// month/weekday names (JAN..DEC, SUN..SAT, case-insensitive); day-of-week 7 is
+// Sunday. @yearly, @annually, @monthly, @weekly, @daily, @midnight and @hourly
+// are accepted too. parse() never allocates and works both at run time and in
+// constant expressions; use ESP_SCHEDULER_CRON() to reject bad strings at compile time.
+class CronExpression {
+public:
+    static constexpr size_t kFieldCount = 5;
+
+    static constexpr CronExpression parse(const char* text) {
+        size_t length = 0;
+        while (text && text[length] != '\0') {
+            ++length;
+        }
+        return parse(text, length);
+    }
+
+    // For buffers that are not NUL-terminated, e.g. a payload received from a server.
+    static constexpr CronExpression parse(const char* text, size_t length) {
+        CronExpression expr;
+        if (!text) {
+            return expr;
+        }
+        Cursor cursor{text, length, 0};
+        cursor.skipSpaces();
+        if (cursor.pos < length && text[cursor.pos] == '@') {
+            return parseMacro(text + cursor.pos, length - cursor.pos, cursor.pos);
+        }
+        for (size_t field = 0; field < kFieldCount; ++field) {
+            if (field > 0) {
+                if (cursor.pos < length && !cursor.atSpace()) {
+                    expr.m_errorOffset = cursor.pos;
+                    return expr;
+                }
+                cursor.skipSpaces();
+            }
+            if (!expr.parseField(cursor, field)) {
+                expr.m_errorOffset = cursor.pos;
+                return expr;
+            }
+        }
+        cursor.skipSpaces();
+        if (cursor.pos != length) {
+            expr.m_errorOffset = cursor.pos;
+            return expr;
+        }
+        expr.m_valid = true;
+        expr.m_errorOffset = 0;
+        return expr;
+    }
+
+    // Same as parse(), but an invalid expression evaluated as a constant
+    // expression (constexpr variable, ESP_SCHEDULER_CRON) fails to compile.
+    static constexpr CronExpression compile(const char* text) {
+        const CronExpression expr = parse(text);
+        if (!expr.m_valid) {
+            cron_expression_detail::cronExpressionIsInvalid();
+        }
+        return expr;
+    }
+
+    constexpr bool valid() const { return m_valid; }
+    // Character offset at which parsing stopped; meaningful only when !valid().
+    constexpr size_t errorOffset() const { return m_errorOffset; }
+
+    // Fields in cron order: 0 minute, 1 hour, 2 day of month, 3 month, 4 day of week.
+    constexpr uint64_t fieldMask(size_t field) const { return field < kFieldCount ? m_masks[field] : 0; }
+    constexpr bool fieldIsAny(size_t field) const { return field < kFieldCount && m_any[field]; }
+
+private:
+    struct Cursor {
+        const char* text;
+        size_t length;
+        size_t pos;
+
+        constexpr bool done() const { return pos >= length; }
+        constexpr char peek() const { return pos < length ? text[pos] : '\0'; }
+        constexpr bool atSpace() const { return cron_expression_detail::isSpace(peek()); }
+        constexpr void skipSpaces() {
+            while (pos < length && cron_expression_detail::isSpace(text[pos])) {
+                ++pos;
+            }
+        }
+    };
+
+    static constexpr CronExpression parseMacro(const char* text, size_t length, size_t offset) {
+        size_t word = 0;
+        while (word < length && !cron_expression_detail::isSpace(text[word])) {
+            ++word;
+        }
+        size_t rest = word;
+        while (rest < length && cron_expression_detail::isSpace(text[rest])) {
+            ++rest;
+        }
+        const char* expansion = nullptr;
+        if (rest == length) {
+            using cron_expression_detail::sameText;
+            if (sameText(text, word, "@YEARLY") || sameText(text, word, "@ANNUALLY")) {
+                expansion = "0 0 1 1 *";
+            } else if (sameText(text, word, "@MONTHLY")) {
+                expansion = "0 0 1 * *";
+            } else if (sameText(text, word, "@WEEKLY")) {
+                expansion = "0 0 * * 0";
+            } else if (sameText(text, word, "@DAILY") || sameText(text, word, "@MIDNIGHT")) {
+                expansion = "0 0 * * *";
+            } else if (sameText(text, word, "@HOURLY")) {
+                expansion = "0 * * * *";
+            }
+        }
+        if (!expansion) {
+            CronExpression expr;
+            expr.m_errorOffset = offset;
+            return expr;
+        }
+        return parse(expansion);
+    }
+
+    // Reads a number or, for month and weekday, a three-letter name.
+    static constexpr bool parseValue(Cursor& cursor, size_t field, int& value) {
+        const cron_expression_detail::FieldSpec& spec = cron_expression_detail::kFields[field];
+        if (cron_expression_detail::isDigit(cursor.peek())) {
+            value = 0;
+            size_t digits = 0;
+            while (cron_expression_detail::isDigit(cursor.peek())) {
+                if (++digits > 2) {
+                    return false;
+                }
+                value = value * 10 + (cursor.peek() - '0');
+                ++cursor.pos;
+            }
+        } else if (spec.names && cursor.pos + 3 <= cursor.length) {
+            const int nameCount = (field == 4) ? 7 : (spec.max - spec.min + 1);
+            int match = -1;
+            for (int i = 0; i < nameCount && match < 0; ++i) {
+                const char* name = spec.names + i * 3;
+                bool same = true;
+                for (size_t c = 0; c < 3; ++c) {
+                    if (cron_expression_detail::toUpper(cursor.text[cursor.pos + c]) != name[c]) {
+                        same = false;
+                    }
+                }
+                if (same) {
+                    match = i;
+                }
+            }
+            if (match < 0) {
+                return false;
+            }
+            value = spec.min + match;
+            cursor.pos += 3;
+        } else {
+            return false;
+        }
+        return value >= spec.min && value <= spec.max;
+    }
+
+    constexpr bool parseField(Cursor& cursor, size_t field) {
+        const cron_expression_detail::FieldSpec& spec = cron_expression_detail::kFields[field];
+        uint64_t mask = 0;
+        bool any = false;
+        for (;;) {
+            int from = spec.min;
+            int to = spec.max;
+            bool wildcard = false;
+            const char c = cursor.peek();
+            if (c == '*' || (c == '?' && (field == 2 || field == 4))) {
+                wildcard = true;
+                ++cursor.pos;
+            } else {
+                if (!parseValue(cursor, field, from)) {
+                    return false;
+                }
+                to = from;
+                if (cursor.peek() == '-') {
+                    ++cursor.pos;
+                    if (!parseValue(cursor, field, to) || to < from) {
+                        return false;
+                    }
+                }
+            }
+            if (cursor.peek() == '/') {
+                ++cursor.pos;
+                int step = 0;
+                size_t digits = 0;
+                while (cron_expression_detail::isDigit(cursor.peek())) {
+                    if (++digits > 2) {
+                        return false;
+                    }
+                    step = step * 10 + (cursor.peek() - '0');
+                    ++cursor.pos;
+                }
+                if (step <= 0) {
+                    return false;
+                }
+                if (!wildcard && from == to) {
+                    to = spec.max;  // "5/15" means 5-max/15
+                }
+                mask |= cron_expression_detail::stepMask(from, to, step);
+            } else if (wildcard) {
+                any = true;
+            } else {
+                mask |= cron_expression_detail::rangeMask(from, to);
+            }
+            if (cursor.peek() != ',') {
+                break;
+            }
+            ++cursor.pos;
+        }
+        if (!cursor.done() && !cursor.atSpace()) {
+            return false;
+        }
+        if (field == 4 && (mask & (1ULL << 7))) {
+            mask = (mask & ~(1ULL << 7)) | 1ULL;
+        }
+        m_masks[field] = any ? 0 : mask;
+        m_any[field] = any;
+        return true;
+    }
+
+    uint64_t m_masks[kFieldCount]{};
+    bool m_any[kFieldCount]{};
+    bool m_valid = false;
+    size_t m_errorOffset = 0;
+};
+
+// Schedule built from a cron string checked by the compiler:
+//   static const Schedule kWorkHours = ESP_SCHEDULER_CRON("*/15 9-17 * * MON-FRI");
+// A malformed string stops the build with "call to non-constexpr function
+// cronExpressionIsInvalid()".
+#define ESP_SCHEDULER_CRON(text)                                                       \
+    Schedule::cron([] {                                                                \
+        constexpr CronExpression espSchedulerCronExpr = CronExpression::compile(text); \
+        return espSchedulerCronExpr;                                                   \
+    }())
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <ESPDate.h>
+
+#include <atomic>
+#include <cstdint>
+
+// Per-job run statistics. Set to 0 to compile the counters and the timestamps
+// taken around every callback out of the scheduler; getJobStats() then reports zeros.
+#ifndef ESP_SCHEDULER_ENABLE_STATS
+#define ESP_SCHEDULER_ENABLE_STATS 1
+#endif
+
+struct JobStats {
+    uint32_t runCount = 0;
+    // Runs that ended with the job's following deadline already passed.
+    uint32_t overruns = 0;
+    // Deadlines that passed without a run of their own (fixed-rate catch-up, or
+    // folded into a pool run that was still waiting for a dispatcher).
+    uint32_t missedSlots = 0;
+    uint32_t lastDurationUs = 0;
+    uint32_t maxDurationUs = 0;
+    uint32_t meanDurationUs = 0;
+    // Callback start minus deadline, in esp_timer microseconds. Calendar deadlines
+    // are whole seconds, so their lateness includes the sub-second part of the tick.
+    // Triggered runs are measured from the moment they are dispatched.
+    int64_t lastLatenessUs = 0;
+    int64_t maxLatenessUs = 0;
+    DateTime lastRunUtc{};  // wall clock when the last run started; epoch 0 before the first
+};
+
+// Accumulates JobStats for one job. Only one task writes at a time (the tick task,
+// the job's worker task, or a pool dispatcher holding the pool lock), so plain
+// load/store pairs suffice; the atomics let other tasks read without tearing.
+class JobStatsRecorder {
+public:
+    static constexpr bool kEnabled = ESP_SCHEDULER_ENABLE_STATS != 0;
+
+#if ESP_SCHEDULER_ENABLE_STATS
+    JobStatsRecorder() = default;
+    // Copyable so job records can live in vectors; copies are made by the owning task.
+    JobStatsRecorder(const JobStatsRecorder& other) { copyFrom(other); }
+    JobStatsRecorder& operator=(const JobStatsRecorder& other) {
+        if (this != &other) {
+            copyFrom(other);
+        }
+        return *this;
+    }
+
+    void recordRun(int64_t startUs, int64_t endUs, int64_t latenessUs, int64_t startEpochSeconds) {
+        const uint32_t durationUs = static_cast<uint32_t>(endUs > startUs ? endUs - startUs : 0);
+        const uint32_t runs = m_runCount.load(std::memory_order_relaxed) + 1;
+        m_runCount.store(runs, std::memory_order_relaxed);
+        m_lastDurationUs.store(durationUs, std::memory_order_relaxed);
+        if (durationUs > m_maxDurationUs.load(std::memory_order_relaxed)) {
+            m_maxDurationUs.store(durationUs, std::memory_order_relaxed);
+        }
+        m_totalDurationUs.store(m_totalDurationUs.load(std::memory_order_relaxed) + durationUs,
+                                std::memory_order_relaxed);
+        m_lastLatenessUs.store(latenessUs, std::memory_order_relaxed);
+        if (runs == 1 || latenessUs > m_maxLatenessUs.load(std::memory_order_relaxed)) {
+            m_maxLatenessUs.store(latenessUs, std::memory_order_relaxed);
+        }
+        m_lastRunEpochSeconds.store(startEpochSeconds, std::memory_order_relaxed);
+    }
+
+    void recordOverrun() { m_overruns.store(m_overruns.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed); }
+
+    void recordMissed(uint32_t slots) {
+        m_missedSlots.store(m_missedSlots.load(std::memory_order_relaxed) + slots, std::memory_order_relaxed);
+    }
+
+    void read(JobStats& out) const {
+        out.runCount = m_runCount.load(std::memory_order_relaxed);
+        out.overruns = m_overruns.load(std::memory_order_relaxed);
+        out.missedSlots = m_missedSlots.load(std::memory_order_relaxed);
+        out.lastDurationUs = m_lastDurationUs.load(std::memory_order_relaxed);
+        out.maxDurationUs = m_maxDurationUs.load(std::memory_order_relaxed);
+        out.meanDurationUs =
+            out.runCount ? static_cast<uint32_t>(m_totalDurationUs.load(std::memory_order_relaxed) / out.runCount) : 0;
+        out.lastLatenessUs = m_lastLatenessUs.load(std::memory_order_relaxed);
+        out.maxLatenessUs = m_maxLatenessUs.load(std::memory_order_relaxed);
+        out.lastRunUtc = DateTime{};
+        out.lastRunUtc.epochSeconds = m_lastRunEpochSeconds.load(std::memory_order_relaxed);
+    }
+
+    void reset() {
+        m_runCount.store(0, std::memory_order_relaxed);
+        m_overruns.store(0, std::memory_order_relaxed);
+        m_missedSlots.store(0, std::memory_order_relaxed);
+        m_lastDurationUs.store(0, std::memory_order_relaxed);
+        m_maxDurationUs.store(0, std::memory_order_relaxed);
+        m_totalDurationUs.store(0, std::memory_order_relaxed);
+        m_lastLatenessUs.store(0, std::memory_order_relaxed);
+        m_maxLatenessUs.store(0, std::memory_order_relaxed);
+        m_lastRunEpochSeconds.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    void copyFrom(const JobStatsRecorder& other) {
+        m_runCount.store(other.m_runCount.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        m_overruns.store(other.m_overruns.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        m_missedSlots.store(other.m_missedSlots.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        m_lastDurationUs.store(other.m_lastDurationUs.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        m_maxDurationUs.store(other.m_maxDurationUs.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        m_totalDurationUs.store(other.m_totalDurationUs.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        m_lastLatenessUs.store(other.m_lastLatenessUs.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        m_maxLatenessUs.store(other.m_maxLatenessUs.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        m_lastRunEpochSeconds.store(other.m_lastRunEpochSeconds.load(std::memory_order_relaxed),
+                                    std::memory_order_relaxed);
+    }
+
+    std::atomic<uint32_t> m_runCount{0};
+    std::atomic<uint32_t> m_overruns{0};
+    std::atomic<uint32_t> m_missedSlots{0};
+    std::atomic<uint32_t> m_lastDurationUs{0};
+    std::atomic<uint32_t> m_maxDurationUs{0};
+    std::atomic<uint64_t> m_totalDurationUs{0};
+    std::atomic<int64_t> m_lastLatenessUs{0};
+    std::atomic<int64_t> m_maxLatenessUs{0};
+    std::atomic<int64_t> m_lastRunEpochSeconds{0};
+#else
+    void recordRun(int64_t, int64_t, int64_t, int64_t) {}
+    void recordOverrun() {}
+    void recordMissed(uint32_t) {}
+    void read(JobStats& out) const { out = JobStats{}; }
+    void reset() {}
+#endif
+};
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Remembers the UTC offset of one local day, including the DST transition that
+// falls inside it (if any), so next-occurrence searches only go through the
+// libc TZ rules when they leave that day. Not thread-safe: every thread that
+// evaluates schedules (tick loop, worker task, pool dispatcher) owns its own.
+class SchedulerLocalTimeCache {
+public:
+    // Local time minus UTC, in seconds, at the given instant.
+    int64_t offsetAt(int64_t utcSeconds);
+    // Drop the cached day if the TZ environment changed since the last call.
+    void revalidate();
+    void invalidate() {
+        m_valid = false;
+        ++m_generation;
+    }
+    // Changes whenever the TZ rules behind offsetAt() may have changed, so results
+    // derived from them (see ESPScheduler::OccurrenceCache) know to start over.
+    uint32_t generation() const { return m_generation; }
+
+private:
+    static constexpr size_t kTzKeySize = 48;
+
+    void load(int64_t utcSeconds);
+
+    // [m_dayStartUtc, m_dayEndUtc) covers one local day; the offset switches from
+    // m_offsetBefore to m_offsetAfter at m_transitionUtc (== m_dayEndUtc if none).
+    int64_t m_dayStartUtc = 0;
+    int64_t m_dayEndUtc = 0;
+    int64_t m_transitionUtc = 0;
+    int64_t m_offsetBefore = 0;
+    int64_t m_offsetAfter = 0;
+    uint32_t m_generation = 0;
+    char m_tzKey[kTzKeySize] = {};
+    bool m_valid = false;
+    bool m_tzKnown = false;
+};
@@ -1,641 +1,3515 @@
 #include "esp_scheduler/scheduler.h"
 
 #include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
 #include <new>
 #include <utility>
 
 extern "C" {
 #include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 #include "freertos/task.h"
 }
 
+#include "esp_timer.h"
+
 namespace {
-constexpr int64_t kMaxSearchMinutes = 366 * 24 * 60;
+// Horizon for recurring searches. Eight years always contains a leap day, so
+// Feb 29 schedules resolve instead of being dropped as "never".
+constexpr int kMaxSearchYears = 8;
+constexpr int64_t kSecondsPerMinute = 60;
+constexpr int64_t kSecondsPerHour = 60 * kSecondsPerMinute;
+constexpr int64_t kSecondsPerDay = 24 * kSecondsPerHour;
 constexpr int64_t kWorkerSleepChunkSeconds = 60;
+constexpr size_t kNoHeapPos = static_cast<size_t>(-1);
+
+// Block the calling task until notified or until the timeout (rounded up to
+// whole ticks and clamped to the longest finite FreeRTOS wait) expires.
+void waitForWakeMs(int64_t timeoutMs) {
+    constexpr int64_t kMaxWaitTicks = static_cast<int64_t>(portMAX_DELAY - 1);
+    if (timeoutMs < 0) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        return;
+    }
+    int64_t ticks = (timeoutMs * configTICK_RATE_HZ + 999) / 1000;
+    if (ticks > kMaxWaitTicks) {
+        ticks = kMaxWaitTicks;
+    }
+    ulTaskNotifyTake(pdTRUE, static_cast<TickType_t>(ticks));
+}
+
+// Negative waits until notified.
+void waitForWake(int64_t timeoutSeconds) {
+    waitForWakeMs(timeoutSeconds < 0 ? -1 : timeoutSeconds * 1000);
+}
 
 bool clockValidForMin(const DateTime& nowUtc, int64_t minValidEpochSeconds) {
     return nowUtc.epochSeconds >= minValidEpochSeconds;
 }
 
-bool computeNextOccurrenceForDate(const ESPDate& date,
-                                  const Schedule& schedule,
-                                  const DateTime& fromUtc,
-                                  DateTime& outNextUtc) {
-    if (schedule.isOneShot) {
-        outNextUtc = schedule.onceAtUtc;
-        return true;
+DateTime dateTimeFromEpoch(int64_t epochSeconds) {
+    DateTime dt{};
+    dt.epochSeconds = epochSeconds;
+    return dt;
+}
+
+int64_t intervalPeriodUs(const Schedule& schedule) {
+    return static_cast<int64_t>(schedule.intervalMs) * 1000;
+}
+
+// Next esp_timer deadline of an interval schedule after a run that was due at
+// previousDueUs and returned at nowUs.
+int64_t nextIntervalDueUs(const Schedule& schedule, int64_t previousDueUs, int64_t nowUs, uint32_t* skipped = nullptr) {
+    const int64_t periodUs = intervalPeriodUs(schedule);
+    if (schedule.intervalMode == SchedulerIntervalMode::FixedDelay) {
+        return nowUs + periodUs;
+    }
+    int64_t next = previousDueUs + periodUs;
+    if (next <= nowUs) {
+        const int64_t missed = (nowUs - next) / periodUs + 1;
+        next += missed * periodUs;
+        if (skipped) {
+            *skipped = static_cast<uint32_t>(missed);
+        }
     }
+    return next;
+}
 
-    DateTime rounded = fromUtc;
-    if (fromUtc.secondUtc() > 0) {
-        rounded = date.addMinutes(rounded, 1);
+// esp_timer timestamp for JobStats; compiles to nothing when stats are disabled.
+int64_t statsClockUs() {
+    if constexpr (JobStatsRecorder::kEnabled) {
+        return esp_timer_get_time();
+    } else {
+        return 0;
     }
-    rounded = date.setTimeOfDayUtc(rounded, rounded.hourUtc(), rounded.minuteUtc(), 0);
+}
 
-    DateTime cursor = rounded;
-    for (int64_t i = 0; i < kMaxSearchMinutes; ++i) {
-        const int month = date.getMonthLocal(cursor);
-        const int day = date.getDayLocal(cursor);
-        const int dow = date.getWeekdayLocal(cursor);
+void traceEvent(const std::shared_ptr<SchedulerTrace>& trace,
+                SchedulerTraceEvent event,
+                uint32_t jobId,
+                int64_t value = 0,
+                uint8_t detail = 0) {
+    if (trace) {
+        trace->record(event, jobId, value, detail);
+    }
+}
 
-        const DateTime startOfDay = date.startOfDayLocal(cursor);
-        const int64_t minutesIntoDay = date.differenceInMinutes(cursor, startOfDay);
-        if (minutesIntoDay < 0) {
-            cursor = date.addMinutes(cursor, 1);
-            continue;
-        }
-        const int hour = static_cast<int>(minutesIntoDay / 60);
-        const int minute = static_cast<int>(minutesIntoDay % 60);
-
-        const bool monthOk = schedule.month.matches(month);
-        const bool hourOk = schedule.hour.matches(hour);
-        const bool minuteOk = schedule.minute.matches(minute);
-
-        const bool domAny = schedule.dayOfMonth.isAny();
-        const bool dowAny = schedule.dayOfWeek.isAny();
-        const bool domOk = schedule.dayOfMonth.matches(day);
-        const bool dowOk = schedule.dayOfWeek.matches(dow);
-
-        bool dayOk = false;
-        if (domAny && dowAny) {
-            dayOk = true;
-        } else if (domAny && !dowAny) {
-            dayOk = dowOk;
-        } else if (!domAny && dowAny) {
-            dayOk = domOk;
-        } else {
-            dayOk = domOk || dowOk;
-        }
+uint8_t traceRunner(SchedulerTraceRunner runner, bool triggered = false) {
+    return static_cast<uint8_t>(static_cast<uint8_t>(runner) |
+                                (triggered ? static_cast<uint8_t>(SchedulerTraceRunner::Triggered) : 0));
+}
 
-        if (monthOk && hourOk && minuteOk && dayOk) {
-            outNextUtc = date.setTimeOfDayLocal(cursor, hour, minute, 0);
-            return true;
-        }
-        cursor = date.addMinutes(cursor, 1);
+// Dispatch record for a run that was due at dueUs on the esp_timer clock.
+void traceDispatch(const std::shared_ptr<SchedulerTrace>& trace, uint32_t jobId, SchedulerTraceRunner runner,
+                   int64_t dueUs) {
+    if (trace) {
+        trace->record(SchedulerTraceEvent::Dispatch, jobId, esp_timer_get_time() - dueUs, traceRunner(runner));
     }
-    return false;
 }
-}  // namespace
 
-ScheduleField ScheduleField::any() {
-    ScheduleField f;
-    f.m_isAny = true;
-    f.m_mask = 0;
-    return f;
+void traceTriggered(const std::shared_ptr<SchedulerTrace>& trace, uint32_t jobId, SchedulerTraceRunner runner) {
+    traceEvent(trace, SchedulerTraceEvent::Dispatch, jobId, 0, traceRunner(runner, true));
 }
 
-ScheduleField ScheduleField::only(int value) {
-    ScheduleField f;
-    if (value < 0 || value > 63) {
-        return f;
+void traceCalendarReschedule(const std::shared_ptr<SchedulerTrace>& trace,
+                             uint32_t jobId,
+                             bool hasNext,
+                             const DateTime& nextUtc,
+                             const DateTime& nowUtc) {
+    if (trace) {
+        trace->record(SchedulerTraceEvent::Rescheduled,
+                      jobId,
+                      hasNext ? nextUtc.epochSeconds - nowUtc.epochSeconds : 0,
+                      static_cast<uint8_t>(hasNext ? SchedulerTraceReschedule::Seconds : SchedulerTraceReschedule::Done));
     }
-    f.m_mask = 1ULL << value;
-    return f;
 }
 
-ScheduleField ScheduleField::range(int from, int to) {
-    ScheduleField f;
-    if (from < 0 || to < 0 || from > to || to > 63) {
-        return f;
-    }
-    for (int i = from; i <= to; ++i) {
-        f.m_mask |= 1ULL << i;
+void traceIntervalReschedule(const std::shared_ptr<SchedulerTrace>& trace, uint32_t jobId, int64_t nextDueUs) {
+    if (trace) {
+        trace->record(SchedulerTraceEvent::Rescheduled,
+                      jobId,
+                      nextDueUs - esp_timer_get_time(),
+                      static_cast<uint8_t>(SchedulerTraceReschedule::Microseconds));
     }
-    return f;
 }
 
-ScheduleField ScheduleField::every(int step) {
-    ScheduleField f;
-    if (step <= 0) {
-        return f;
-    }
-    for (int i = 0; i <= 63; i += step) {
-        f.m_mask |= 1ULL << i;
+void recordIntervalRun(JobStatsRecorder& stats, uint32_t skipped) {
+    if (skipped > 0) {
+        stats.recordOverrun();
+        stats.recordMissed(skipped);
     }
-    return f;
 }
 
-ScheduleField ScheduleField::rangeEvery(int from, int to, int step) {
-    ScheduleField f;
-    if (step <= 0 || from < 0 || to < 0 || from > to || to > 63) {
-        return f;
-    }
-    for (int i = from; i <= to; i += step) {
-        f.m_mask |= 1ULL << i;
-    }
-    return f;
+// Wall-clock estimate of a monotonic deadline, for JobInfo.
+DateTime intervalDueToUtc(int64_t dueUs, const DateTime& nowUtc) {
+    const int64_t untilDueUs = dueUs - esp_timer_get_time();
+    const int64_t untilDueSeconds = untilDueUs <= 0 ? 0 : (untilDueUs + 999999) / 1000000;
+    return dateTimeFromEpoch(nowUtc.epochSeconds + untilDueSeconds);
 }
 
-ScheduleField ScheduleField::list(const int* values, size_t count) {
-    ScheduleField f;
-    if (!values || count == 0) {
-        return f;
-    }
-    for (size_t i = 0; i < count; ++i) {
-        const int v = values[i];
-        if (v < 0 || v > 63) {
-            f.m_mask = 0;
-            return f;
-        }
-        f.m_mask |= 1ULL << v;
+int64_t floorDiv(int64_t value, int64_t divisor) {
+    int64_t q = value / divisor;
+    if ((value % divisor) != 0 && ((value < 0) != (divisor < 0))) {
+        --q;
     }
-    return f;
+    return q;
 }
 
-bool ScheduleField::matches(int value) const {
-    if (m_isAny) {
-        return true;
-    }
-    if (value < 0 || value > 63) {
-        return false;
-    }
-    return (m_mask & (1ULL << value)) != 0;
+// Proleptic Gregorian day count relative to 1970-01-01 (H. Hinnant's algorithm).
+int64_t daysFromCivil(int64_t year, int month, int day) {
+    year -= month <= 2 ? 1 : 0;
+    const int64_t era = floorDiv(year, 400);
+    const int64_t yoe = year - era * 400;
+    const int64_t mp = month > 2 ? month - 3 : month + 9;
+    const int64_t doy = (153 * mp + 2) / 5 + day - 1;
+    const int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
 }
 
-Schedule Schedule::onceUtc(const DateTime& whenUtc) {
-    Schedule s;
-    s.isOneShot = true;
-    s.onceAtUtc = whenUtc;
-    return s;
+bool isLeapYear(int year) {
+    return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
 }
 
-Schedule Schedule::dailyAtLocal(int hour, int minute) {
-    Schedule s;
-    s.hour = ScheduleField::only(hour);
-    s.minute = ScheduleField::only(minute);
-    s.dayOfMonth = ScheduleField::any();
-    s.month = ScheduleField::any();
-    s.dayOfWeek = ScheduleField::any();
-    return s;
+int daysInMonth(int year, int month) {
+    static constexpr int kDays[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    return (month == 2 && isLeapYear(year)) ? 29 : kDays[month - 1];
 }
 
-Schedule Schedule::weeklyAtLocal(uint8_t dowMask, int hour, int minute) {
-    int days[7];
-    size_t count = 0;
-    for (int i = 0; i < 7; ++i) {
-        if (dowMask & (1 << i)) {
-            days[count++] = i;
-        }
-    }
-    Schedule s;
-    s.hour = ScheduleField::only(hour);
-    s.minute = ScheduleField::only(minute);
-    s.dayOfMonth = ScheduleField::any();
-    s.month = ScheduleField::any();
-    if (count == 0) {
-        s.dayOfWeek = ScheduleField::any();
-    } else {
-        s.dayOfWeek = ScheduleField::list(days, count);
-    }
-    return s;
+// 0=Sun..6=Sat, matching ESPDate::getWeekdayLocal(). 1970-01-01 was a Thursday.
+int weekdayFromDays(int64_t days) {
+    const int64_t weekday = (days + 4) % 7;
+    return static_cast<int>(weekday < 0 ? weekday + 7 : weekday);
 }
 
-Schedule Schedule::monthlyOnDayLocal(int dayOfMonth, int hour, int minute) {
-    Schedule s;
-    int clamped = dayOfMonth;
-    if (clamped < 1) {
-        clamped = 1;
-    } else if (clamped > 31) {
-        clamped = 31;
-    }
-    s.dayOfMonth = ScheduleField::only(clamped);
-    s.hour = ScheduleField::only(hour);
-    s.minute = ScheduleField::only(minute);
-    s.month = ScheduleField::any();
-    s.dayOfWeek = ScheduleField::any();
-    return s;
+// Broken-down local wall-clock time at minute resolution.
+struct LocalFields {
+    int year = 1970;
+    int month = 1;
+    int day = 1;
+    int hour = 0;
+    int minute = 0;
+};
+
+int64_t localSecondsOf(const LocalFields& f) {
+    return daysFromCivil(f.year, f.month, f.day) * kSecondsPerDay + f.hour * kSecondsPerHour +
+           f.minute * kSecondsPerMinute;
 }
 
-Schedule Schedule::custom(const ScheduleField& minute,
-                          const ScheduleField& hour,
-                          const ScheduleField& dom,
-                          const ScheduleField& month,
-                          const ScheduleField& dow) {
-    Schedule s;
-    s.minute = minute;
-    s.hour = hour;
-    s.dayOfMonth = dom;
-    s.month = month;
-    s.dayOfWeek = dow;
-    return s;
+void civilFromDays(int64_t days, int& year, int& month, int& day) {
+    days += 719468;
+    const int64_t era = floorDiv(days, 146097);
+    const int64_t doe = days - era * 146097;
+    const int64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const int64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const int64_t mp = (5 * doy + 2) / 153;
+    day = static_cast<int>(doy - (153 * mp + 2) / 5 + 1);
+    month = static_cast<int>(mp < 10 ? mp + 3 : mp - 9);
+    year = static_cast<int>(yoe + era * 400 + (month <= 2 ? 1 : 0));
 }
 
-ESPScheduler::ESPScheduler(ESPDate& date, ESPWorker* worker)
-    : ESPScheduler(date, worker, ESPSchedulerConfig{}) {}
+// ESPDate resolves local time through the libc TZ rules; we use the same
+// primitive directly, and only when SchedulerLocalTimeCache misses.
+int64_t libcUtcOffsetAt(int64_t utcSeconds) {
+    const time_t t = static_cast<time_t>(utcSeconds);
+    struct tm tmLocal {};
+    localtime_r(&t, &tmLocal);
+    LocalFields f;
+    f.year = tmLocal.tm_year + 1900;
+    f.month = tmLocal.tm_mon + 1;
+    f.day = tmLocal.tm_mday;
+    f.hour = tmLocal.tm_hour;
+    f.minute = tmLocal.tm_min;
+    return localSecondsOf(f) + tmLocal.tm_sec - utcSeconds;
+}
 
-ESPScheduler::ESPScheduler(ESPDate& date, const ESPSchedulerConfig& config)
-    : ESPScheduler(date, nullptr, config) {}
+LocalFields toLocalFields(int64_t utcSeconds, SchedulerLocalTimeCache& localTime, int64_t& outOffsetSeconds) {
+    outOffsetSeconds = localTime.offsetAt(utcSeconds);
+    const int64_t local = utcSeconds + outOffsetSeconds;
+    const int64_t days = floorDiv(local, kSecondsPerDay);
+    const int64_t secondOfDay = local - days * kSecondsPerDay;
+    LocalFields f;
+    civilFromDays(days, f.year, f.month, f.day);
+    f.hour = static_cast<int>(secondOfDay / kSecondsPerHour);
+    f.minute = static_cast<int>((secondOfDay % kSecondsPerHour) / kSecondsPerMinute);
+    return f;
+}
 
-ESPScheduler::ESPScheduler(ESPDate& date, ESPWorker* worker, const ESPSchedulerConfig& config)
-    : m_date(date),
-      m_minValidEpochSecondsRef(std::make_shared<std::atomic<int64_t>>(kDefaultMinValidEpochSeconds)),
-      usePSRAMBuffers_(config.usePSRAMBuffers),
-      m_inlineJobs(SchedulerAllocator<InlineJob>(usePSRAMBuffers_)),
-      m_workerJobs(SchedulerAllocator<WorkerJob>(usePSRAMBuffers_)) {
-    (void)worker;
+// Map local wall-clock fields back to a UTC instant. Repeated (fall-back) times
+// resolve to the instant nearest the hint offset, so a job fires once per
+// wall-clock match rather than once in each hour. Skipped (spring-forward) times
+// resolve to the instant after the gap, the same normalization
+// ESPDate::setTimeOfDayLocal() applies.
+int64_t localFieldsToUtc(const LocalFields& f, int64_t hintOffsetSeconds, SchedulerLocalTimeCache& localTime) {
+    const int64_t local = localSecondsOf(f);
+    const int64_t first = local - hintOffsetSeconds;
+    const int64_t firstOffset = localTime.offsetAt(first);
+    if (firstOffset == hintOffsetSeconds) {
+        return first;
+    }
+    const int64_t second = local - firstOffset;
+    if (localTime.offsetAt(second) == firstOffset) {
+        return second;
+    }
+    return first > second ? first : second;
 }
 
-ESPScheduler::~ESPScheduler() {
-    deinit();
+uint64_t fieldMask(const ScheduleField& field) {
+    return field.isAny() ? ~static_cast<uint64_t>(0) : field.rawMask();
 }
 
-void ESPScheduler::deinit() {
-    if (!m_initialized.exchange(false, std::memory_order_relaxed)) {
-        return;
+// Smallest value in [from, to] whose bit is set in mask, or -1.
+int nextInMask(uint64_t mask, int from, int to) {
+    if (from > to || from > 63) {
+        return -1;
+    }
+    uint64_t window = mask >> from;
+    const int width = to - from + 1;
+    if (width < 64) {
+        window &= (static_cast<uint64_t>(1) << width) - 1;
+    }
+    if (window == 0) {
+        return -1;
+    }
+    return from + __builtin_ctzll(window);
+}
+
+// First day >= fromDay in the month that satisfies the cron DOM/DOW rule: when
+// both fields are restricted either may match, otherwise only the restricted one counts.
+int nextMatchingDay(const Schedule& schedule, int year, int month, int fromDay) {
+    const int lastDay = daysInMonth(year, month);
+    if (fromDay > lastDay) {
+        return -1;
+    }
+    const bool domAny = schedule.dayOfMonth.isAny();
+    const bool dowAny = schedule.dayOfWeek.isAny();
+    if (domAny && dowAny) {
+        return fromDay;
     }
 
-    for (auto& job : m_inlineJobs) {
-        job.finished = true;
+    int domNext = -1;
+    if (!domAny) {
+        domNext = nextInMask(schedule.dayOfMonth.rawMask(), fromDay, lastDay);
     }
-    for (auto& job : m_workerJobs) {
-        if (job.context) {
-            job.context->cancelRequested.store(true);
+    int dowNext = -1;
+    if (!dowAny) {
+        const uint64_t dowMask = schedule.dayOfWeek.rawMask();
+        const int startDow = weekdayFromDays(daysFromCivil(year, month, fromDay));
+        for (int offset = 0; offset < 7 && fromDay + offset <= lastDay; ++offset) {
+            if (dowMask & (static_cast<uint64_t>(1) << ((startDow + offset) % 7))) {
+                dowNext = fromDay + offset;
+                break;
+            }
         }
     }
-    cleanupInline();
-    m_workerJobs.clear();
 
-    SchedulerVector<InlineJob>(SchedulerAllocator<InlineJob>(usePSRAMBuffers_)).swap(m_inlineJobs);
-    SchedulerVector<WorkerJob>(SchedulerAllocator<WorkerJob>(usePSRAMBuffers_)).swap(m_workerJobs);
-    m_nextId = 1;
+    if (domNext < 0) {
+        return dowNext;
+    }
+    if (dowNext < 0) {
+        return domNext;
+    }
+    return domNext < dowNext ? domNext : dowNext;
 }
 
-bool ESPScheduler::isInitialized() const {
-    return m_initialized.load(std::memory_order_relaxed);
+void advanceMonth(LocalFields& f) {
+    f.day = 1;
+    f.hour = 0;
+    f.minute = 0;
+    if (++f.month > 12) {
+        f.month = 1;
+        ++f.year;
+    }
 }
 
-void ESPScheduler::ensureInitialized() {
-    if (!isInitialized()) {
-        m_initialized.store(true, std::memory_order_relaxed);
+void advanceDay(LocalFields& f) {
+    f.hour = 0;
+    f.minute = 0;
+    if (++f.day > daysInMonth(f.year, f.month)) {
+        advanceMonth(f);
     }
 }
 
-void ESPScheduler::setMinValidUnixSeconds(int64_t minEpochSeconds) {
-    m_minValidEpochSeconds = minEpochSeconds;
-    if (m_minValidEpochSecondsRef) {
-        m_minValidEpochSecondsRef->store(minEpochSeconds);
+void advanceHour(LocalFields& f) {
+    f.minute = 0;
+    if (++f.hour > 23) {
+        advanceDay(f);
     }
 }
 
-void ESPScheduler::setMinValidUtc(const DateTime& minUtc) {
-    setMinValidUnixSeconds(minUtc.epochSeconds);
+void advanceMinute(LocalFields& f) {
+    if (++f.minute > 59) {
+        advanceHour(f);
+    }
 }
 
-int64_t ESPScheduler::minValidUnixSeconds() const {
-    return m_minValidEpochSeconds;
-}
+// Field-skipping search: instead of stepping minute by minute, jump straight to
+// the next allowed month, then day, then hour, then minute using the field masks.
+// Starts at local fields `cursor` (UTC offset `offset`) and leaves the match in it.
+bool searchOccurrence(const Schedule& schedule,
+                      LocalFields& cursor,
+                      int64_t offset,
+                      int64_t startUtc,
+                      SchedulerLocalTimeCache& localTime,
+                      int64_t& outUtc) {
+    const int lastYear = cursor.year + kMaxSearchYears;
+    const uint64_t monthMask = fieldMask(schedule.month);
+    const uint64_t hourMask = fieldMask(schedule.hour);
+    const uint64_t minuteMask = fieldMask(schedule.minute);
+
+    while (cursor.year <= lastYear) {
+        const int month = nextInMask(monthMask, cursor.month, 12);
+        if (month < 0) {
+            cursor.month = 12;
+            advanceMonth(cursor);
+            continue;
+        }
+        if (month != cursor.month) {
+            cursor.month = month;
+            cursor.day = 1;
+            cursor.hour = 0;
+            cursor.minute = 0;
+        }
+
+        const int day = nextMatchingDay(schedule, cursor.year, cursor.month, cursor.day);
+        if (day < 0) {
+            advanceMonth(cursor);
+            continue;
+        }
+        if (day != cursor.day) {
+            cursor.day = day;
+            cursor.hour = 0;
+            cursor.minute = 0;
+        }
+
+        const int hour = nextInMask(hourMask, cursor.hour, 23);
+        if (hour < 0) {
+            advanceDay(cursor);
+            continue;
+        }
+        if (hour != cursor.hour) {
+            cursor.hour = hour;
+            cursor.minute = 0;
+        }
+
+        const int minute = nextInMask(minuteMask, cursor.minute, 59);
+        if (minute < 0) {
+            advanceHour(cursor);
+            continue;
+        }
+        cursor.minute = minute;
 
-uint32_t ESPScheduler::nextId() {
-    if (m_nextId == 0) {
-        m_nextId = 1;
+        const int64_t candidateUtc = localFieldsToUtc(cursor, offset, localTime);
+        if (candidateUtc >= startUtc) {
+            outUtc = candidateUtc;
+            return true;
+        }
+        advanceMinute(cursor);
     }
-    return m_nextId++;
+    return false;
 }
 
-bool ESPScheduler::fieldWithinRange(const ScheduleField& field, int min, int max) const {
-    if (field.isAny()) {
-        return true;
-    }
-    const uint64_t mask = field.rawMask();
-    const uint64_t allowed = allowedMask(min, max);
-    return mask != 0 && (mask & allowed) != 0;
+int64_t ceilToMinute(int64_t utcSeconds) {
+    return (floorDiv(utcSeconds - 1, kSecondsPerMinute) + 1) * kSecondsPerMinute;
 }
 
-uint64_t ESPScheduler::allowedMask(int min, int max) const {
-    if (min < 0) {
-        min = 0;
-    }
-    if (max > 63) {
-        max = 63;
+// Step a cursor to its next occurrence. After a match the search resumes from the
+// stored local fields plus one minute, unless the UTC offset moved underneath them
+// (DST), in which case the fields are re-derived from the UTC instant. Both paths
+// give the same answer as a fresh search from the previous occurrence + 1 minute.
+// Calendar occurrences come out splayOffset seconds late (see JobOptions::splaySeconds).
+bool advanceScheduleCursor(const Schedule& schedule,
+                           uint32_t splayOffset,
+                           ScheduleCursor& state,
+                           SchedulerLocalTimeCache& localTime,
+                           DateTime& outNextUtc) {
+    if (state.exhausted) {
+        return false;
     }
-    if (max >= 63) {
-        return ~static_cast<uint64_t>(0);
+    if (schedule.isOnDemand) {
+        state.exhausted = true;
+        return false;
     }
-    const uint64_t upper = (1ULL << (max + 1)) - 1;
-    const uint64_t lower = (min == 0) ? 0 : ((1ULL << min) - 1);
-    return upper & ~lower;
-}
-
-bool ESPScheduler::validateSchedule(const Schedule& schedule) const {
     if (schedule.isOneShot) {
+        if (state.started) {
+            state.exhausted = true;
+            return false;
+        }
+        state.started = true;
+        state.lastUtc = schedule.onceAtUtc.epochSeconds;
+        outNextUtc = schedule.onceAtUtc;
         return true;
     }
-    const bool minuteOk = fieldWithinRange(schedule.minute, 0, 59);
-    const bool hourOk = fieldWithinRange(schedule.hour, 0, 23);
-    const bool domOk = fieldWithinRange(schedule.dayOfMonth, 1, 31);
-    const bool monthOk = fieldWithinRange(schedule.month, 1, 12);
-    const bool dowOk = fieldWithinRange(schedule.dayOfWeek, 0, 6);
-    return minuteOk && hourOk && domOk && monthOk && dowOk;
+    if (schedule.isInterval()) {
+        ++state.steps;
+        const int64_t elapsedMs = static_cast<int64_t>(state.steps) * schedule.intervalMs;
+        state.started = true;
+        state.lastUtc = state.fromUtc + (elapsedMs + 999) / 1000;
+        outNextUtc = dateTimeFromEpoch(state.lastUtc);
+        return true;
+    }
+
+    const int64_t splay = splayOffset;
+    int64_t startUtc = 0;
+    int64_t offset = 0;
+    LocalFields cursor;
+    if (state.started) {
+        startUtc = ceilToMinute(state.lastUtc + kSecondsPerMinute);
+        offset = localTime.offsetAt(startUtc);
+        cursor.year = state.year;
+        cursor.month = state.month;
+        cursor.day = state.day;
+        cursor.hour = state.hour;
+        cursor.minute = state.minute;
+        if (localSecondsOf(cursor) + kSecondsPerMinute == startUtc + offset) {
+            advanceMinute(cursor);
+        } else {
+            cursor = toLocalFields(startUtc, localTime, offset);
+        }
+    } else {
+        // Splayed runs trail their occurrence, so one up to splay seconds before fromUtc still counts.
+        startUtc = ceilToMinute(state.fromUtc - splay);
+        cursor = toLocalFields(startUtc, localTime, offset);
+    }
+
+    int64_t nextUtc = 0;
+    if (!searchOccurrence(schedule, cursor, offset, startUtc, localTime, nextUtc)) {
+        state.exhausted = true;
+        return false;
+    }
+    state.started = true;
+    state.lastUtc = nextUtc;
+    state.year = cursor.year;
+    state.month = static_cast<int8_t>(cursor.month);
+    state.day = static_cast<int8_t>(cursor.day);
+    state.hour = static_cast<int8_t>(cursor.hour);
+    state.minute = static_cast<int8_t>(cursor.minute);
+    outNextUtc = dateTimeFromEpoch(nextUtc + splay);
+    return true;
 }
 
-uint32_t ESPScheduler::addJobOnceUtc(const DateTime& whenUtc,
-                                     SchedulerJobMode mode,
-                                     SchedulerCallback cb,
-                                     void* userData,
-                                     const SchedulerTaskConfig* taskCfg) {
-    return addJobOnceUtc(whenUtc, mode, SchedulerFunction(cb), userData, taskCfg);
+bool computeNextOccurrenceForSchedule(const Schedule& schedule,
+                                      uint32_t splayOffset,
+                                      const DateTime& fromUtc,
+                                      SchedulerLocalTimeCache& localTime,
+                                      DateTime& outNextUtc) {
+    ScheduleCursor state = ScheduleCursor::startingAt(fromUtc);
+    return advanceScheduleCursor(schedule, splayOffset, state, localTime, outNextUtc);
 }
 
-uint32_t ESPScheduler::addJobOnceUtc(const DateTime& whenUtc,
-                                     SchedulerJobMode mode,
-                                     SchedulerFunction cb,
-                                     void* userData,
-                                     const SchedulerTaskConfig* taskCfg) {
+// A backward clock step up to this size resumes searches from where the clock had
+// got to, so occurrences that already ran are not repeated (as cron does).
+constexpr int64_t kClockStepReplayGuardSeconds = 3 * kSecondsPerHour;
+
+// After a clock change, deadlines at or before this instant stay as they are (the
+// misfire policy handles them); later ones become the first occurrence after it.
+int64_t rescheduleAfterUtc(int64_t nowUtc, int64_t stepSeconds) {
+    if (stepSeconds < 0 && -stepSeconds <= kClockStepReplayGuardSeconds) {
+        return nowUtc - stepSeconds;
+    }
+    return nowUtc;
+}
+
+// Outcome of applying a job's misfire policy to the occurrence in nextRunUtc.
+struct MisfireDecision {
+    uint32_t runs = 1;       // callback invocations owed right now
+    uint32_t missed = 0;     // occurrences dropped (counted up to kMisfireScanLimit)
+    bool movedOn = false;    // cursor and nextRunUtc already point past now
+    bool hasNext = true;     // valid when movedOn
+};
+
+// Missed occurrences counted one by one before the search simply restarts from now.
+constexpr uint32_t kMisfireScanLimit = 1024;
+
+// Decide how to handle a due occurrence. Within the threshold, and for CatchUp,
+// nothing changes: the caller runs it once and advances the cursor as usual.
+// Otherwise the cursor is moved to the first occurrence after nowUtc here.
+MisfireDecision resolveMisfire(const Schedule& schedule,
+                               const JobOptions& options,
+                               ScheduleCursor& cursor,
+                               SchedulerLocalTimeCache& localTime,
+                               DateTime& nextRunUtc,
+                               const DateTime& nowUtc) {
+    MisfireDecision decision;
+    const int64_t lateSeconds = nowUtc.epochSeconds - nextRunUtc.epochSeconds;
+    if (schedule.isInterval() || options.misfirePolicy == SchedulerMisfirePolicy::CatchUp ||
+        lateSeconds <= static_cast<int64_t>(options.misfireThresholdSeconds)) {
+        return decision;
+    }
+    if (schedule.isOneShot) {
+        if (options.misfirePolicy == SchedulerMisfirePolicy::Skip) {
+            decision.runs = 0;
+            decision.missed = 1;
+            decision.movedOn = true;
+            decision.hasNext = false;
+        }
+        return decision;
+    }
+
+    const uint32_t splay = options.splayOffsetFor(schedule);
+    uint32_t owed = 1;
+    DateTime next = nextRunUtc;
+    bool hasNext = advanceScheduleCursor(schedule, splay, cursor, localTime, next);
+    while (hasNext && next.epochSeconds <= nowUtc.epochSeconds) {
+        if (owed == kMisfireScanLimit) {
+            cursor = ScheduleCursor::startingAt(dateTimeFromEpoch(nowUtc.epochSeconds + 1));
+            hasNext = advanceScheduleCursor(schedule, splay, cursor, localTime, next);
+            break;
+        }
+        ++owed;
+        hasNext = advanceScheduleCursor(schedule, splay, cursor, localTime, next);
+    }
+    nextRunUtc = next;
+    decision.movedOn = true;
+    decision.hasNext = hasNext;
+    switch (options.misfirePolicy) {
+        case SchedulerMisfirePolicy::Coalesce:
+            decision.runs = owed < options.misfireMaxRuns ? owed : options.misfireMaxRuns;
+            if (decision.runs == 0) {
+                decision.runs = 1;
+            }
+            break;
+        case SchedulerMisfirePolicy::Skip:
+            decision.runs = 0;
+            break;
+        default:
+            decision.runs = 1;
+            break;
+    }
+    decision.missed = owed - decision.runs;
+    return decision;
+}
+
+// Intrusive binary min-heap of shared items keyed on T::poolDue.
+// Each item remembers its slot in T::poolHeapPos so removal and re-keying are O(log n).
+template <typename T>
+class DeadlineHeap {
+public:
+    using Item = std::shared_ptr<T>;
+
+    explicit DeadlineHeap(bool usePSRAMBuffers) : m_items(SchedulerAllocator<Item>(usePSRAMBuffers)) {}
+
+    bool empty() const { return m_items.empty(); }
+    const Item& top() const { return m_items.front(); }
+    bool contains(const T& item) const { return item.poolHeapPos != kNoHeapPos; }
+
+    void push(const Item& item, int64_t due) {
+        item->poolDue = due;
+        m_items.push_back(item);
+        siftUp(m_items.size() - 1);
+    }
+
+    Item pop() {
+        Item item = m_items.front();
+        remove(*item);
+        return item;
+    }
+
+    void remove(T& item) {
+        const size_t pos = item.poolHeapPos;
+        if (pos == kNoHeapPos) {
+            return;
+        }
+        item.poolHeapPos = kNoHeapPos;
+        const size_t last = m_items.size() - 1;
+        if (pos != last) {
+            m_items[pos] = std::move(m_items[last]);
+            m_items[pos]->poolHeapPos = pos;
+        }
+        m_items.pop_back();
+        if (pos < m_items.size()) {
+            T* moved = m_items[pos].get();
+            siftUp(pos);
+            siftDown(moved->poolHeapPos);
+        }
+    }
+
+    void clear() {
+        for (auto& item : m_items) {
+            item->poolHeapPos = kNoHeapPos;
+        }
+        m_items.clear();
+    }
+
+    // Give every item the key dueFor(item) returns, then restore heap order in O(n).
+    template <typename DueFn>
+    void rekeyAll(DueFn dueFor) {
+        for (auto& item : m_items) {
+            item->poolDue = dueFor(*item);
+        }
+        for (size_t pos = m_items.size() / 2; pos-- > 0;) {
+            siftDown(pos);
+        }
+    }
+
+private:
+    void place(size_t pos, Item item) {
+        item->poolHeapPos = pos;
+        m_items[pos] = std::move(item);
+    }
+
+    void siftUp(size_t pos) {
+        Item item = std::move(m_items[pos]);
+        while (pos > 0) {
+            const size_t parent = (pos - 1) / 2;
+            if (m_items[parent]->poolDue <= item->poolDue) {
+                break;
+            }
+            place(pos, std::move(m_items[parent]));
+            pos = parent;
+        }
+        place(pos, std::move(item));
+    }
+
+    void siftDown(size_t pos) {
+        Item item = std::move(m_items[pos]);
+        const size_t count = m_items.size();
+        while (true) {
+            size_t child = pos * 2 + 1;
+            if (child >= count) {
+                break;
+            }
+            if (child + 1 < count &&
+                m_items[child + 1]->poolDue < m_items[child]->poolDue) {
+                ++child;
+            }
+            if (item->poolDue <= m_items[child]->poolDue) {
+                break;
+            }
+            place(pos, std::move(m_items[child]));
+            pos = child;
+        }
+        place(pos, std::move(item));
+    }
+
+    SchedulerVector<Item> m_items;
+};
+
+// Snapshot wire format, little-endian on every host. The header names the format
+// and the TZ the stored deadlines were computed under; the key list tells
+// loadSnapshot() which records exist, since NVS cannot enumerate blobs.
+constexpr uint32_t kSnapshotMagic = 0x4E535345;  // "ESSN"
+constexpr uint16_t kSnapshotVersion = 1;
+constexpr size_t kSnapshotRecordSize = 64;
+constexpr size_t kSnapshotHeaderSize = 24;
+constexpr size_t kSnapshotMaxKeys = 4096;  // sanity bound on a corrupted key count
+constexpr const char* kSnapshotHeaderName = "sched.hdr";
+constexpr const char* kSnapshotKeysName = "sched.keys";
+constexpr uint8_t kSnapshotCalendar = 0;
+constexpr uint8_t kSnapshotOneShot = 1;
+constexpr uint8_t kSnapshotInterval = 2;
+constexpr uint8_t kSnapshotOnDemand = 3;
+
+uint32_t snapshotCrc(const uint8_t* data, size_t size) {
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; ++i) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+        }
+    }
+    return ~crc;
+}
+
+void putLe(uint8_t* out, uint64_t value, size_t bytes) {
+    for (size_t i = 0; i < bytes; ++i) {
+        out[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+uint64_t getLe(const uint8_t* in, size_t bytes) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < bytes; ++i) {
+        value |= static_cast<uint64_t>(in[i]) << (8 * i);
+    }
+    return value;
+}
+
+// Record layout: key@0 flags@4 kind@5 anyFields@6 intervalMode@7 minuteMask@8
+// hourMask@16 dayOfMonthMask@20 monthMask@24 dayOfWeekMask@26 intervalMs@28
+// onceAtUtc@32 nextRunUtc@40 lastRunUtc@48 splayOffsetSeconds@56, CRC-32 of bytes 0..59 @60.
+uint32_t encodeSnapshotRecord(const SchedulerSnapshotRecord& record, uint8_t* out) {
+    std::memset(out, 0, kSnapshotRecordSize);
+    putLe(out + 0, record.key, 4);
+    out[4] = record.flags;
+    out[5] = record.kind;
+    out[6] = record.anyFields;
+    out[7] = record.intervalMode;
+    putLe(out + 8, record.minuteMask, 8);
+    putLe(out + 16, record.hourMask, 4);
+    putLe(out + 20, record.dayOfMonthMask, 4);
+    putLe(out + 24, record.monthMask, 2);
+    out[26] = record.dayOfWeekMask;
+    putLe(out + 28, record.intervalMs, 4);
+    putLe(out + 32, static_cast<uint64_t>(record.onceAtUtc), 8);
+    putLe(out + 40, static_cast<uint64_t>(record.nextRunUtc), 8);
+    putLe(out + 48, static_cast<uint64_t>(record.lastRunUtc), 8);
+    putLe(out + 56, record.splayOffsetSeconds, 4);
+    const uint32_t crc = snapshotCrc(out, kSnapshotRecordSize - 4);
+    putLe(out + 60, crc, 4);
+    return crc;
+}
+
+bool decodeSnapshotRecord(const uint8_t* in, SchedulerSnapshotRecord& record, uint32_t& crc) {
+    crc = static_cast<uint32_t>(getLe(in + 60, 4));
+    if (snapshotCrc(in, kSnapshotRecordSize - 4) != crc) {
+        return false;
+    }
+    record.key = static_cast<uint32_t>(getLe(in + 0, 4));
+    record.flags = in[4];
+    record.kind = in[5];
+    record.anyFields = in[6];
+    record.intervalMode = in[7];
+    record.minuteMask = getLe(in + 8, 8);
+    record.hourMask = static_cast<uint32_t>(getLe(in + 16, 4));
+    record.dayOfMonthMask = static_cast<uint32_t>(getLe(in + 20, 4));
+    record.monthMask = static_cast<uint16_t>(getLe(in + 24, 2));
+    record.dayOfWeekMask = in[26];
+    record.intervalMs = static_cast<uint32_t>(getLe(in + 28, 4));
+    record.onceAtUtc = static_cast<int64_t>(getLe(in + 32, 8));
+    record.nextRunUtc = static_cast<int64_t>(getLe(in + 40, 8));
+    record.lastRunUtc = static_cast<int64_t>(getLe(in + 48, 8));
+    record.splayOffsetSeconds = static_cast<uint32_t>(getLe(in + 56, 4));
+    return true;
+}
+
+void snapshotRecordName(uint32_t key, char (&out)[16]) {
+    std::snprintf(out, sizeof(out), "sched.%08lx", static_cast<unsigned long>(key));
+}
+
+// FNV-1a of TZ: stored deadlines are only reused under the rules they came from.
+uint32_t snapshotTimeZoneHash() {
+    const char* tz = std::getenv("TZ");
+    uint32_t hash = 2166136261u;
+    for (const char* c = tz ? tz : ""; *c; ++c) {
+        hash = (hash ^ static_cast<uint8_t>(*c)) * 16777619u;
+    }
+    return hash;
+}
+
+SchedulerSnapshotRecord packSchedule(const Schedule& schedule, const JobOptions& options, SchedulerJobMode mode) {
+    SchedulerSnapshotRecord record{};
+    record.key = options.persistKey;
+    record.flags = mode == SchedulerJobMode::WorkerTask ? SchedulerSnapshotRecord::kWorker : 0;
+    if (schedule.isInterval()) {
+        record.kind = kSnapshotInterval;
+        record.intervalMs = schedule.intervalMs;
+        record.intervalMode = static_cast<uint8_t>(schedule.intervalMode);
+        return record;
+    }
+    if (schedule.isOneShot) {
+        record.kind = kSnapshotOneShot;
+        record.onceAtUtc = schedule.onceAtUtc.epochSeconds;
+        return record;
+    }
+    if (schedule.isOnDemand) {
+        record.kind = kSnapshotOnDemand;
+        return record;
+    }
+    const ScheduleField* fields[] = {&schedule.minute, &schedule.hour, &schedule.dayOfMonth, &schedule.month,
+                                     &schedule.dayOfWeek};
+    for (size_t i = 0; i < 5; ++i) {
+        if (fields[i]->isAny()) {
+            record.anyFields |= static_cast<uint8_t>(1u << i);
+        }
+    }
+    record.kind = kSnapshotCalendar;
+    record.splayOffsetSeconds = options.splayOffsetFor(schedule);
+    record.minuteMask = schedule.minute.rawMask();
+    record.hourMask = static_cast<uint32_t>(schedule.hour.rawMask());
+    record.dayOfMonthMask = static_cast<uint32_t>(schedule.dayOfMonth.rawMask());
+    record.monthMask = static_cast<uint16_t>(schedule.month.rawMask());
+    record.dayOfWeekMask = static_cast<uint8_t>(schedule.dayOfWeek.rawMask());
+    return record;
+}
+
+// Same job as far as the snapshot can tell: mode and packed schedule agree.
+bool sameSnapshotJob(const SchedulerSnapshotRecord& a, const SchedulerSnapshotRecord& b) {
+    return ((a.flags ^ b.flags) & SchedulerSnapshotRecord::kWorker) == 0 && a.kind == b.kind &&
+           a.anyFields == b.anyFields && a.intervalMode == b.intervalMode && a.minuteMask == b.minuteMask &&
+           a.hourMask == b.hourMask && a.dayOfMonthMask == b.dayOfMonthMask && a.monthMask == b.monthMask &&
+           a.dayOfWeekMask == b.dayOfWeekMask && a.intervalMs == b.intervalMs && a.onceAtUtc == b.onceAtUtc &&
+           a.splayOffsetSeconds == b.splayOffsetSeconds;
+}
+
+// Cursor parked on a known occurrence: the next advance continues after it, and
+// re-derives the local fields itself because they are left unset here.
+ScheduleCursor resumeCursorAt(int64_t occurrenceUtc) {
+    ScheduleCursor cursor = ScheduleCursor::startingAt(dateTimeFromEpoch(occurrenceUtc));
+    cursor.started = true;
+    cursor.lastUtc = occurrenceUtc;
+    return cursor;
+}
+}  // namespace
+
+bool SchedulerClockWatch::timeZoneChanged() {
+    const char* tz = std::getenv("TZ");
+    if (!tz) {
+        tz = "";
+    }
+    const size_t length = std::strlen(tz);
+    const size_t stored = length < kTzKeySize ? length : kTzKeySize - 1;
+    const bool changed = m_tzKnown && (std::strncmp(m_tzKey, tz, stored) != 0 || m_tzKey[stored] != '\0');
+    std::memcpy(m_tzKey, tz, stored);
+    m_tzKey[stored] = '\0';
+    m_tzKnown = true;
+    return changed;
+}
+
+void SchedulerLocalTimeCache::revalidate() {
+    const char* tz = std::getenv("TZ");
+    if (!tz) {
+        tz = "";
+    }
+    const size_t length = std::strlen(tz);
+    if (length >= kTzKeySize) {
+        m_tzKnown = false;
+        invalidate();  // too long to remember; only reuse within one evaluation
+        return;
+    }
+    if (m_tzKnown && std::memcmp(m_tzKey, tz, length + 1) == 0) {
+        return;
+    }
+    std::memcpy(m_tzKey, tz, length + 1);
+    m_tzKnown = true;
+    invalidate();
+}
+
+int64_t SchedulerLocalTimeCache::offsetAt(int64_t utcSeconds) {
+    if (!m_valid || utcSeconds < m_dayStartUtc || utcSeconds >= m_dayEndUtc) {
+        load(utcSeconds);
+    }
+    return utcSeconds < m_transitionUtc ? m_offsetBefore : m_offsetAfter;
+}
+
+// Three libc conversions describe a whole local day; a day that contains a DST
+// transition costs a binary search for the exact switch instant on top.
+void SchedulerLocalTimeCache::load(int64_t utcSeconds) {
+    const int64_t offset = libcUtcOffsetAt(utcSeconds);
+    const int64_t localDayStart = floorDiv(utcSeconds + offset, kSecondsPerDay) * kSecondsPerDay;
+    const int64_t dayStartUtc = localDayStart - offset;
+    const int64_t dayEndUtc = dayStartUtc + kSecondsPerDay;
+    const int64_t startOffset = libcUtcOffsetAt(dayStartUtc);
+    const int64_t endOffset = libcUtcOffsetAt(dayEndUtc - 1);
+    m_valid = true;
+
+    if (startOffset == endOffset) {
+        if (startOffset != offset) {
+            // Two transitions inside one day; cache nothing beyond this second.
+            m_dayStartUtc = utcSeconds;
+            m_dayEndUtc = utcSeconds + 1;
+            m_transitionUtc = m_dayEndUtc;
+            m_offsetBefore = m_offsetAfter = offset;
+            return;
+        }
+        m_dayStartUtc = dayStartUtc;
+        m_dayEndUtc = dayEndUtc;
+        m_transitionUtc = dayEndUtc;
+        m_offsetBefore = m_offsetAfter = offset;
+        return;
+    }
+
+    // First instant carrying the end-of-day offset.
+    int64_t before = dayStartUtc;
+    int64_t after = dayEndUtc - 1;
+    while (after - before > 1) {
+        const int64_t mid = before + (after - before) / 2;
+        if (libcUtcOffsetAt(mid) == endOffset) {
+            after = mid;
+        } else {
+            before = mid;
+        }
+    }
+    m_dayStartUtc = dayStartUtc;
+    m_dayEndUtc = dayEndUtc;
+    m_transitionUtc = after;
+    m_offsetBefore = startOffset;
+    m_offsetAfter = endOffset;
+}
+
+bool ESPScheduler::OccurrenceCache::Key::operator==(const Key& other) const {
+    return minuteMask == other.minuteMask && hourMask == other.hourMask && dayOfMonthMask == other.dayOfMonthMask &&
+           monthMask == other.monthMask && dayOfWeekMask == other.dayOfWeekMask && anyDays == other.anyDays &&
+           splayOffset == other.splayOffset;
+}
+
+// "Any" minute, hour and month mean every value in range, so they intern with the
+// spelled-out list. Day of month and weekday keep their flags: a restricted one
+// combines with the other by OR, which a full mask would not reproduce.
+ESPScheduler::OccurrenceCache::Key ESPScheduler::OccurrenceCache::keyFor(const Schedule& schedule,
+                                                                    uint32_t splayOffset) {
+    Key key;
+    key.minuteMask = fieldMask(schedule.minute) & ((static_cast<uint64_t>(1) << 60) - 1);
+    key.hourMask = static_cast<uint32_t>(fieldMask(schedule.hour) & 0xFFFFFFu);
+    key.monthMask = static_cast<uint16_t>(fieldMask(schedule.month) & 0x1FFEu);
+    if (schedule.dayOfMonth.isAny()) {
+        key.anyDays |= 0x01;
+    } else {
+        key.dayOfMonthMask = static_cast<uint32_t>(schedule.dayOfMonth.rawMask());
+    }
+    if (schedule.dayOfWeek.isAny()) {
+        key.anyDays |= 0x02;
+    } else {
+        key.dayOfWeekMask = static_cast<uint8_t>(schedule.dayOfWeek.rawMask());
+    }
+    key.splayOffset = splayOffset;
+    return key;
+}
+
+size_t ESPScheduler::OccurrenceCache::slotFor(const Key& key) {
+    const uint64_t words[] = {key.minuteMask,
+                              (static_cast<uint64_t>(key.hourMask) << 32) | key.dayOfMonthMask,
+                              (static_cast<uint64_t>(key.monthMask) << 16) | (key.dayOfWeekMask << 8) | key.anyDays,
+                              key.splayOffset};
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    for (uint64_t word : words) {
+        hash = (hash ^ word) * 0x100000001B3ULL;
+    }
+    return static_cast<size_t>(hash ^ (hash >> 32)) % kEntries;
+}
+
+// The step from a given cursor position depends only on the interned schedule and
+// the TZ rules, so a hit hands back the stored result without searching.
+bool ESPScheduler::OccurrenceCache::advance(const Schedule& schedule,
+                                            uint32_t splayOffset,
+                                            ScheduleCursor& cursor,
+                                            SchedulerLocalTimeCache& localTime,
+                                            DateTime& outNextUtc) {
+    if (schedule.isOneShot || schedule.isOnDemand || schedule.isInterval() || cursor.exhausted) {
+        return advanceScheduleCursor(schedule, splayOffset, cursor, localTime, outNextUtc);
+    }
+    if (localTime.generation() != m_generation) {
+        for (Entry& entry : m_entries) {
+            entry.used = false;
+        }
+        m_generation = localTime.generation();
+    }
+    const Key key = keyFor(schedule, splayOffset);
+    const int64_t fromUtc = cursor.started ? cursor.lastUtc : cursor.fromUtc;
+    Entry& entry = m_entries[slotFor(key)];
+    if (!entry.used || entry.started != cursor.started || entry.fromUtc != fromUtc || !(entry.key == key)) {
+        entry.key = key;
+        entry.fromUtc = fromUtc;
+        entry.started = cursor.started;
+        entry.cursor = cursor;
+        entry.hasNext = advanceScheduleCursor(schedule, splayOffset, entry.cursor, localTime, entry.nextUtc);
+        entry.used = true;
+    }
+    cursor = entry.cursor;
+    if (entry.hasNext) {
+        outNextUtc = entry.nextUtc;
+    }
+    return entry.hasNext;
+}
+
+ESPScheduler::ScheduleTable::ScheduleTable(bool usePSRAMBuffers)
+    : m_usePSRAMBuffers(usePSRAMBuffers),
+      m_entries(SchedulerAllocator<Entry>(usePSRAMBuffers)),
+      m_buckets(SchedulerAllocator<uint32_t>(usePSRAMBuffers)) {}
+
+uint32_t ESPScheduler::ScheduleTable::hashOf(const Schedule& schedule) {
+    const ScheduleField* fields[] = {
+        &schedule.minute, &schedule.hour, &schedule.dayOfMonth, &schedule.month, &schedule.dayOfWeek};
+    uint64_t flags = (schedule.isOneShot ? 0x01u : 0u) | (schedule.isOnDemand ? 0x02u : 0u) |
+                     (static_cast<uint64_t>(schedule.intervalMode) << 8) |
+                     (static_cast<uint64_t>(schedule.intervalMs) << 32);
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    hash = (hash ^ flags) * 0x100000001B3ULL;
+    hash = (hash ^ static_cast<uint64_t>(schedule.onceAtUtc.epochSeconds)) * 0x100000001B3ULL;
+    for (size_t i = 0; i < 5; ++i) {
+        hash = (hash ^ fields[i]->rawMask() ^ (fields[i]->isAny() ? 1ULL << 63 : 0)) * 0x100000001B3ULL;
+    }
+    return static_cast<uint32_t>(hash ^ (hash >> 32));
+}
+
+// Exact, not canonical: getJobInfo() hands back the schedule the job was added with.
+bool ESPScheduler::ScheduleTable::sameSchedule(const Schedule& a, const Schedule& b) {
+    const auto sameField = [](const ScheduleField& x, const ScheduleField& y) {
+        return x.isAny() == y.isAny() && x.rawMask() == y.rawMask();
+    };
+    return a.isOneShot == b.isOneShot && a.onceAtUtc.epochSeconds == b.onceAtUtc.epochSeconds &&
+           a.isOnDemand == b.isOnDemand && a.intervalMs == b.intervalMs && a.intervalMode == b.intervalMode &&
+           sameField(a.minute, b.minute) && sameField(a.hour, b.hour) && sameField(a.dayOfMonth, b.dayOfMonth) &&
+           sameField(a.month, b.month) && sameField(a.dayOfWeek, b.dayOfWeek);
+}
+
+uint32_t ESPScheduler::ScheduleTable::acquire(const Schedule& schedule) {
+    const uint32_t hash = hashOf(schedule);
+    if (!m_buckets.empty()) {
+        uint32_t index = m_buckets[hash & (m_buckets.size() - 1)];
+        while (index != kNone) {
+            Entry& entry = m_entries[index];
+            if (entry.hash == hash && sameSchedule(entry.schedule, schedule)) {
+                ++entry.refs;
+                return index;
+            }
+            index = entry.next;
+        }
+    }
+    uint32_t index = m_freeHead;
+    if (index != kNone) {
+        m_freeHead = m_entries[index].next;
+    } else {
+        index = static_cast<uint32_t>(m_entries.size());
+        m_entries.emplace_back();
+        if (m_entries.size() > m_buckets.size()) {
+            rehash(m_buckets.empty() ? 8 : m_buckets.size() * 2);
+        }
+    }
+    Entry& entry = m_entries[index];
+    entry.schedule = schedule;
+    entry.hash = hash;
+    entry.refs = 1;
+    link(index);
+    return index;
+}
+
+void ESPScheduler::ScheduleTable::release(uint32_t index) {
+    Entry& entry = m_entries[index];
+    if (--entry.refs > 0) {
+        return;
+    }
+    uint32_t* link = &m_buckets[entry.hash & (m_buckets.size() - 1)];
+    while (*link != index) {
+        link = &m_entries[*link].next;
+    }
+    *link = entry.next;
+    entry.schedule = Schedule{};
+    entry.next = m_freeHead;
+    m_freeHead = index;
+}
+
+void ESPScheduler::ScheduleTable::reserve(size_t count) {
+    m_entries.reserve(count);
+    size_t buckets = 8;
+    while (buckets < count) {
+        buckets *= 2;
+    }
+    if (buckets > m_buckets.size()) {
+        rehash(buckets);
+    }
+}
+
+void ESPScheduler::ScheduleTable::clear() {
+    SchedulerVector<Entry>(SchedulerAllocator<Entry>(m_usePSRAMBuffers)).swap(m_entries);
+    SchedulerVector<uint32_t>(SchedulerAllocator<uint32_t>(m_usePSRAMBuffers)).swap(m_buckets);
+    m_freeHead = kNone;
+}
+
+// Free entries stay on the free list; only the ones in use are linked again.
+void ESPScheduler::ScheduleTable::rehash(size_t bucketCount) {
+    m_buckets.assign(bucketCount, kNone);
+    for (uint32_t index = 0; index < m_entries.size(); ++index) {
+        if (m_entries[index].refs > 0) {
+            link(index);
+        }
+    }
+}
+
+void ESPScheduler::ScheduleTable::link(uint32_t index) {
+    uint32_t& head = m_buckets[m_entries[index].hash & (m_buckets.size() - 1)];
+    m_entries[index].next = head;
+    head = index;
+}
+
+// Shared dispatcher state for pool-mode WorkerTask jobs. Dispatcher tasks hold
+// their own reference, so the pool outlives the scheduler while a callback runs.
+struct ESPScheduler::WorkerPool {
+    explicit WorkerPool(bool usePSRAMBuffers)
+        : deadlines(usePSRAMBuffers),
+          intervals(usePSRAMBuffers),
+          ready(SchedulerAllocator<std::shared_ptr<WorkerJobContext>>(usePSRAMBuffers)),
+          parked(SchedulerAllocator<std::shared_ptr<WorkerJobContext>>(usePSRAMBuffers)),
+          tasks(SchedulerAllocator<TaskHandle_t>(usePSRAMBuffers)),
+          taskCores(SchedulerAllocator<BaseType_t>(usePSRAMBuffers)) {}
+
+    ~WorkerPool() {
+        if (mutex) {
+            vSemaphoreDelete(mutex);
+        }
+    }
+
+    void lock() { xSemaphoreTake(mutex, portMAX_DELAY); }
+    void unlock() { xSemaphoreGive(mutex); }
+
+    void notifyAll() {
+        for (TaskHandle_t task : tasks) {
+            xTaskNotifyGive(task);
+        }
+    }
+
+    void notifyCore(BaseType_t core) {
+        for (size_t i = 0; i < tasks.size(); ++i) {
+            if (taskCores[i] == core) {
+                xTaskNotifyGive(tasks[i]);
+            }
+        }
+    }
+
+    bool hasDispatcherOn(BaseType_t core) const {
+        for (BaseType_t taskCore : taskCores) {
+            if (taskCore == core) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    DeadlineHeap<WorkerJobContext>& heapFor(const WorkerJobContext& ctx) {
+        return ctx.schedule.isInterval() ? intervals : deadlines;
+    }
+
+    void retireIfIdle(WorkerJobContext& ctx) {
+        if (ctx.runningCount > 0 || ctx.pendingRuns > 0 || ctx.finished.load()) {
+            return;
+        }
+        if (ctx.exhausted || ctx.cancelRequested.load()) {
+            ctx.finished.store(true);
+            if (ctx.exitedWorkers) {
+                ctx.exitedWorkers->fetch_add(1);
+            }
+        }
+    }
+
+    void dropFromReady(WorkerJobContext& ctx) {
+        if (!ctx.inReadyQueue) {
+            return;
+        }
+        for (size_t i = 0; i < ready.size(); ++i) {
+            if (ready[i].get() == &ctx) {
+                ready.erase(ready.begin() + static_cast<ptrdiff_t>(i));
+                break;
+            }
+        }
+        readyRuns.fetch_sub(ctx.pendingRuns);
+        ctx.pendingRuns = 0;
+        ctx.inReadyQueue = false;
+    }
+
+    void clearJobs() {
+        deadlines.clear();
+        intervals.clear();
+        for (auto& ctx : parked) {
+            ctx->poolParked = false;
+        }
+        parked.clear();
+        for (auto& ctx : ready) {
+            ctx->pendingRuns = 0;
+            ctx->inReadyQueue = false;
+        }
+        ready.clear();
+        readyRuns.store(0);
+    }
+
+    // Move every due job onto the ready queue and immediately queue its following
+    // occurrence. A run that is already pending absorbs further due slots, so a
+    // stalled pool catches up with one run per job instead of a burst.
+    void promoteDue(const DateTime& nowUtc) {
+        localTime.revalidate();
+        const int64_t nowUs = esp_timer_get_time();
+        while (!deadlines.empty() && deadlines.top()->poolDue <= nowUtc.epochSeconds) {
+            std::shared_ptr<WorkerJobContext> ctx = deadlines.pop();
+            if (!ctx->hasNext) {
+                if (ctx->schedule.isOneShot) {
+                    ctx->nextRunUtc = ctx->schedule.onceAtUtc;
+                    ctx->hasNext = true;
+                } else {
+                    ctx->cursor = ScheduleCursor::startingAt(nowUtc);
+                    ctx->hasNext =
+                        occurrences.advance(ctx->schedule, ctx->splayOffset, ctx->cursor, localTime, ctx->nextRunUtc);
+                }
+                if (!ctx->hasNext) {
+                    ctx->exhausted = true;
+                    retireIfIdle(*ctx);
+                    continue;
+                }
+                deadlines.push(ctx, ctx->nextRunUtc.epochSeconds);
+                continue;
+            }
+
+            const int64_t dueUs = nowUs - (nowUtc.epochSeconds - ctx->poolDue) * 1000000;
+            const MisfireDecision misfire =
+                resolveMisfire(ctx->schedule, ctx->options, ctx->cursor, localTime, ctx->nextRunUtc, nowUtc);
+            ctx->stats.recordMissed(misfire.missed);
+            if (misfire.runs > 0) {
+                markReady(ctx, dueUs, true, misfire.runs);
+            }
+            if (ctx->schedule.isOneShot) {
+                ctx->exhausted = true;
+                retireIfIdle(*ctx);
+                continue;
+            }
+            ctx->hasNext = misfire.movedOn
+                               ? misfire.hasNext
+                               : occurrences.advance(ctx->schedule, ctx->splayOffset, ctx->cursor, localTime,
+                                                     ctx->nextRunUtc);
+            traceCalendarReschedule(ctx->trace, ctx->jobId, ctx->hasNext, ctx->nextRunUtc, nowUtc);
+            if (!ctx->hasNext) {
+                ctx->exhausted = true;
+                retireIfIdle(*ctx);  // a skipped last occurrence leaves nothing queued to retire it later
+                continue;
+            }
+            deadlines.push(ctx, ctx->nextRunUtc.epochSeconds);
+        }
+    }
+
+    // After a clock change: recompute every calendar deadline later than afterUtc in
+    // one pass. Earlier ones stay put so promoteDue() applies the misfire policy.
+    void rescheduleDeadlines(int64_t afterUtc) {
+        localTime.invalidate();
+        localTime.revalidate();
+        auto reschedule = [&](WorkerJobContext& ctx) {
+            if (ctx.hasNext && !ctx.schedule.isOneShot && ctx.nextRunUtc.epochSeconds > afterUtc) {
+                ctx.cursor = ScheduleCursor::startingAt(dateTimeFromEpoch(afterUtc + 1));
+                ctx.hasNext = occurrences.advance(ctx.schedule, ctx.splayOffset, ctx.cursor, localTime, ctx.nextRunUtc);
+            }
+            return ctx.hasNext ? ctx.nextRunUtc.epochSeconds : kUnresolvedDeadline;
+        };
+        deadlines.rekeyAll(reschedule);
+        for (auto& ctx : parked) {  // paused jobs resume from the same place inline ones would
+            reschedule(*ctx);
+        }
+    }
+
+    void promoteIntervals(int64_t nowUs) {
+        while (!intervals.empty() && intervals.top()->poolDue <= nowUs) {
+            std::shared_ptr<WorkerJobContext> ctx = intervals.pop();
+            markReady(ctx, ctx->poolDue, true);
+            // Fixed-delay jobs are re-armed by finishRun() once their run returns.
+            if (ctx->schedule.intervalMode == SchedulerIntervalMode::FixedRate) {
+                uint32_t skipped = 0;
+                const int64_t nextDueUs = nextIntervalDueUs(ctx->schedule, ctx->poolDue, nowUs, &skipped);
+                ctx->stats.recordMissed(skipped);
+                traceIntervalReschedule(ctx->trace, ctx->jobId, nextDueUs);
+                ctx->nextDueUs.store(nextDueUs);
+                intervals.push(ctx, nextDueUs);
+            }
+        }
+    }
+
+    // dueUs: esp_timer instant the run became due, for JobStats lateness. A deadline
+    // that finds a run already pending is folded into it and counted as missed.
+    // runs > 1 queues a coalesced misfire catch-up as that many back-to-back runs.
+    void markReady(const std::shared_ptr<WorkerJobContext>& ctx, int64_t dueUs, bool deadline, uint32_t runs = 1) {
+        if (ctx->pendingRuns > 0 && deadline) {
+            ctx->stats.recordMissed(runs);
+        }
+        if (ctx->pendingRuns == 0) {
+            ctx->poolReadyDueUs = dueUs;
+            ctx->pendingRuns = static_cast<uint8_t>(runs);
+            const size_t depth = readyRuns.fetch_add(runs) + runs;
+            if (depth > highWater.load()) {
+                highWater.store(depth);
+            }
+        }
+        if (!ctx->inReadyQueue) {
+            ready.push_back(ctx);
+            ctx->inReadyQueue = true;
+            // Dispatchers wake together at a deadline, but the one that promoted a pinned
+            // job may sit on another core; make sure the job's own core looks.
+            if (ctx->poolCore != tskNO_AFFINITY) {
+                notifyCore(ctx->poolCore);
+            }
+        }
+    }
+
+    // triggerNow: one extra run through the ready queue; a one-shot is consumed by it.
+    void trigger(const std::shared_ptr<WorkerJobContext>& ctx) {
+        if (ctx->exhausted || ctx->cancelRequested.load() || ctx->paused.load()) {
+            return;
+        }
+        markReady(ctx, statsClockUs(), false);
+        if (ctx->schedule.isOneShot) {
+            deadlines.remove(*ctx);
+            ctx->exhausted = true;
+        }
+        notifyAll();
+    }
+
+    bool isFixedDelay(const WorkerJobContext& ctx) const {
+        return ctx.schedule.isInterval() && ctx.schedule.intervalMode == SchedulerIntervalMode::FixedDelay;
+    }
+
+    // A paused calendar job is off the deadline heap; keep it listed so that
+    // rescheduleDeadlines() still moves its next occurrence across clock steps.
+    void park(const std::shared_ptr<WorkerJobContext>& ctx) {
+        if (ctx->poolParked || ctx->schedule.isInterval() || ctx->schedule.isOnDemand) {
+            return;
+        }
+        ctx->poolParked = true;
+        parked.push_back(ctx);
+    }
+
+    void unpark(WorkerJobContext& ctx) {
+        if (!ctx.poolParked) {
+            return;
+        }
+        ctx.poolParked = false;
+        for (size_t i = 0; i < parked.size(); ++i) {
+            if (parked[i].get() == &ctx) {
+                parked.erase(parked.begin() + static_cast<ptrdiff_t>(i));
+                break;
+            }
+        }
+    }
+
+    // Put a new or resumed job on its heap unless it is still queued there or, for
+    // fixed-delay intervals, a run in flight will re-arm it when it returns.
+    void rearm(const std::shared_ptr<WorkerJobContext>& ctx) {
+        unpark(*ctx);
+        DeadlineHeap<WorkerJobContext>& heap = heapFor(*ctx);
+        if (ctx->schedule.isOnDemand || ctx->exhausted || ctx->cancelRequested.load() || heap.contains(*ctx)) {
+            return;
+        }
+        if (isFixedDelay(*ctx) && (ctx->runningCount > 0 || ctx->pendingRuns > 0)) {
+            return;
+        }
+        if (ctx->schedule.isInterval()) {
+            heap.push(ctx, ctx->nextDueUs.load());
+        } else {
+            heap.push(ctx, ctx->hasNext ? ctx->nextRunUtc.epochSeconds : kUnresolvedDeadline);
+        }
+    }
+
+    void finishRun(const std::shared_ptr<WorkerJobContext>& ctx, int64_t startUs, int64_t endUs, int64_t dueUs,
+                   int64_t startEpochSeconds) {
+        ctx->stats.recordRun(startUs, endUs, startUs - dueUs, startEpochSeconds);
+        ctx->lastRunUtc.store(startEpochSeconds);
+        if (JobStatsRecorder::kEnabled && !ctx->exhausted) {
+            const bool behind = ctx->schedule.isInterval()
+                                    ? (!isFixedDelay(*ctx) && ctx->nextDueUs.load() <= endUs)
+                                    : (ctx->hasNext && ctx->nextRunUtc.epochSeconds <= date->now().epochSeconds);
+            if (behind) {
+                ctx->stats.recordOverrun();
+            }
+        }
+        --ctx->runningCount;
+        if (isFixedDelay(*ctx) && ctx->runningCount == 0 && ctx->pendingRuns == 0 && !ctx->paused.load() &&
+            !ctx->cancelRequested.load() && !intervals.contains(*ctx)) {
+            const int64_t nextDueUs = esp_timer_get_time() + intervalPeriodUs(ctx->schedule);
+            ctx->nextDueUs.store(nextDueUs);
+            intervals.push(ctx, nextDueUs);
+        }
+        retireIfIdle(*ctx);
+    }
+
+    // First ready job (FIFO) that is not paused, still under its concurrency limit and
+    // not pinned to another core. All cores share this one queue under the pool mutex;
+    // there are no per-core queues to steal from. A dispatcher that frees up first
+    // takes the next unpinned job.
+    std::shared_ptr<WorkerJobContext> takeRunnable(BaseType_t core) {
+        for (size_t i = 0; i < ready.size(); ++i) {
+            WorkerJobContext& ctx = *ready[i];
+            if (ctx.paused.load() || (ctx.poolCore != tskNO_AFFINITY && ctx.poolCore != core)) {
+                continue;
+            }
+            const uint8_t limit = ctx.maxConcurrentRuns == 0 ? 1 : ctx.maxConcurrentRuns;
+            if (ctx.runningCount >= limit) {
+                continue;
+            }
+            std::shared_ptr<WorkerJobContext> picked = ready[i];
+            --ctx.pendingRuns;
+            readyRuns.fetch_sub(1);
+            ++ctx.runningCount;
+            if (ctx.pendingRuns == 0) {
+                ctx.inReadyQueue = false;
+                ready.erase(ready.begin() + static_cast<ptrdiff_t>(i));
+            }
+            return picked;
+        }
+        return nullptr;
+    }
+
+    SemaphoreHandle_t mutex = nullptr;
+    ESPDate* date = nullptr;
+    std::shared_ptr<SchedulerTrace> trace{};
+    bool clockWasInvalid = false;
+    std::shared_ptr<std::atomic<uint32_t>> clockGeneration{};
+    uint32_t clockGenerationSeen = 0;
+    SchedulerClockWatch clockWatch{};
+    std::shared_ptr<std::atomic<int64_t>> minValidEpochSeconds{};
+    DeadlineHeap<WorkerJobContext> deadlines;   // calendar jobs, epoch seconds
+    DeadlineHeap<WorkerJobContext> intervals;   // interval jobs, esp_timer microseconds
+    SchedulerLocalTimeCache localTime;
+    OccurrenceCache occurrences;  // paired with localTime; both used under the pool lock
+    SchedulerVector<std::shared_ptr<WorkerJobContext>> ready;
+    SchedulerVector<std::shared_ptr<WorkerJobContext>> parked;  // paused calendar jobs, see park()
+    SchedulerVector<TaskHandle_t> tasks;
+    SchedulerVector<BaseType_t> taskCores;  // parallel to tasks; tskNO_AFFINITY unless per-core
+    std::atomic<size_t> readyRuns{0};
+    std::atomic<size_t> highWater{0};
+    bool stopping = false;
+};
+
+// Handed to each dispatcher task on creation.
+struct ESPScheduler::PoolTaskArgs {
+    std::shared_ptr<WorkerPool> pool;
+    BaseType_t core = tskNO_AFFINITY;  // the dispatcher's pinned core, if any
+};
+
+ScheduleField ScheduleField::any() {
+    ScheduleField f;
+    f.m_isAny = true;
+    f.m_mask = 0;
+    return f;
+}
+
+ScheduleField ScheduleField::only(int value) {
+    ScheduleField f;
+    if (value < 0 || value > 63) {
+        return f;
+    }
+    f.m_mask = 1ULL << value;
+    return f;
+}
+
+ScheduleField ScheduleField::range(int from, int to) {
+    ScheduleField f;
+    if (from < 0 || to < 0 || from > to || to > 63) {
+        return f;
+    }
+    f.m_mask = cron_expression_detail::rangeMask(from, to);
+    return f;
+}
+
+ScheduleField ScheduleField::every(int step) {
+    ScheduleField f;
+    if (step <= 0) {
+        return f;
+    }
+    f.m_mask = cron_expression_detail::stepMask(0, 63, step);
+    f.m_pastRange = true;
+    return f;
+}
+
+ScheduleField ScheduleField::rangeEvery(int from, int to, int step) {
+    ScheduleField f;
+    if (step <= 0 || from < 0 || to < 0 || from > to || to > 63) {
+        return f;
+    }
+    f.m_mask = cron_expression_detail::stepMask(from, to, step);
+    return f;
+}
+
+ScheduleField ScheduleField::list(const int* values, size_t count) {
+    ScheduleField f;
+    if (!values || count == 0) {
+        return f;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        const int v = values[i];
+        if (v < 0 || v > 63) {
+            f.m_mask = 0;
+            return f;
+        }
+        f.m_mask |= 1ULL << v;
+    }
+    return f;
+}
+
+ScheduleField ScheduleField::fromMask(uint64_t mask) {
+    ScheduleField f;
+    f.m_mask = mask;
+    return f;
+}
+
+bool ScheduleField::matches(int value) const {
+    if (m_isAny) {
+        return true;
+    }
+    if (value < 0 || value > 63) {
+        return false;
+    }
+    return (m_mask & (1ULL << value)) != 0;
+}
+
+Schedule Schedule::onceUtc(const DateTime& whenUtc) {
+    Schedule s;
+    s.isOneShot = true;
+    s.onceAtUtc = whenUtc;
+    return s;
+}
+
+Schedule Schedule::onDemand() {
+    Schedule s;
+    s.isOnDemand = true;
+    return s;
+}
+
+Schedule Schedule::everyMs(uint32_t periodMs, SchedulerIntervalMode mode) {
+    Schedule s;
+    s.intervalMs = periodMs;
+    s.intervalMode = mode;
+    return s;
+}
+
+Schedule Schedule::dailyAtLocal(int hour, int minute) {
+    Schedule s;
+    s.hour = ScheduleField::only(hour);
+    s.minute = ScheduleField::only(minute);
+    s.dayOfMonth = ScheduleField::any();
+    s.month = ScheduleField::any();
+    s.dayOfWeek = ScheduleField::any();
+    return s;
+}
+
+Schedule Schedule::weeklyAtLocal(uint8_t dowMask, int hour, int minute) {
+    int days[7];
+    size_t count = 0;
+    for (int i = 0; i < 7; ++i) {
+        if (dowMask & (1 << i)) {
+            days[count++] = i;
+        }
+    }
+    Schedule s;
+    s.hour = ScheduleField::only(hour);
+    s.minute = ScheduleField::only(minute);
+    s.dayOfMonth = ScheduleField::any();
+    s.month = ScheduleField::any();
+    if (count == 0) {
+        s.dayOfWeek = ScheduleField::any();
+    } else {
+        s.dayOfWeek = ScheduleField::list(days, count);
+    }
+    return s;
+}
+
+Schedule Schedule::monthlyOnDayLocal(int dayOfMonth, int hour, int minute) {
+    Schedule s;
+    int clamped = dayOfMonth;
+    if (clamped < 1) {
+        clamped = 1;
+    } else if (clamped > 31) {
+        clamped = 31;
+    }
+    s.dayOfMonth = ScheduleField::only(clamped);
+    s.hour = ScheduleField::only(hour);
+    s.minute = ScheduleField::only(minute);
+    s.month = ScheduleField::any();
+    s.dayOfWeek = ScheduleField::any();
+    return s;
+}
+
+Schedule Schedule::custom(const ScheduleField& minute,
+                          const ScheduleField& hour,
+                          const ScheduleField& dom,
+                          const ScheduleField& month,
+                          const ScheduleField& dow) {
+    Schedule s;
+    s.minute = minute;
+    s.hour = hour;
+    s.dayOfMonth = dom;
+    s.month = month;
+    s.dayOfWeek = dow;
+    return s;
+}
+
+Schedule Schedule::cron(const char* expression) {
+    return cron(CronExpression::parse(expression));
+}
+
+Schedule Schedule::cron(const CronExpression& expression) {
+    Schedule s;
+    if (!expression.valid()) {
+        s.minute = ScheduleField();  // empty field: rejected by addJob()
+        return s;
+    }
+    ScheduleField* fields[CronExpression::kFieldCount] = {&s.minute, &s.hour, &s.dayOfMonth, &s.month, &s.dayOfWeek};
+    for (size_t i = 0; i < CronExpression::kFieldCount; ++i) {
+        *fields[i] = expression.fieldIsAny(i) ? ScheduleField::any() : ScheduleField::fromMask(expression.fieldMask(i));
+    }
+    return s;
+}
+
+JobOptions JobOptions::withMisfire(SchedulerMisfirePolicy policy, uint32_t thresholdSeconds, uint8_t maxRuns) const {
+    JobOptions o = *this;
+    o.misfirePolicy = policy;
+    o.misfireThresholdSeconds = thresholdSeconds;
+    o.misfireMaxRuns = maxRuns == 0 ? 1 : maxRuns;
+    return o;
+}
+
+JobOptions JobOptions::withPriority(uint8_t jobPriority) const {
+    JobOptions o = *this;
+    o.priority = jobPriority;
+    return o;
+}
+
+JobOptions JobOptions::withSplay(uint32_t windowSeconds, uint32_t key) const {
+    JobOptions o = *this;
+    o.splaySeconds = windowSeconds;
+    o.splayKey = key;
+    return o;
+}
+
+uint32_t JobOptions::splayOffsetFor(const Schedule& schedule) const {
+    if (splaySeconds == 0 || schedule.isOneShot || schedule.isOnDemand || schedule.isInterval()) {
+        return 0;
+    }
+    // murmur3 finalizer: neighbouring keys land far apart in the window.
+    uint32_t h = splayKey;
+    h ^= h >> 16;
+    h *= 0x85EBCA6Bu;
+    h ^= h >> 13;
+    h *= 0xC2B2AE35u;
+    h ^= h >> 16;
+    return h % splaySeconds;
+}
+
+JobOptions JobOptions::persistAs(uint32_t key) const {
+    JobOptions o = *this;
+    o.persistKey = key;
+    return o;
+}
+
+ScheduleCursor ScheduleCursor::startingAt(const DateTime& fromUtc) {
+    ScheduleCursor cursor;
+    cursor.fromUtc = fromUtc.epochSeconds;
+    return cursor;
+}
+
+ScheduleIterator::ScheduleIterator(const Schedule& schedule, const DateTime& fromUtc) {
+    reset(schedule, fromUtc);
+}
+
+void ScheduleIterator::reset(const Schedule& schedule, const DateTime& fromUtc) {
+    m_schedule = schedule;
+    m_cursor = ScheduleCursor::startingAt(fromUtc);
+}
+
+bool ScheduleIterator::next(DateTime& outNextUtc) {
+    m_localTime.revalidate();
+    return advanceScheduleCursor(m_schedule, 0, m_cursor, m_localTime, outNextUtc);
+}
+
+ESPScheduler::ESPScheduler(ESPDate& date, ESPWorker* worker)
+    : ESPScheduler(date, worker, ESPSchedulerConfig{}) {}
+
+ESPScheduler::ESPScheduler(ESPDate& date, const ESPSchedulerConfig& config)
+    : ESPScheduler(date, nullptr, config) {}
+
+ESPScheduler::ESPScheduler(ESPDate& date, ESPWorker* worker, const ESPSchedulerConfig& config)
+    : ESPScheduler(date, config, 0) {
+    (void)worker;
+}
+
+ESPScheduler::ESPScheduler(ESPDate& date, const ESPSchedulerConfig& config, size_t fixedJobCapacity)
+    : m_date(date),
+      m_minValidEpochSecondsRef(std::make_shared<std::atomic<int64_t>>(kDefaultMinValidEpochSeconds)),
+      m_exitedWorkersRef(std::make_shared<std::atomic<uint32_t>>(0)),
+      m_clockGenerationRef(std::make_shared<std::atomic<uint32_t>>(0)),
+      m_completionsRef(std::make_shared<std::atomic<uint32_t>>(0)),
+      m_clockStepThresholdSeconds(config.clockStepThresholdSeconds),
+      usePSRAMBuffers_(config.usePSRAMBuffers),
+      m_fixedJobCapacity(fixedJobCapacity < kMaxJobSlots ? fixedJobCapacity : kMaxJobSlots),
+      m_schedules(usePSRAMBuffers_),
+      m_inlineJobs(SchedulerAllocator<InlineJob>(usePSRAMBuffers_)),
+      m_inlineQueue(SchedulerAllocator<InlineQueueEntry>(usePSRAMBuffers_)),
+      m_intervalQueue(SchedulerAllocator<InlineQueueEntry>(usePSRAMBuffers_)),
+      m_readyQueue(SchedulerAllocator<InlineQueueEntry>(usePSRAMBuffers_)),
+      m_finishedInline(SchedulerAllocator<size_t>(usePSRAMBuffers_)),
+      m_triggeredInline(SchedulerAllocator<size_t>(usePSRAMBuffers_)),
+      m_freeInlineSlots(SchedulerAllocator<size_t>(usePSRAMBuffers_)),
+      m_freePostedSlots(SchedulerAllocator<size_t>(usePSRAMBuffers_)),
+      m_workerJobs(SchedulerAllocator<WorkerJob>(usePSRAMBuffers_)),
+      m_freeWorkerSlots(SchedulerAllocator<size_t>(usePSRAMBuffers_)),
+      m_workerPoolSize(config.workerPoolSize),
+      m_workerPoolTask(config.workerPoolTask),
+      m_workerPoolPerCore(config.workerPoolPerCore),
+      m_commandQueueSize(config.commandQueueSize),
+      m_commands(usePSRAMBuffers_),
+      m_postedInlineIds(usePSRAMBuffers_),
+      m_postedWorkerIds(usePSRAMBuffers_),
+      m_tickTaskRef(std::make_shared<std::atomic<TaskHandle_t>>(nullptr)),
+      m_persisted(SchedulerAllocator<PersistedJob>(usePSRAMBuffers_)),
+      m_dependencies(SchedulerAllocator<JobDependency>(usePSRAMBuffers_)) {
+    initCommandQueue();
+    reserveFixedCapacity();
+    refillPostedIds();
+    if (config.traceBufferSize > 0) {
+        m_trace = std::allocate_shared<SchedulerTrace>(SchedulerAllocator<SchedulerTrace>(usePSRAMBuffers_),
+                                                       usePSRAMBuffers_);
+        m_trace->init(config.traceBufferSize);
+    }
+}
+
+ESPScheduler::~ESPScheduler() {
+    deinit();
+}
+
+void ESPScheduler::deinit() {
+    if (!m_initialized.exchange(false, std::memory_order_relaxed)) {
+        return;
+    }
+
+    for (auto& job : m_workerJobs) {
+        cancelWorker(job);
+    }
+    if (m_workerPool) {
+        m_workerPool->lock();
+        m_workerPool->clearJobs();
+        m_workerPool->stopping = true;
+        m_workerPool->notifyAll();
+        m_workerPool->unlock();
+        m_workerPool.reset();
+    }
+
+    SchedulerVector<InlineJob>(SchedulerAllocator<InlineJob>(usePSRAMBuffers_)).swap(m_inlineJobs);
+    m_schedules.clear();
+    InlineQueue(SchedulerAllocator<InlineQueueEntry>(usePSRAMBuffers_)).swap(m_inlineQueue);
+    InlineQueue(SchedulerAllocator<InlineQueueEntry>(usePSRAMBuffers_)).swap(m_intervalQueue);
+    InlineQueue(SchedulerAllocator<InlineQueueEntry>(usePSRAMBuffers_)).swap(m_readyQueue);
+    SchedulerVector<size_t>(SchedulerAllocator<size_t>(usePSRAMBuffers_)).swap(m_finishedInline);
+    SchedulerVector<size_t>(SchedulerAllocator<size_t>(usePSRAMBuffers_)).swap(m_triggeredInline);
+    SchedulerVector<size_t>(SchedulerAllocator<size_t>(usePSRAMBuffers_)).swap(m_freeInlineSlots);
+    SchedulerVector<size_t>(SchedulerAllocator<size_t>(usePSRAMBuffers_)).swap(m_freePostedSlots);
+    SchedulerVector<WorkerJob>(SchedulerAllocator<WorkerJob>(usePSRAMBuffers_)).swap(m_workerJobs);
+    SchedulerVector<size_t>(SchedulerAllocator<size_t>(usePSRAMBuffers_)).swap(m_freeWorkerSlots);
+    m_commands.release();
+    m_postedInlineIds.release();
+    m_postedWorkerIds.release();
+    m_reservedInlineIds = 0;
+    m_reservedWorkerIds = 0;
+    SchedulerVector<PersistedJob>(SchedulerAllocator<PersistedJob>(usePSRAMBuffers_)).swap(m_persisted);
+    SchedulerVector<JobDependency>(SchedulerAllocator<JobDependency>(usePSRAMBuffers_)).swap(m_dependencies);
+    m_snapshotTimeZone = 0;
+    m_snapshotKeysDirty = false;
+}
+
+bool ESPScheduler::isInitialized() const {
+    return m_initialized.load(std::memory_order_relaxed);
+}
+
+void ESPScheduler::ensureInitialized() {
+    if (!isInitialized()) {
+        m_initialized.store(true, std::memory_order_relaxed);
+        // deinit() released the buffers; size them again before the first job lands.
+        initCommandQueue();
+        reserveFixedCapacity();
+        refillPostedIds();
+    }
+}
+
+// Every slot exists up front. Posted inline ids get slots of their own past the fixed
+// capacity, one per command-ring entry, so the queue never holds a slot addJob() could use.
+void ESPScheduler::reserveFixedCapacity() {
+    if (m_fixedJobCapacity == 0) {
+        return;
+    }
+    const size_t postedSlots = std::min(m_commands.capacity(), kMaxJobSlots - m_fixedJobCapacity);
+    const size_t slots = m_fixedJobCapacity + postedSlots;
+    m_inlineJobs.resize(slots);
+    m_schedules.reserve(slots);
+    m_inlineQueue.reserve(slots);
+    m_intervalQueue.reserve(slots);
+    m_readyQueue.reserve(slots);
+    m_finishedInline.reserve(slots);
+    m_triggeredInline.reserve(slots);
+    m_freeInlineSlots.reserve(m_fixedJobCapacity);
+    m_freePostedSlots.reserve(postedSlots);
+    for (size_t slot = slots; slot-- > m_fixedJobCapacity;) {
+        m_freePostedSlots.push_back(slot);
+    }
+    for (size_t slot = m_fixedJobCapacity; slot-- > 0;) {
+        m_freeInlineSlots.push_back(slot);
+    }
+}
+
+size_t ESPScheduler::nextInlineSlot() const {
+    if (!m_freeInlineSlots.empty()) {
+        return m_freeInlineSlots.back();
+    }
+    const size_t limit = m_fixedJobCapacity > 0 ? m_fixedJobCapacity : kMaxJobSlots;
+    return m_inlineJobs.size() < limit ? m_inlineJobs.size() : kNotQueued;
+}
+
+void ESPScheduler::setMinValidUnixSeconds(int64_t minEpochSeconds) {
+    m_minValidEpochSeconds = minEpochSeconds;
+    if (m_minValidEpochSecondsRef) {
+        m_minValidEpochSecondsRef->store(minEpochSeconds);
+    }
+    wakeAllWorkers();
+}
+
+void ESPScheduler::setMinValidUtc(const DateTime& minUtc) {
+    setMinValidUnixSeconds(minUtc.epochSeconds);
+}
+
+int64_t ESPScheduler::minValidUnixSeconds() const {
+    return m_minValidEpochSeconds;
+}
+
+void ESPScheduler::notifyClockChanged() {
+    m_localTimeCache.invalidate();
+    m_clockGenerationRef->fetch_add(1);
+    wakeAllWorkers();
+}
+
+bool ESPScheduler::fieldWithinRange(const ScheduleField& field, int min, int max) const {
+    if (field.isAny()) {
+        return true;
+    }
+    const uint64_t mask = field.rawMask();
+    const uint64_t allowed = allowedMask(min, max);
+    if (field.runsPastRange()) {
+        return (mask & allowed) != 0;
+    }
+    return mask != 0 && (mask & ~allowed) == 0;
+}
+
+uint64_t ESPScheduler::allowedMask(int min, int max) const {
+    if (min < 0) {
+        min = 0;
+    }
+    if (max > 63) {
+        max = 63;
+    }
+    if (max >= 63) {
+        return ~static_cast<uint64_t>(0);
+    }
+    const uint64_t upper = (1ULL << (max + 1)) - 1;
+    const uint64_t lower = (min == 0) ? 0 : ((1ULL << min) - 1);
+    return upper & ~lower;
+}
+
+bool ESPScheduler::validateSchedule(const Schedule& schedule) const {
+    // Five mask tests, cheap enough to run on every add: the fields are public, so a
+    // schedule that came from cron() may have been edited since.
+    if (schedule.isOneShot || schedule.isOnDemand || schedule.isInterval()) {
+        return true;
+    }
+    const bool minuteOk = fieldWithinRange(schedule.minute, 0, 59);
+    const bool hourOk = fieldWithinRange(schedule.hour, 0, 23);
+    const bool domOk = fieldWithinRange(schedule.dayOfMonth, 1, 31);
+    const bool monthOk = fieldWithinRange(schedule.month, 1, 12);
+    const bool dowOk = fieldWithinRange(schedule.dayOfWeek, 0, 6);
+    return minuteOk && hourOk && domOk && monthOk && dowOk;
+}
+
+// A fixed-capacity scheduler never allocates after construction, so it takes no
+// keyed jobs: the snapshot table they join grows on the heap.
+bool ESPScheduler::fixedCapacityAllows(const JobOptions& options) const {
+    return m_fixedJobCapacity == 0 || options.persistKey == 0;
+}
+
+uint32_t ESPScheduler::addJobOnceUtc(const DateTime& whenUtc,
+                                     SchedulerJobMode mode,
+                                     SchedulerCallback cb,
+                                     void* userData,
+                                     const SchedulerTaskConfig* taskCfg) {
+    return addJobOnceUtc(whenUtc, mode, SchedulerCallable(cb, userData), taskCfg);
+}
+
+uint32_t ESPScheduler::addJobOnceUtc(const DateTime& whenUtc,
+                                     SchedulerJobMode mode,
+                                     SchedulerCallable cb,
+                                     const SchedulerTaskConfig* taskCfg) {
     Schedule s = Schedule::onceUtc(whenUtc);
-    return addJob(s, mode, std::move(cb), userData, taskCfg);
+    return addJob(s, mode, std::move(cb), taskCfg);
+}
+
+uint32_t ESPScheduler::addJob(const Schedule& schedule,
+                              SchedulerJobMode mode,
+                              SchedulerCallback cb,
+                              void* userData,
+                              const SchedulerTaskConfig* taskCfg) {
+    return addJob(schedule, mode, SchedulerCallable(cb, userData), taskCfg);
+}
+
+uint32_t ESPScheduler::addJob(const Schedule& schedule,
+                              SchedulerJobMode mode,
+                              SchedulerCallable cb,
+                              const SchedulerTaskConfig* taskCfg) {
+    return addJob(schedule, JobOptions{}, mode, std::move(cb), taskCfg);
+}
+
+uint32_t ESPScheduler::addJob(const Schedule& schedule,
+                              const JobOptions& options,
+                              SchedulerJobMode mode,
+                              SchedulerCallback cb,
+                              void* userData,
+                              const SchedulerTaskConfig* taskCfg) {
+    return addJob(schedule, options, mode, SchedulerCallable(cb, userData), taskCfg);
+}
+
+uint32_t ESPScheduler::addJob(const Schedule& schedule,
+                              const JobOptions& options,
+                              SchedulerJobMode mode,
+                              SchedulerCallable cb,
+                              const SchedulerTaskConfig* taskCfg) {
+    if (!cb) {
+        return 0;
+    }
+    if (!validateSchedule(schedule) || !fixedCapacityAllows(options)) {
+        return 0;
+    }
+    ensureInitialized();
+    if (options.persistKey != 0 && persistedJobBlocksAdd(schedule, options, mode)) {
+        return 0;
+    }
+
+    size_t slot = kNotQueued;
+    if (mode == SchedulerJobMode::Inline) {
+        slot = acquireInlineSlot();
+    } else if (m_fixedJobCapacity == 0) {  // worker contexts and task stacks are heap-allocated
+        slot = acquireWorkerSlot();
+    }
+    if (slot == kNotQueued) {
+        return 0;
+    }
+    return installJob(slot, schedule, options, mode, std::move(cb), taskCfg);
+}
+
+uint32_t ESPScheduler::addJobAfter(const uint32_t* predecessors,
+                                   size_t count,
+                                   SchedulerJobMode mode,
+                                   SchedulerCallable cb,
+                                   const SchedulerTaskConfig* taskCfg) {
+    if (!predecessors || count == 0 || count > kMaxJobPredecessors || m_fixedJobCapacity > 0) {
+        return 0;  // the dependency table grows on the heap
+    }
+    for (size_t i = 0; i < count; ++i) {
+        if (!jobExists(predecessors[i]) || std::find(predecessors, predecessors + i, predecessors[i]) != predecessors + i) {
+            return 0;
+        }
+    }
+    const uint32_t jobId = addJob(Schedule::onDemand(), mode, std::move(cb), taskCfg);
+    if (jobId == 0) {
+        return 0;
+    }
+
+    JobDependency dependency;
+    dependency.jobId = jobId;
+    dependency.count = static_cast<uint8_t>(count);
+    for (size_t i = 0; i < count; ++i) {
+        dependency.predecessors[i] = predecessors[i];
+        const size_t inlineSlot = findInlineSlot(predecessors[i]);
+        if (inlineSlot != kNotQueued) {
+            m_inlineJobs[inlineSlot].hasDependents = true;
+            continue;
+        }
+        // Flag first, then read the count: a run finishing in between is either in the
+        // baseline or announced through m_completionsRef, never lost.
+        WorkerJobContext& ctx = *m_workerJobs[findWorkerSlot(predecessors[i])].context;
+        ctx.hasDependents.store(true);
+        dependency.seenRuns[i] = ctx.completedRuns.load();
+    }
+    m_dependencies.push_back(dependency);
+    return jobId;
+}
+
+uint32_t ESPScheduler::installJob(size_t slot,
+                                  const Schedule& schedule,
+                                  const JobOptions& requested,
+                                  SchedulerJobMode mode,
+                                  SchedulerCallable cb,
+                                  const SchedulerTaskConfig* taskCfg) {
+    const bool worker = mode != SchedulerJobMode::Inline;
+    const uint32_t jobId = makeJobId(slot, worker ? m_workerJobs[slot].generation : m_inlineJobs[slot].generation, worker);
+    JobOptions options = requested;
+    if (options.splaySeconds > 0 && options.splayKey == 0) {
+        // The persist key survives reboots; the job id only keeps offsets apart within one boot.
+        options.splayKey = options.persistKey != 0 ? options.persistKey : jobId;
+    }
+    const uint32_t splayOffset = options.splayOffsetFor(schedule);
+    if (!worker) {
+        InlineJob& job = m_inlineJobs[slot];
+        job.id = jobId;
+        job.live = true;
+        job.scheduleRef = m_schedules.acquire(schedule);
+        job.options = options;
+        job.splayOffset = splayOffset;
+        job.callback = std::move(cb);
+        SchedulerSnapshotRecord restored{};
+        if (options.persistKey != 0 && claimPersisted(job.id, schedule, options, mode, restored)) {
+            job.paused = (restored.flags & SchedulerSnapshotRecord::kPaused) != 0;
+            job.lastRunUtc = restored.lastRunUtc;
+            if ((restored.flags & SchedulerSnapshotRecord::kHasNext) != 0) {
+                job.nextRunUtc = dateTimeFromEpoch(restored.nextRunUtc);
+                job.cursor = resumeCursorAt(restored.nextRunUtc - splayOffset);
+                job.hasNext = true;
+            }
+        }
+        if (schedule.isInterval()) {
+            job.nextDueUs = esp_timer_get_time() + intervalPeriodUs(schedule);
+            job.hasNext = true;
+        }
+        if (!job.paused) {
+            queueInlineJob(slot);
+        }
+        trace(SchedulerTraceEvent::JobAdded, job.id, schedule.intervalMs, static_cast<uint8_t>(mode));
+        return job.id;
+    }
+
+    auto ctx = std::allocate_shared<WorkerJobContext>(SchedulerAllocator<WorkerJobContext>(usePSRAMBuffers_));
+    ctx->jobId = jobId;
+    ctx->trace = m_trace;
+    ctx->schedule = schedule;
+    ctx->options = options;
+    ctx->splayOffset = splayOffset;
+    ctx->callback = std::move(cb);
+    ctx->date = &m_date;
+    ctx->minValidEpochSeconds = m_minValidEpochSecondsRef;
+    ctx->exitedWorkers = m_exitedWorkersRef;
+    ctx->clockGeneration = m_clockGenerationRef;
+    ctx->clockGenerationSeen = m_clockGenerationRef->load();
+    ctx->completions = m_completionsRef;
+    ctx->tickTask = m_tickTaskRef;
+    if (schedule.isInterval()) {
+        ctx->nextDueUs.store(esp_timer_get_time() + intervalPeriodUs(schedule));
+        ctx->hasNext = true;
+    }
+    if (m_workerPoolSize > 0 && !ensureWorkerPool()) {
+        releaseWorkerSlot(slot);
+        return 0;
+    }
+    if (m_workerPoolSize > 0 && m_workerPoolPerCore && taskCfg && taskCfg->coreId != tskNO_AFFINITY) {
+        // A job pinned to a core without a dispatcher would never run.
+        if (!m_workerPool->hasDispatcherOn(taskCfg->coreId)) {
+            releaseWorkerSlot(slot);
+            return 0;
+        }
+        ctx->poolCore = taskCfg->coreId;
+    }
+    // Restored before the job becomes visible to its worker, so no task races these writes.
+    SchedulerSnapshotRecord restored{};
+    if (options.persistKey != 0 && claimPersisted(ctx->jobId, schedule, options, mode, restored)) {
+        ctx->paused.store((restored.flags & SchedulerSnapshotRecord::kPaused) != 0);
+        ctx->lastRunUtc.store(restored.lastRunUtc);
+        if ((restored.flags & SchedulerSnapshotRecord::kHasNext) != 0) {
+            ctx->nextRunUtc = dateTimeFromEpoch(restored.nextRunUtc);
+            ctx->cursor = resumeCursorAt(restored.nextRunUtc - splayOffset);
+            ctx->hasNext = true;
+            ctx->publishedNextUtc.store(restored.nextRunUtc);
+        }
+    }
+
+    if (m_workerPoolSize > 0) {
+        ctx->maxConcurrentRuns = taskCfg ? taskCfg->maxConcurrentRuns : SchedulerTaskConfig{}.maxConcurrentRuns;
+        WorkerJob& job = m_workerJobs[slot];
+        job.id = makeJobId(slot, job.generation, true);
+        job.context = ctx;
+
+        m_workerPool->lock();
+        if (!ctx->paused.load()) {  // a job restored as paused is armed by resumeJob()
+            m_workerPool->rearm(ctx);
+        } else {
+            m_workerPool->park(ctx);
+        }
+        m_workerPool->notifyAll();
+        m_workerPool->unlock();
+        trace(SchedulerTraceEvent::JobAdded, job.id, schedule.intervalMs, static_cast<uint8_t>(mode));
+        return job.id;
+    }
+
+    const SchedulerTaskConfig runtimeCfg = makeTaskConfig(taskCfg);
+    auto* taskCtx = new (std::nothrow) std::shared_ptr<WorkerJobContext>(ctx);
+    if (!taskCtx) {
+        releasePersisted(options.persistKey);
+        releaseWorkerSlot(slot);
+        return 0;
+    }
+    TaskHandle_t taskHandle = nullptr;
+    const BaseType_t created = xTaskCreatePinnedToCore(
+        &ESPScheduler::workerTaskEntry,
+        runtimeCfg.name ? runtimeCfg.name : "sched-job",
+        runtimeCfg.stackSize,
+        taskCtx,
+        runtimeCfg.priority,
+        &taskHandle,
+        runtimeCfg.coreId);
+    if (created != pdPASS || taskHandle == nullptr) {
+        delete taskCtx;
+        releasePersisted(options.persistKey);
+        releaseWorkerSlot(slot);
+        return 0;
+    }
+
+    WorkerJob& job = m_workerJobs[slot];
+    job.id = makeJobId(slot, job.generation, true);
+    job.context = ctx;
+    job.task = taskHandle;
+    trace(SchedulerTraceEvent::JobAdded, job.id, schedule.intervalMs, static_cast<uint8_t>(mode));
+    trace(SchedulerTraceEvent::WorkerCreated, job.id, runtimeCfg.stackSize, 0);
+    return job.id;
+}
+
+bool ESPScheduler::cancelJob(uint32_t jobId) {
+    if (!isInitialized()) {
+        return false;
+    }
+
+    const size_t inlineSlot = findInlineSlot(jobId);
+    if (inlineSlot != kNotQueued) {
+        if (m_dispatchingInline) {
+            // The slot must not be reused while tick() walks the queue; free it afterwards.
+            finishInlineJob(inlineSlot);
+        } else {
+            removeInlineJobAt(inlineSlot);
+        }
+        trace(SchedulerTraceEvent::JobCancelled, jobId);
+        if (!m_dependencies.empty()) {
+            settleDependencies();  // the rest of a fan-in may already have completed
+        }
+        return true;
+    }
+    const size_t workerSlot = findWorkerSlot(jobId);
+    if (workerSlot != kNotQueued) {
+        if (!m_dependencies.empty()) {
+            collectWorkerRuns(m_workerJobs[workerSlot]);
+        }
+        cancelWorker(m_workerJobs[workerSlot]);
+        releaseWorkerSlot(workerSlot);
+        trace(SchedulerTraceEvent::JobCancelled, jobId);
+        if (!m_dependencies.empty()) {
+            settleDependencies();
+        }
+        return true;
+    }
+    return false;
+}
+
+bool ESPScheduler::pauseJob(uint32_t jobId) {
+    if (!isInitialized()) {
+        return false;
+    }
+
+    const size_t inlineSlot = findInlineSlot(jobId);
+    if (inlineSlot != kNotQueued) {
+        InlineJob& job = m_inlineJobs[inlineSlot];
+        job.paused = true;
+        if (job.queuePos != kNotQueued) {
+            queueRemove(queueFor(job), job.queuePos);
+        }
+        trace(SchedulerTraceEvent::JobPaused, jobId);
+        return true;
+    }
+    const size_t workerSlot = findWorkerSlot(jobId);
+    if (workerSlot != kNotQueued) {
+        WorkerJob& job = m_workerJobs[workerSlot];
+        job.context->paused.store(true);
+        if (m_workerPool && !job.task) {
+            m_workerPool->lock();
+            m_workerPool->heapFor(*job.context).remove(*job.context);
+            m_workerPool->park(job.context);
+            m_workerPool->unlock();
+        }
+        wakeWorker(job);
+        trace(SchedulerTraceEvent::JobPaused, jobId);
+        return true;
+    }
+    return false;
+}
+
+bool ESPScheduler::resumeJob(uint32_t jobId) {
+    if (!isInitialized()) {
+        return false;
+    }
+
+    const size_t inlineSlot = findInlineSlot(jobId);
+    if (inlineSlot != kNotQueued) {
+        InlineJob& job = m_inlineJobs[inlineSlot];
+        job.paused = false;
+        // A job resumed from its own callback is re-queued once the callback returns.
+        if (job.queuePos == kNotQueued && inlineSlot != m_inFlightInline) {
+            queueInlineJob(inlineSlot);
+        }
+        trace(SchedulerTraceEvent::JobResumed, jobId);
+        return true;
+    }
+    const size_t workerSlot = findWorkerSlot(jobId);
+    if (workerSlot != kNotQueued) {
+        WorkerJob& job = m_workerJobs[workerSlot];
+        job.context->paused.store(false);
+        if (m_workerPool && !job.task) {
+            m_workerPool->lock();
+            m_workerPool->rearm(job.context);
+            m_workerPool->unlock();
+        }
+        wakeWorker(job);
+        trace(SchedulerTraceEvent::JobResumed, jobId);
+        return true;
+    }
+    return false;
+}
+
+void ESPScheduler::cancelAll() {
+    if (!isInitialized()) {
+        return;
+    }
+
+    for (size_t i = 0; i < m_workerJobs.size(); ++i) {
+        if (m_workerJobs[i].context) {
+            cancelWorker(m_workerJobs[i]);
+            releaseWorkerSlot(i);
+        }
+    }
+
+    for (size_t i = 0; i < m_inlineJobs.size(); ++i) {
+        if (!m_inlineJobs[i].live || m_inlineJobs[i].finished) {
+            continue;
+        }
+        if (m_dispatchingInline) {
+            finishInlineJob(i);
+        } else {
+            removeInlineJobAt(i);
+        }
+    }
+}
+
+uint32_t ESPScheduler::postJob(const Schedule& schedule,
+                               SchedulerJobMode mode,
+                               SchedulerCallback cb,
+                               void* userData,
+                               const SchedulerTaskConfig* taskCfg) {
+    return postJob(schedule, mode, SchedulerCallable(cb, userData), taskCfg);
+}
+
+uint32_t ESPScheduler::postJob(const Schedule& schedule,
+                               SchedulerJobMode mode,
+                               SchedulerCallable cb,
+                               const SchedulerTaskConfig* taskCfg) {
+    return postJob(schedule, JobOptions{}, mode, std::move(cb), taskCfg);
+}
+
+uint32_t ESPScheduler::postJob(const Schedule& schedule,
+                               const JobOptions& options,
+                               SchedulerJobMode mode,
+                               SchedulerCallable cb,
+                               const SchedulerTaskConfig* taskCfg) {
+    const uint32_t id = postAdd(schedule, options, mode, std::move(cb), taskCfg, false);
+    if (id != 0) {
+        wakeTickTask();
+    }
+    return id;
+}
+
+// Lock-free and allocation-free for inline callables, so ISRs can use it too.
+uint32_t ESPScheduler::postAdd(const Schedule& schedule,
+                               const JobOptions& options,
+                               SchedulerJobMode mode,
+                               SchedulerCallable cb,
+                               const SchedulerTaskConfig* taskCfg,
+                               bool runNow) {
+    if (!cb || !isInitialized() || !validateSchedule(schedule) || !fixedCapacityAllows(options)) {
+        return 0;
+    }
+    SchedulerRing<uint32_t>& ids = mode == SchedulerJobMode::Inline ? m_postedInlineIds : m_postedWorkerIds;
+    uint32_t id = 0;
+    if (!ids.pop(id)) {
+        return 0;
+    }
+
+    Command command{};
+    command.op = CommandOp::Add;
+    command.jobId = id;
+    command.mode = mode;
+    command.runNow = runNow;
+    command.schedule = schedule;
+    command.options = options;
+    command.callback = std::move(cb);
+    if (taskCfg) {
+        command.hasTaskConfig = true;
+        command.taskConfig = *taskCfg;
+    }
+    if (!m_commands.push(std::move(command))) {
+        ids.push(std::move(id));  // hand the reservation back for the next poster
+        return 0;
+    }
+    return id;
+}
+
+bool ESPScheduler::postCancel(uint32_t jobId) {
+    const bool posted = postCommand(CommandOp::Cancel, jobId);
+    if (posted) {
+        wakeTickTask();
+    }
+    return posted;
+}
+
+bool ESPScheduler::postPause(uint32_t jobId) {
+    const bool posted = postCommand(CommandOp::Pause, jobId);
+    if (posted) {
+        wakeTickTask();
+    }
+    return posted;
+}
+
+bool ESPScheduler::postResume(uint32_t jobId) {
+    const bool posted = postCommand(CommandOp::Resume, jobId);
+    if (posted) {
+        wakeTickTask();
+    }
+    return posted;
+}
+
+bool ESPScheduler::postTrigger(uint32_t jobId) {
+    const bool posted = postCommand(CommandOp::Trigger, jobId);
+    if (posted) {
+        wakeTickTask();
+    }
+    return posted;
+}
+
+bool ESPScheduler::triggerNowFromISR(uint32_t jobId, BaseType_t* higherPriorityTaskWoken) {
+    if (!postCommand(CommandOp::Trigger, jobId)) {
+        return false;
+    }
+    wakeTickTaskFromISR(higherPriorityTaskWoken);
+    return true;
+}
+
+uint32_t ESPScheduler::postJobFromISR(const Schedule& schedule,
+                                      SchedulerJobMode mode,
+                                      SchedulerCallback cb,
+                                      void* userData,
+                                      BaseType_t* higherPriorityTaskWoken) {
+    const uint32_t id = postAdd(schedule, JobOptions{}, mode, SchedulerCallable(cb, userData), nullptr, false);
+    if (id != 0) {
+        wakeTickTaskFromISR(higherPriorityTaskWoken);
+    }
+    return id;
+}
+
+uint32_t ESPScheduler::runOnceFromISR(SchedulerJobMode mode,
+                                      SchedulerCallback cb,
+                                      void* userData,
+                                      BaseType_t* higherPriorityTaskWoken) {
+    // A one-shot in the past would also wait for a valid clock; runNow does not.
+    const uint32_t id =
+        postAdd(Schedule::onceUtc(DateTime{}), JobOptions{}, mode, SchedulerCallable(cb, userData), nullptr, true);
+    if (id != 0) {
+        wakeTickTaskFromISR(higherPriorityTaskWoken);
+    }
+    return id;
+}
+
+void ESPScheduler::wakeTickTask() {
+    TaskHandle_t task = m_tickTaskRef->load(std::memory_order_relaxed);
+    if (task) {
+        xTaskNotifyGive(task);
+    }
+}
+
+void ESPScheduler::wakeTickTaskFromISR(BaseType_t* higherPriorityTaskWoken) {
+    TaskHandle_t task = m_tickTaskRef->load(std::memory_order_relaxed);
+    if (!task) {
+        return;
+    }
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(task, &woken);
+    if (higherPriorityTaskWoken) {
+        *higherPriorityTaskWoken = *higherPriorityTaskWoken || woken ? pdTRUE : pdFALSE;
+    } else if (woken == pdTRUE) {
+        portYIELD_FROM_ISR(woken);
+    }
+}
+
+void ESPScheduler::waitForWork(uint32_t maxWaitMs) {
+    m_tickTaskRef->store(xTaskGetCurrentTaskHandle(), std::memory_order_relaxed);
+    int64_t waitMs = maxWaitMs;
+    if (!m_triggeredInline.empty() || !m_readyQueue.empty() || m_completionsRef->load() != m_completionsSeen) {
+        return;
+    }
+    if (!m_intervalQueue.empty()) {
+        const int64_t untilUs = m_intervalQueue.front().due - esp_timer_get_time();
+        waitMs = std::min<int64_t>(waitMs, untilUs <= 0 ? 0 : (untilUs + 999) / 1000);
+    }
+    if (!m_inlineQueue.empty()) {
+        const DateTime now = m_date.now();
+        // While the clock is invalid, calendar deadlines cannot fire; just sleep maxWaitMs.
+        if (clockValid(now)) {
+            const int64_t due = m_inlineQueue.front().due;
+            const int64_t untilSec = due == kUnresolvedDeadline ? 0 : due - now.epochSeconds;
+            waitMs = std::min<int64_t>(waitMs, untilSec <= 0 ? 0 : untilSec * 1000);
+        }
+    }
+    if (waitMs > 0) {
+        waitForWakeMs(waitMs);
+    }
+}
+
+bool ESPScheduler::postCommand(CommandOp op, uint32_t jobId) {
+    if (jobId == 0 || !isInitialized()) {
+        return false;
+    }
+    Command command{};
+    command.op = op;
+    command.jobId = jobId;
+    return m_commands.push(std::move(command));
+}
+
+void ESPScheduler::initCommandQueue() {
+    if (m_commandQueueSize == 0) {
+        return;
+    }
+    m_commands.init(m_commandQueueSize);
+    m_postedInlineIds.init(m_commandQueueSize);
+    m_postedWorkerIds.init(m_commandQueueSize);
+    m_reservedInlineIds = 0;
+    m_reservedWorkerIds = 0;
+}
+
+// Runs on the tick() caller before any dispatch, so commands see a quiet job table.
+void ESPScheduler::drainCommands() {
+    if (!m_commands.enabled() || m_dispatchingInline) {
+        return;
+    }
+    Command command{};
+    while (m_commands.pop(command)) {
+        switch (command.op) {
+            case CommandOp::Add:
+                applyPostedAdd(command);
+                break;
+            case CommandOp::Cancel:
+                cancelJob(command.jobId);
+                break;
+            case CommandOp::Pause:
+                pauseJob(command.jobId);
+                break;
+            case CommandOp::Resume:
+                resumeJob(command.jobId);
+                break;
+            case CommandOp::Trigger:
+                triggerJob(command.jobId);
+                break;
+        }
+        command.callback.reset();
+        if (!isInitialized()) {
+            return;
+        }
+    }
+    refillPostedIds();
+}
+
+void ESPScheduler::applyPostedAdd(Command& command) {
+    const size_t slot = command.jobId & (kMaxJobSlots - 1);
+    const SchedulerTaskConfig* taskCfg = command.hasTaskConfig ? &command.taskConfig : nullptr;
+    if (command.mode == SchedulerJobMode::Inline) {
+        --m_reservedInlineIds;
+    } else {
+        --m_reservedWorkerIds;
+    }
+    const uint32_t id =
+        installJob(slot, command.schedule, command.options, command.mode, std::move(command.callback), taskCfg);
+    if (id != 0 && command.runNow) {
+        triggerJob(id);
+    }
+}
+
+void ESPScheduler::triggerJob(uint32_t jobId) {
+    const size_t inlineSlot = findInlineSlot(jobId);
+    if (inlineSlot != kNotQueued) {
+        InlineJob& job = m_inlineJobs[inlineSlot];
+        trace(SchedulerTraceEvent::JobTriggered, jobId);
+        if (!job.paused && !job.triggered) {
+            job.triggered = true;
+            m_triggeredInline.push_back(inlineSlot);
+        }
+        return;
+    }
+    const size_t workerSlot = findWorkerSlot(jobId);
+    if (workerSlot == kNotQueued) {
+        return;
+    }
+    WorkerJob& job = m_workerJobs[workerSlot];
+    trace(SchedulerTraceEvent::JobTriggered, jobId);
+    if (job.task) {
+        job.context->triggered.store(true);
+        wakeWorker(job);
+    } else if (m_workerPool) {
+        m_workerPool->lock();
+        m_workerPool->trigger(job.context);
+        m_workerPool->unlock();
+    }
+}
+
+// Triggered jobs run once on top of their schedule; their queued deadline stays put.
+// Shares tick()'s budget with dispatchReadyJobs(): false when it ran out with triggered
+// jobs left, which keep their order for the next call.
+bool ESPScheduler::dispatchTriggeredJobs(const DateTime& nowUtc, int64_t startUs, uint32_t budgetMicros,
+                                         bool& ranOne) {
+    if (m_triggeredInline.empty()) {
+        return true;
+    }
+    m_dispatchingInline = true;
+    size_t i = 0;
+    for (; i < m_triggeredInline.size(); ++i) {
+        if (budgetMicros > 0 && ranOne && esp_timer_get_time() - startUs >= budgetMicros) {
+            break;
+        }
+        const size_t index = m_triggeredInline[i];
+        InlineJob& job = m_inlineJobs[index];
+        job.triggered = false;
+        if (!job.live || job.finished || job.paused) {
+            continue;
+        }
+        traceTriggered(m_trace, job.id, SchedulerTraceRunner::Inline);
+        if (!invokeInlineJob(index, statsClockUs(), nowUtc)) {
+            m_dispatchingInline = false;
+            return true;  // deinit() ran inside the callback and dropped the list
+        }
+        ranOne = true;
+        InlineJob& ran = m_inlineJobs[index];
+        if (!ran.finished && scheduleOf(ran).isOneShot) {
+            finishInlineJob(index);
+        }
+    }
+    m_triggeredInline.erase(m_triggeredInline.begin(), m_triggeredInline.begin() + static_cast<ptrdiff_t>(i));
+    m_dispatchingInline = false;
+    return m_triggeredInline.empty();
+}
+
+// Live as far as dependencies go: not cancelled and with runs still to make.
+bool ESPScheduler::jobExists(uint32_t jobId) const {
+    if (findInlineSlot(jobId) != kNotQueued) {
+        return true;
+    }
+    const size_t workerSlot = findWorkerSlot(jobId);
+    if (workerSlot == kNotQueued) {
+        return false;
+    }
+    const WorkerJobContext& ctx = *m_workerJobs[workerSlot].context;
+    return !ctx.finished.load() && !ctx.cancelRequested.load();
+}
+
+void ESPScheduler::noteInlineCompletion(uint32_t jobId) {
+    for (JobDependency& dependency : m_dependencies) {
+        for (uint8_t i = 0; i < dependency.count; ++i) {
+            if (dependency.predecessors[i] == jobId) {
+                dependency.doneMask = static_cast<uint8_t>(dependency.doneMask | (1u << i));
+            }
+        }
+    }
+    settleDependencies();
+}
+
+// Worker jobs only publish a run count; a count that moved since the last look is a
+// completion, however many runs it covers.
+void ESPScheduler::collectWorkerCompletions() {
+    const uint32_t completions = m_completionsRef->load();
+    if (completions == m_completionsSeen) {
+        return;
+    }
+    m_completionsSeen = completions;
+    for (JobDependency& dependency : m_dependencies) {
+        for (uint8_t i = 0; i < dependency.count; ++i) {
+            const size_t workerSlot = findWorkerSlot(dependency.predecessors[i]);
+            if (workerSlot == kNotQueued) {
+                continue;
+            }
+            const uint32_t runs = m_workerJobs[workerSlot].context->completedRuns.load();
+            if (runs != dependency.seenRuns[i]) {
+                dependency.seenRuns[i] = runs;
+                dependency.doneMask = static_cast<uint8_t>(dependency.doneMask | (1u << i));
+            }
+        }
+    }
+    settleDependencies();
+}
+
+// A cancelled predecessor leaves the slot table at once, before collectWorkerCompletions()
+// sees its count, so runs it finished are folded in here first.
+void ESPScheduler::collectWorkerRuns(const WorkerJob& job) {
+    const uint32_t runs = job.context->completedRuns.load();
+    for (JobDependency& dependency : m_dependencies) {
+        for (uint8_t i = 0; i < dependency.count; ++i) {
+            if (dependency.predecessors[i] == job.id && runs != dependency.seenRuns[i]) {
+                dependency.seenRuns[i] = runs;
+                dependency.doneMask = static_cast<uint8_t>(dependency.doneMask | (1u << i));
+            }
+        }
+    }
+}
+
+// Triggers every job whose predecessors have all completed. A predecessor that is
+// gone stops gating its dependent, though a run it completed first still counts; a
+// dependency whose job is gone, or that has no predecessors left, is dropped.
+void ESPScheduler::settleDependencies() {
+    size_t kept = 0;
+    for (size_t d = 0; d < m_dependencies.size(); ++d) {
+        JobDependency dependency = m_dependencies[d];
+        if (!jobExists(dependency.jobId)) {
+            continue;
+        }
+        uint8_t edges = 0;
+        uint8_t doneMask = 0;
+        for (uint8_t i = 0; i < dependency.count; ++i) {
+            const bool done = (dependency.doneMask & (1u << i)) != 0;
+            if (!done && !jobExists(dependency.predecessors[i])) {
+                continue;
+            }
+            dependency.predecessors[edges] = dependency.predecessors[i];
+            dependency.seenRuns[edges] = dependency.seenRuns[i];
+            if (done) {
+                doneMask = static_cast<uint8_t>(doneMask | (1u << edges));
+            }
+            ++edges;
+        }
+        if (edges == 0) {
+            continue;
+        }
+        dependency.count = edges;
+        dependency.doneMask = doneMask;
+        if (doneMask == static_cast<uint8_t>((1u << edges) - 1)) {
+            dependency.doneMask = 0;
+            triggerJob(dependency.jobId);
+        }
+        m_dependencies[kept++] = dependency;
+    }
+    m_dependencies.resize(kept);
+}
+
+// Keeps one reserved id per command slot and mode, so a poster never touches the job table.
+void ESPScheduler::refillPostedIds() {
+    const size_t target = m_commands.capacity();
+    while (m_reservedInlineIds < target) {
+        const size_t slot = m_fixedJobCapacity > 0 ? acquirePostedSlot() : acquireInlineSlot();
+        if (slot == kNotQueued) {
+            break;
+        }
+        InlineJob& job = m_inlineJobs[slot];
+        job.id = makeJobId(slot, job.generation, false);
+        uint32_t id = job.id;
+        m_postedInlineIds.push(std::move(id));
+        ++m_reservedInlineIds;
+    }
+    while (m_fixedJobCapacity == 0 && m_reservedWorkerIds < target) {
+        const size_t slot = acquireWorkerSlot();
+        if (slot == kNotQueued) {
+            break;
+        }
+        WorkerJob& job = m_workerJobs[slot];
+        job.id = makeJobId(slot, job.generation, true);
+        uint32_t id = job.id;
+        m_postedWorkerIds.push(std::move(id));
+        ++m_reservedWorkerIds;
+    }
+}
+
+uint32_t ESPScheduler::makeJobId(size_t slot, uint16_t generation, bool worker) {
+    return (static_cast<uint32_t>(generation & kJobGenerationMask) << kJobGenerationShift) |
+           (worker ? kJobWorkerFlag : 0) | static_cast<uint32_t>(slot);
+}
+
+// Generations cycle through 1..0x7FFF so an id is never 0.
+uint16_t ESPScheduler::nextGeneration(uint16_t generation) {
+    return static_cast<uint16_t>((generation & kJobGenerationMask) % kJobGenerationMask + 1);
+}
+
+size_t ESPScheduler::findInlineSlot(uint32_t jobId) const {
+    const size_t slot = jobId & (kMaxJobSlots - 1);
+    if ((jobId & kJobWorkerFlag) != 0 || slot >= m_inlineJobs.size()) {
+        return kNotQueued;
+    }
+    const InlineJob& job = m_inlineJobs[slot];
+    return job.live && !job.finished && job.id == jobId ? slot : kNotQueued;
+}
+
+size_t ESPScheduler::findWorkerSlot(uint32_t jobId) const {
+    const size_t slot = jobId & (kMaxJobSlots - 1);
+    if ((jobId & kJobWorkerFlag) == 0 || slot >= m_workerJobs.size()) {
+        return kNotQueued;
+    }
+    const WorkerJob& job = m_workerJobs[slot];
+    return job.context && job.id == jobId ? slot : kNotQueued;
+}
+
+size_t ESPScheduler::acquireInlineSlot() {
+    if (!m_freeInlineSlots.empty()) {
+        const size_t slot = m_freeInlineSlots.back();
+        m_freeInlineSlots.pop_back();
+        return slot;
+    }
+    const size_t limit = m_fixedJobCapacity > 0 ? m_fixedJobCapacity : kMaxJobSlots;
+    if (m_inlineJobs.size() >= limit) {
+        return kNotQueued;
+    }
+    m_inlineJobs.emplace_back();
+    return m_inlineJobs.size() - 1;
+}
+
+size_t ESPScheduler::acquirePostedSlot() {
+    if (m_freePostedSlots.empty()) {
+        return kNotQueued;
+    }
+    const size_t slot = m_freePostedSlots.back();
+    m_freePostedSlots.pop_back();
+    return slot;
+}
+
+size_t ESPScheduler::acquireWorkerSlot() {
+    if (!m_freeWorkerSlots.empty()) {
+        const size_t slot = m_freeWorkerSlots.back();
+        m_freeWorkerSlots.pop_back();
+        return slot;
+    }
+    if (m_workerJobs.size() >= kMaxJobSlots) {
+        return kNotQueued;
+    }
+    m_workerJobs.emplace_back();
+    return m_workerJobs.size() - 1;
+}
+
+void ESPScheduler::releaseWorkerSlot(size_t slot) {
+    WorkerJob& job = m_workerJobs[slot];
+    const uint16_t generation = nextGeneration(job.generation);
+    job = WorkerJob{};
+    job.generation = generation;
+    m_freeWorkerSlots.push_back(slot);
+}
+
+void ESPScheduler::tick() { tick(m_date.now()); }
+
+void ESPScheduler::tick(const DateTime& nowUtc) { tick(nowUtc, 0); }
+
+bool ESPScheduler::tick(const DateTime& nowUtc, uint32_t budgetMicros) {
+    if (!isInitialized()) {
+        return false;
+    }
+
+    const int64_t startUs = esp_timer_get_time();
+    m_tickTaskRef->store(xTaskGetCurrentTaskHandle(), std::memory_order_relaxed);
+    drainCommands();
+    collectWorkerCompletions();
+    bool ranOne = false;
+    bool drained = dispatchTriggeredJobs(nowUtc, startUs, budgetMicros, ranOne);
+
+    // Interval jobs run on the monotonic clock, so the wall-clock guard does not hold them.
+    promoteIntervalJobs();
+    const bool valid = clockValid(nowUtc);
+    if (!valid && !m_traceClockInvalid) {
+        trace(SchedulerTraceEvent::ClockInvalid, 0, nowUtc.epochSeconds, traceRunner(SchedulerTraceRunner::Inline));
+    }
+    m_traceClockInvalid = !valid;
+    if (!valid) {
+        m_clockWatch.reset();
+    }
+    if (isInitialized() && valid) {
+        watchClock(nowUtc);
+        promoteCalendarJobs(nowUtc);
+    }
+    drained = (!isInitialized() || dispatchReadyJobs(nowUtc, startUs, budgetMicros, ranOne)) && drained;
+    if (drained && isInitialized()) {
+        drained = dispatchTriggeredJobs(nowUtc, startUs, budgetMicros, ranOne);  // dependents of the jobs that just ran
+    }
+
+    cleanupInline();
+    const uint32_t exitedWorkers = m_exitedWorkersRef->load();
+    if (exitedWorkers != m_exitedWorkersSeen) {
+        m_exitedWorkersSeen = exitedWorkers;
+        cleanupWorkers();
+    }
+    return !drained;
 }
 
-uint32_t ESPScheduler::addJobOnceUtc(const DateTime& whenUtc,
-                                     SchedulerJobMode mode,
-                                     SchedulerFunctionNoData cb,
-                                     const SchedulerTaskConfig* taskCfg) {
-    if (!cb) {
-        return 0;
+void ESPScheduler::watchClock(const DateTime& nowUtc) {
+    const int64_t stepSeconds = m_clockWatch.observe(nowUtc.epochSeconds, esp_timer_get_time());
+    if (m_clockStepThresholdSeconds > 0) {
+        const bool timeZoneChanged = m_clockWatch.timeZoneChanged();
+        if (timeZoneChanged || std::abs(stepSeconds) > static_cast<int64_t>(m_clockStepThresholdSeconds)) {
+            notifyClockChanged();
+        }
+    }
+    const uint32_t generation = m_clockGenerationRef->load();
+    if (generation == m_clockGenerationSeen) {
+        return;
     }
-    SchedulerFunction wrapped = [fn = std::move(cb)](void*) { fn(); };
-    return addJobOnceUtc(whenUtc, mode, std::move(wrapped), nullptr, taskCfg);
+    m_clockGenerationSeen = generation;
+    trace(SchedulerTraceEvent::ClockStepped, 0, stepSeconds, traceRunner(SchedulerTraceRunner::Inline));
+    rescheduleInlineCalendarJobs(rescheduleAfterUtc(nowUtc.epochSeconds, stepSeconds));
 }
 
-uint32_t ESPScheduler::addJob(const Schedule& schedule,
-                              SchedulerJobMode mode,
-                              SchedulerCallback cb,
-                              void* userData,
-                              const SchedulerTaskConfig* taskCfg) {
-    return addJob(schedule, mode, SchedulerFunction(cb), userData, taskCfg);
+// Deadlines later than afterUtc (paused jobs included) are recomputed in one pass;
+// earlier ones are left for dispatch so the misfire policy decides.
+void ESPScheduler::rescheduleInlineCalendarJobs(int64_t afterUtc) {
+    m_localTimeCache.revalidate();
+    for (size_t index = 0; index < m_inlineJobs.size(); ++index) {
+        InlineJob& job = m_inlineJobs[index];
+        if (!job.live || job.finished || !job.hasNext || scheduleOf(job).isInterval() || scheduleOf(job).isOneShot ||
+            job.nextRunUtc.epochSeconds <= afterUtc) {
+            continue;
+        }
+        job.cursor = ScheduleCursor::startingAt(dateTimeFromEpoch(afterUtc + 1));
+        job.hasNext =
+            m_occurrences.advance(scheduleOf(job), job.splayOffset, job.cursor, m_localTimeCache, job.nextRunUtc);
+        if (job.ready) {  // was due before the step; no longer
+            queueRemove(m_readyQueue, job.queuePos);
+            queueInlineJob(index);
+        } else if (job.queuePos != kNotQueued) {
+            queueUpdate(m_inlineQueue, job.queuePos, job.hasNext ? job.nextRunUtc.epochSeconds : kUnresolvedDeadline);
+        }
+    }
 }
 
-uint32_t ESPScheduler::addJob(const Schedule& schedule,
-                              SchedulerJobMode mode,
-                              SchedulerFunction cb,
-                              void* userData,
-                              const SchedulerTaskConfig* taskCfg) {
-    if (!cb) {
-        return 0;
+void ESPScheduler::promoteCalendarJobs(const DateTime& nowUtc) {
+    // Idle ticks stop at the first comparison: the queue front is the earliest deadline.
+    if (m_inlineQueue.empty() || m_inlineQueue.front().due > nowUtc.epochSeconds) {
+        return;
+    }
+    m_localTimeCache.revalidate();
+    while (!m_inlineQueue.empty() && m_inlineQueue.front().due <= nowUtc.epochSeconds) {
+        const size_t index = m_inlineQueue.front().jobIndex;
+        InlineJob& job = m_inlineJobs[index];
+        if (job.hasNext) {
+            queueRemove(m_inlineQueue, job.queuePos);
+            pushReady(index);
+            continue;
+        }
+        if (scheduleOf(job).isOneShot) {
+            job.nextRunUtc = scheduleOf(job).onceAtUtc;
+            job.hasNext = true;
+        } else {
+            job.cursor = ScheduleCursor::startingAt(nowUtc);
+            job.hasNext =
+                m_occurrences.advance(scheduleOf(job), job.splayOffset, job.cursor, m_localTimeCache, job.nextRunUtc);
+            if (!job.hasNext) {
+                finishInlineJob(index);
+                continue;
+            }
+        }
+        queueUpdate(m_inlineQueue, job.queuePos, job.nextRunUtc.epochSeconds);
+    }
+}
+
+void ESPScheduler::promoteIntervalJobs() {
+    if (m_intervalQueue.empty()) {
+        return;
+    }
+    const int64_t nowUs = esp_timer_get_time();
+    while (!m_intervalQueue.empty() && m_intervalQueue.front().due <= nowUs) {
+        const size_t index = m_intervalQueue.front().jobIndex;
+        queueRemove(m_intervalQueue, 0);
+        pushReady(index);
+    }
+}
+
+// Ready jobs run highest priority first, then in the order they came due.
+void ESPScheduler::pushReady(size_t jobIndex) {
+    InlineJob& job = m_inlineJobs[jobIndex];
+    job.ready = true;
+    const int64_t rank = static_cast<int64_t>(UINT8_MAX - job.options.priority) << kReadyRankShift;
+    queuePush(m_readyQueue, jobIndex, rank | (m_readySequence++ & kReadySequenceMask));
+}
+
+// False when the budget ran out with due jobs left in m_readyQueue. A budget of 0 runs
+// everything; otherwise at least one job per tick() runs so a short budget still makes
+// progress. ranOne is shared with dispatchTriggeredJobs() for that.
+bool ESPScheduler::dispatchReadyJobs(const DateTime& nowUtc, int64_t startUs, uint32_t budgetMicros, bool& ranOne) {
+    if (m_readyQueue.empty()) {
+        return true;
+    }
+    m_localTimeCache.revalidate();
+    // Calendar deadlines are whole seconds; map them onto esp_timer time once for lateness stats and trace.
+    const int64_t nowUs = esp_timer_get_time();
+    m_dispatchingInline = true;
+    while (!m_readyQueue.empty()) {
+        if (budgetMicros > 0 && ranOne && esp_timer_get_time() - startUs >= budgetMicros) {
+            break;
+        }
+        const size_t index = m_readyQueue.front().jobIndex;
+        queueRemove(m_readyQueue, 0);
+        const bool alive = scheduleOf(m_inlineJobs[index]).isInterval() ? runReadyIntervalJob(index, nowUtc)
+                                                                         : runReadyCalendarJob(index, nowUtc, nowUs);
+        if (!alive) {
+            break;  // deinit() ran inside the callback
+        }
+        ranOne = true;
+    }
+    m_dispatchingInline = false;
+    return m_readyQueue.empty();
+}
+
+// False if deinit() ran inside the callback.
+bool ESPScheduler::runReadyCalendarJob(size_t index, const DateTime& nowUtc, int64_t nowUs) {
+    InlineJob& job = m_inlineJobs[index];
+    const int64_t dueUs = nowUs - (nowUtc.epochSeconds - job.nextRunUtc.epochSeconds) * 1000000;
+    const MisfireDecision misfire =
+        resolveMisfire(scheduleOf(job), job.options, job.cursor, m_localTimeCache, job.nextRunUtc, nowUtc);
+    job.stats.recordMissed(misfire.missed);
+    for (uint32_t run = 0; run < misfire.runs; ++run) {
+        traceDispatch(m_trace, m_inlineJobs[index].id, SchedulerTraceRunner::Inline, dueUs);
+        if (!invokeInlineJob(index, dueUs, nowUtc)) {
+            return false;
+        }
+        if (m_inlineJobs[index].finished) {
+            break;
+        }
+    }
+    InlineJob& ran = m_inlineJobs[index];
+    if (ran.finished) {
+        return true;
+    }
+    if (scheduleOf(ran).isOneShot) {
+        finishInlineJob(index);
+        return true;
+    }
+    ran.hasNext = misfire.movedOn ? misfire.hasNext
+                                  : m_occurrences.advance(scheduleOf(ran), ran.splayOffset, ran.cursor,
+                                                          m_localTimeCache, ran.nextRunUtc);
+    traceCalendarReschedule(m_trace, ran.id, ran.hasNext, ran.nextRunUtc, nowUtc);
+    if (!ran.hasNext) {
+        finishInlineJob(index);
+        return true;
+    }
+    if (ran.nextRunUtc.epochSeconds <= nowUtc.epochSeconds) {
+        ran.stats.recordOverrun();
+    }
+    if (!ran.paused) {
+        // Back on the deadline heap even when still due: promoteCalendarJobs() has run for
+        // this tick, so a job that is behind catches up one occurrence per tick.
+        queueInlineJob(index);
+    }
+    return true;
+}
+
+bool ESPScheduler::runReadyIntervalJob(size_t index, const DateTime& nowUtc) {
+    const int64_t dueUs = m_inlineJobs[index].nextDueUs;
+    traceDispatch(m_trace, m_inlineJobs[index].id, SchedulerTraceRunner::Inline, dueUs);
+    if (!invokeInlineJob(index, dueUs, nowUtc)) {
+        return false;
+    }
+    InlineJob& ran = m_inlineJobs[index];
+    if (ran.finished) {
+        return true;
+    }
+    uint32_t skipped = 0;
+    ran.nextDueUs = nextIntervalDueUs(scheduleOf(ran), dueUs, esp_timer_get_time(), &skipped);
+    recordIntervalRun(ran.stats, skipped);
+    traceIntervalReschedule(m_trace, ran.id, ran.nextDueUs);
+    if (!ran.paused) {
+        queueInlineJob(index);
+    }
+    return true;
+}
+
+// The callback may add jobs and grow m_inlineJobs, so it runs from a local and
+// the job is re-fetched by index afterwards. False if deinit() ran inside it.
+// dueUs is the deadline on the esp_timer clock, used for the lateness stats.
+bool ESPScheduler::invokeInlineJob(size_t jobIndex, int64_t dueUs, const DateTime& nowUtc) {
+    InlineJob& job = m_inlineJobs[jobIndex];
+    SchedulerCallable callback = std::move(job.callback);
+    m_inFlightInline = jobIndex;
+    const int64_t startUs = statsClockUs();
+    callback();
+    const int64_t endUs = statsClockUs();
+    m_inFlightInline = kNotQueued;
+
+    if (!isInitialized() || jobIndex >= m_inlineJobs.size()) {
+        return false;
+    }
+    InlineJob& ran = m_inlineJobs[jobIndex];
+    ran.callback = std::move(callback);
+    ran.stats.recordRun(startUs, endUs, startUs - dueUs, nowUtc.epochSeconds);
+    ran.lastRunUtc = nowUtc.epochSeconds;
+    if (ran.hasDependents) {
+        noteInlineCompletion(ran.id);
+    }
+    return true;
+}
+
+void ESPScheduler::cleanup() {
+    if (!isInitialized()) {
+        return;
+    }
+
+    drainCommands();
+    cleanupInline();
+    cleanupWorkers();
+}
+
+bool ESPScheduler::getJobInfo(size_t index, JobInfo& out) const {
+    if (!isInitialized()) {
+        out = JobInfo{};
+        return false;
+    }
+
+    out = JobInfo{};
+    size_t current = 0;
+    auto fillNext = [this](const Schedule& schedule, uint32_t splayOffset, bool hasNext, const DateTime& storedNext,
+                           DateTime& outNext) {
+        if (hasNext) {
+            outNext = storedNext;
+            return;
+        }
+        if (schedule.isOneShot) {
+            outNext = schedule.onceAtUtc;
+            return;
+        }
+        SchedulerLocalTimeCache localTime;
+        localTime.revalidate();
+        DateTime computed{};
+        if (computeNextOccurrenceForSchedule(schedule, splayOffset, m_date.now(), localTime, computed)) {
+            outNext = computed;
+        } else {
+            outNext = {};
+        }
+    };
+
+    for (const auto& job : m_inlineJobs) {
+        if (!job.live || job.finished) {
+            continue;
+        }
+        if (current == index) {
+            out.id = job.id;
+            out.enabled = !job.paused;
+            out.mode = SchedulerJobMode::Inline;
+            out.schedule = scheduleOf(job);
+            out.options = job.options;
+            job.stats.read(out.stats);
+            if (scheduleOf(job).isInterval()) {
+                out.nextRunUtc = intervalDueToUtc(job.nextDueUs, m_date.now());
+            } else {
+                fillNext(scheduleOf(job), job.splayOffset, job.hasNext, job.nextRunUtc, out.nextRunUtc);
+            }
+            return true;
+        }
+        ++current;
+    }
+
+    for (const auto& job : m_workerJobs) {
+        if (!job.context) {
+            continue;
+        }
+        if (job.context->cancelRequested.load() || job.context->finished.load()) {
+            continue;
+        }
+        if (current == index) {
+            out.id = job.id;
+            out.enabled = !job.context->paused.load();
+            out.mode = SchedulerJobMode::WorkerTask;
+            out.schedule = job.context->schedule;
+            out.options = job.context->options;
+            job.context->stats.read(out.stats);
+            if (job.context->schedule.isInterval()) {
+                out.nextRunUtc = intervalDueToUtc(job.context->nextDueUs.load(), m_date.now());
+            } else if (job.task) {
+                // The worker task owns nextRunUtc; read the copy it publishes.
+                const int64_t next = job.context->publishedNextUtc.load();
+                fillNext(job.context->schedule, job.context->splayOffset, next != kUnresolvedDeadline,
+                         dateTimeFromEpoch(next), out.nextRunUtc);
+            } else {
+                m_workerPool->lock();
+                const bool hasNext = job.context->hasNext;
+                const DateTime next = job.context->nextRunUtc;
+                m_workerPool->unlock();
+                fillNext(job.context->schedule, job.context->splayOffset, hasNext, next, out.nextRunUtc);
+            }
+            return true;
+        }
+        ++current;
     }
-    if (!validateSchedule(schedule)) {
+
+    return false;
+}
+
+size_t ESPScheduler::forEachJob(JobVisitor visitor, void* userData) const {
+    if (!visitor || !isInitialized()) {
         return 0;
     }
-    ensureInitialized();
-    const uint32_t id = nextId();
+    // Only interval jobs need the wall clock, to place their esp_timer deadline; read it once.
+    DateTime now{};
+    bool haveNow = false;
+    auto intervalNext = [&](int64_t dueUs) {
+        if (!haveNow) {
+            now = m_date.now();
+            haveNow = true;
+        }
+        return intervalDueToUtc(dueUs, now);
+    };
+    auto fillNext = [](const Schedule& schedule, bool hasNext, const DateTime& storedNext, JobSummary& out) {
+        if (hasNext) {
+            out.hasNext = true;
+            out.nextRunUtc = storedNext;
+        } else if (schedule.isOneShot) {
+            out.hasNext = true;
+            out.nextRunUtc = schedule.onceAtUtc;
+        }
+    };
 
-    if (mode == SchedulerJobMode::Inline) {
-        InlineJob job{};
-        job.id = id;
-        job.schedule = schedule;
-        job.callback = std::move(cb);
-        job.userData = userData;
-        m_inlineJobs.push_back(job);
-        return id;
+    size_t visited = 0;
+    for (const auto& job : m_inlineJobs) {
+        if (!job.live || job.finished) {
+            continue;
+        }
+        JobSummary summary;
+        summary.id = job.id;
+        summary.persistKey = job.options.persistKey;
+        summary.mode = SchedulerJobMode::Inline;
+        summary.enabled = !job.paused;
+        summary.lastRunUtc = job.lastRunUtc;
+        if (scheduleOf(job).isInterval()) {
+            summary.hasNext = true;
+            summary.nextRunUtc = intervalNext(job.nextDueUs);
+        } else {
+            fillNext(scheduleOf(job), job.hasNext, job.nextRunUtc, summary);
+        }
+        ++visited;
+        if (!visitor(summary, userData)) {
+            return visited;
+        }
     }
 
-    auto ctx = std::allocate_shared<WorkerJobContext>(SchedulerAllocator<WorkerJobContext>(usePSRAMBuffers_));
-    ctx->schedule = schedule;
-    ctx->callback = std::move(cb);
-    ctx->userData = userData;
-    ctx->date = &m_date;
-    ctx->minValidEpochSeconds = m_minValidEpochSecondsRef;
+    for (const auto& job : m_workerJobs) {
+        if (!job.context || job.context->cancelRequested.load() || job.context->finished.load()) {
+            continue;
+        }
+        const WorkerJobContext& ctx = *job.context;
+        JobSummary summary;
+        summary.id = job.id;
+        summary.persistKey = ctx.options.persistKey;
+        summary.mode = SchedulerJobMode::WorkerTask;
+        summary.enabled = !ctx.paused.load();
+        summary.lastRunUtc = ctx.lastRunUtc.load();
+        if (ctx.schedule.isInterval()) {
+            summary.hasNext = true;
+            summary.nextRunUtc = intervalNext(ctx.nextDueUs.load());
+        } else if (job.task) {
+            const int64_t next = ctx.publishedNextUtc.load();
+            fillNext(ctx.schedule, next != kUnresolvedDeadline, dateTimeFromEpoch(next), summary);
+        } else {
+            m_workerPool->lock();
+            const bool hasNext = ctx.hasNext;
+            const DateTime next = ctx.nextRunUtc;
+            m_workerPool->unlock();
+            fillNext(ctx.schedule, hasNext, next, summary);
+        }
+        ++visited;
+        if (!visitor(summary, userData)) {
+            return visited;
+        }
+    }
+    return visited;
+}
 
-    const SchedulerTaskConfig runtimeCfg = makeTaskConfig(taskCfg);
-    auto* taskCtx = new (std::nothrow) std::shared_ptr<WorkerJobContext>(ctx);
-    if (!taskCtx) {
+size_t ESPScheduler::listJobs(JobSummary* out, size_t capacity) const {
+    if (!out || capacity == 0) {
         return 0;
     }
-    TaskHandle_t taskHandle = nullptr;
-    const BaseType_t created = xTaskCreatePinnedToCore(
-        &ESPScheduler::workerTaskEntry,
-        runtimeCfg.name ? runtimeCfg.name : "sched-job",
-        runtimeCfg.stackSize,
-        taskCtx,
-        runtimeCfg.priority,
-        &taskHandle,
-        runtimeCfg.coreId);
-    if (created != pdPASS || taskHandle == nullptr) {
-        delete taskCtx;
+    size_t count = 0;
+    forEachJob([&](const JobSummary& job) {
+        out[count++] = job;
+        return count < capacity;
+    });
+    return count;
+}
+
+bool ESPScheduler::getJobStats(uint32_t jobId, JobStats& out) const {
+    out = JobStats{};
+    if (!isInitialized()) {
+        return false;
+    }
+    const size_t inlineSlot = findInlineSlot(jobId);
+    if (inlineSlot != kNotQueued) {
+        m_inlineJobs[inlineSlot].stats.read(out);
+        return true;
+    }
+    const size_t workerSlot = findWorkerSlot(jobId);
+    if (workerSlot != kNotQueued) {
+        m_workerJobs[workerSlot].context->stats.read(out);
+        return true;
+    }
+    return false;
+}
+
+bool ESPScheduler::computeNextOccurrence(const Schedule& schedule,
+                                         const DateTime& fromUtc,
+                                         DateTime& outNextUtc) const {
+    // May be called from any task, so it cannot share the tick loop's cache.
+    SchedulerLocalTimeCache localTime;
+    localTime.revalidate();
+    return computeNextOccurrenceForSchedule(schedule, 0, fromUtc, localTime, outNextUtc);
+}
+
+size_t ESPScheduler::computeNextOccurrences(const Schedule& schedule,
+                                            const DateTime& fromUtc,
+                                            DateTime* out,
+                                            size_t n) const {
+    if (!out) {
         return 0;
     }
+    ScheduleIterator it(schedule, fromUtc);
+    size_t count = 0;
+    while (count < n && it.next(out[count])) {
+        ++count;
+    }
+    return count;
+}
 
-    WorkerJob job{};
-    job.id = id;
-    job.context = ctx;
-    job.task = taskHandle;
-    m_workerJobs.push_back(job);
-    return id;
+void ESPScheduler::trace(SchedulerTraceEvent event, uint32_t jobId, int64_t value, uint8_t detail) {
+    traceEvent(m_trace, event, jobId, value, detail);
 }
 
-uint32_t ESPScheduler::addJob(const Schedule& schedule,
-                              SchedulerJobMode mode,
-                              SchedulerFunctionNoData cb,
-                              const SchedulerTaskConfig* taskCfg) {
-    if (!cb) {
+size_t ESPScheduler::drainTrace(SchedulerTraceRecord* out, size_t maxRecords) {
+    if (!m_trace || !out) {
         return 0;
     }
-    SchedulerFunction wrapped = [fn = std::move(cb)](void*) { fn(); };
-    return addJob(schedule, mode, std::move(wrapped), nullptr, taskCfg);
+    size_t count = 0;
+    while (count < maxRecords && m_trace->pop(out[count])) {
+        ++count;
+    }
+    return count;
 }
 
-bool ESPScheduler::cancelJob(uint32_t jobId) {
-    if (!isInitialized()) {
+uint32_t ESPScheduler::traceDropped() const {
+    return m_trace ? m_trace->dropped() : 0;
+}
+
+size_t ESPScheduler::workerQueueDepth() const {
+    return m_workerPool ? m_workerPool->readyRuns.load() : 0;
+}
+
+size_t ESPScheduler::workerQueueHighWater() const {
+    return m_workerPool ? m_workerPool->highWater.load() : 0;
+}
+
+bool ESPScheduler::loadSnapshot(SchedulerSnapshotStore& store) {
+    if (!isInitialized() || m_fixedJobCapacity > 0) {
+        return false;
+    }
+    uint8_t header[kSnapshotHeaderSize];
+    if (!store.load(kSnapshotHeaderName, header, sizeof(header)) ||
+        getLe(header + 20, 4) != snapshotCrc(header, kSnapshotHeaderSize - 4) ||
+        getLe(header + 0, 4) != kSnapshotMagic || getLe(header + 4, 2) != kSnapshotVersion ||
+        getLe(header + 6, 2) != kSnapshotRecordSize) {
+        return false;
+    }
+    const size_t keyCount = static_cast<size_t>(getLe(header + 8, 4));
+    if (keyCount > kSnapshotMaxKeys) {
+        return false;
+    }
+    SchedulerVector<uint8_t> keys{SchedulerAllocator<uint8_t>(usePSRAMBuffers_)};
+    keys.resize(keyCount * 4);
+    if (keyCount > 0 && (!store.load(kSnapshotKeysName, keys.data(), keys.size()) ||
+                         getLe(header + 16, 4) != snapshotCrc(keys.data(), keys.size()))) {
         return false;
     }
 
-    bool canceled = false;
-    for (auto& job : m_inlineJobs) {
-        if (job.id == jobId && !job.finished) {
-            job.finished = true;
-            canceled = true;
+    m_snapshotTimeZone = static_cast<uint32_t>(getLe(header + 12, 4));
+    m_persisted.reserve(m_persisted.size() + keyCount);
+    for (size_t i = 0; i < keyCount; ++i) {
+        const uint32_t key = static_cast<uint32_t>(getLe(&keys[i * 4], 4));
+        char name[16];
+        snapshotRecordName(key, name);
+        uint8_t bytes[kSnapshotRecordSize];
+        SchedulerSnapshotRecord record{};
+        uint32_t crc = 0;
+        if (!store.load(name, bytes, sizeof(bytes)) || !decodeSnapshotRecord(bytes, record, crc) ||
+            record.key != key) {
+            m_snapshotKeysDirty = true;  // lost record: the next save drops its key
+            continue;
+        }
+        PersistedJob* existing = findPersisted(key);
+        if (existing) {
+            existing->savedCrc = crc;  // added before the load; it simply overwrites the record
+            continue;
         }
+        PersistedJob entry;
+        entry.record = record;
+        entry.savedCrc = crc;
+        m_persisted.push_back(entry);
     }
-    for (auto& job : m_workerJobs) {
-        if (job.id == jobId && job.context) {
-            job.context->cancelRequested.store(true);
-            canceled = true;
+    return true;
+}
+
+bool ESPScheduler::saveSnapshot(SchedulerSnapshotStore& store) {
+    if (!isInitialized() || m_fixedJobCapacity > 0) {
+        return false;
+    }
+    const uint32_t timeZone = snapshotTimeZoneHash();
+    // Deadlines computed under another TZ are rewritten even if nothing else changed.
+    const bool rewriteAll = timeZone != m_snapshotTimeZone;
+    bool ok = true;
+    size_t kept = 0;
+    for (size_t i = 0; i < m_persisted.size(); ++i) {
+        PersistedJob entry = m_persisted[i];
+        char name[16];
+        snapshotRecordName(entry.record.key, name);
+        SchedulerSnapshotRecord record{};
+        bool keep = entry.claimed && snapshotRecordFor(entry.jobId, record);
+        if (!keep && entry.claimed && entry.record.kind == kSnapshotOneShot) {
+            // Ran (or was cancelled): remember it so the one-shot is not added again.
+            record = entry.record;
+            record.flags = static_cast<uint8_t>((record.flags | SchedulerSnapshotRecord::kDone) &
+                                                ~SchedulerSnapshotRecord::kHasNext);
+            keep = true;
+        }
+        if (!keep) {
+            if (entry.savedCrc != 0 && !store.erase(name)) {
+                ok = false;
+            }
+            m_snapshotKeysDirty = true;
+            continue;
+        }
+        uint8_t bytes[kSnapshotRecordSize];
+        const uint32_t crc = encodeSnapshotRecord(record, bytes);
+        if (rewriteAll || crc != entry.savedCrc) {
+            if (store.save(name, bytes, sizeof(bytes))) {
+                entry.savedCrc = crc;
+            } else {
+                ok = false;
+                entry.savedCrc = 0;
+            }
         }
+        entry.record = record;
+        m_persisted[kept++] = entry;
     }
-    if (canceled) {
-        cleanupInline();
-        cleanupWorkers();
+    m_persisted.resize(kept);
+    if (!ok || !(m_snapshotKeysDirty || rewriteAll)) {
+        return ok;
     }
-    return canceled;
-}
 
-bool ESPScheduler::pauseJob(uint32_t jobId) {
-    if (!isInitialized()) {
+    // Records first, header last: a power cut in between leaves the previous header,
+    // which names only records that still exist (missing ones are skipped on load).
+    SchedulerVector<uint8_t> keys{SchedulerAllocator<uint8_t>(usePSRAMBuffers_)};
+    keys.resize(kept * 4);
+    for (size_t i = 0; i < kept; ++i) {
+        putLe(&keys[i * 4], m_persisted[i].record.key, 4);
+    }
+    if (kept > 0 ? !store.save(kSnapshotKeysName, keys.data(), keys.size()) : !store.erase(kSnapshotKeysName)) {
         return false;
     }
-
-    for (auto& job : m_inlineJobs) {
-        if (job.id == jobId && !job.finished) {
-            job.paused = true;
-            return true;
-        }
+    uint8_t header[kSnapshotHeaderSize];
+    putLe(header + 0, kSnapshotMagic, 4);
+    putLe(header + 4, kSnapshotVersion, 2);
+    putLe(header + 6, kSnapshotRecordSize, 2);
+    putLe(header + 8, kept, 4);
+    putLe(header + 12, timeZone, 4);
+    putLe(header + 16, snapshotCrc(keys.data(), keys.size()), 4);
+    putLe(header + 20, snapshotCrc(header, kSnapshotHeaderSize - 4), 4);
+    if (!store.save(kSnapshotHeaderName, header, sizeof(header))) {
+        return false;
     }
-    for (auto& job : m_workerJobs) {
-        if (job.id == jobId && job.context) {
-            job.context->paused.store(true);
-            return true;
+    m_snapshotTimeZone = timeZone;
+    m_snapshotKeysDirty = false;
+    return true;
+}
+
+ESPScheduler::PersistedJob* ESPScheduler::findPersisted(uint32_t key) {
+    for (PersistedJob& entry : m_persisted) {
+        if (entry.record.key == key) {
+            return &entry;
         }
     }
-    return false;
+    return nullptr;
 }
 
-bool ESPScheduler::resumeJob(uint32_t jobId) {
-    if (!isInitialized()) {
+// addJob() refuses a key that a live job already holds, and a one-shot the
+// snapshot (or this boot) has already seen through.
+bool ESPScheduler::persistedJobBlocksAdd(const Schedule& schedule, const JobOptions& options, SchedulerJobMode mode) {
+    PersistedJob* entry = findPersisted(options.persistKey);
+    if (!entry) {
         return false;
     }
-
-    for (auto& job : m_inlineJobs) {
-        if (job.id == jobId && !job.finished) {
-            job.paused = false;
-            return true;
-        }
+    SchedulerSnapshotRecord live{};
+    if (entry->claimed && snapshotRecordFor(entry->jobId, live)) {
+        return true;
     }
-    for (auto& job : m_workerJobs) {
-        if (job.id == jobId && job.context) {
-            job.context->paused.store(false);
-            return true;
-        }
+    if (!schedule.isOneShot || entry->record.kind != kSnapshotOneShot ||
+        entry->record.onceAtUtc != schedule.onceAtUtc.epochSeconds) {
+        return false;
+    }
+    if (entry->claimed || (entry->record.flags & SchedulerSnapshotRecord::kDone) != 0) {
+        entry->claimed = true;  // keep the done record on the next save
+        entry->jobId = 0;
+        entry->record = packSchedule(schedule, options, mode);
+        entry->record.flags |= SchedulerSnapshotRecord::kDone;
+        return true;
     }
     return false;
 }
 
-void ESPScheduler::cancelAll() {
-    if (!isInitialized()) {
-        return;
+// Binds a new job to its key. True (with restored filled in) when an unclaimed
+// loaded record describes the same job; its deadline only counts under the TZ it
+// was computed in, and only for calendar schedules.
+bool ESPScheduler::claimPersisted(uint32_t jobId, const Schedule& schedule, const JobOptions& options,
+                                  SchedulerJobMode mode, SchedulerSnapshotRecord& restored) {
+    const SchedulerSnapshotRecord packed = packSchedule(schedule, options, mode);
+    PersistedJob* entry = findPersisted(options.persistKey);
+    if (!entry) {
+        PersistedJob added;
+        added.record = packed;
+        added.jobId = jobId;
+        added.claimed = true;
+        m_persisted.push_back(added);
+        m_snapshotKeysDirty = true;
+        return false;
     }
-
-    for (auto& job : m_inlineJobs) {
-        job.finished = true;
+    const bool restore = !entry->claimed && sameSnapshotJob(entry->record, packed);
+    restored = entry->record;
+    entry->record = packed;
+    entry->jobId = jobId;
+    entry->claimed = true;
+    if (!restore) {
+        return false;
     }
-    for (auto& job : m_workerJobs) {
-        if (job.context) {
-            job.context->cancelRequested.store(true);
-        }
+    if (restored.kind != kSnapshotCalendar || m_snapshotTimeZone != snapshotTimeZoneHash()) {
+        restored.flags = static_cast<uint8_t>(restored.flags & ~SchedulerSnapshotRecord::kHasNext);
     }
-    cleanupInline();
-    m_workerJobs.clear();
+    return true;
 }
 
-void ESPScheduler::tick() { tick(m_date.now()); }
-
-void ESPScheduler::tick(const DateTime& nowUtc) {
-    if (!isInitialized()) {
+// Undo claimPersisted() for a job that failed to start.
+void ESPScheduler::releasePersisted(uint32_t key) {
+    PersistedJob* entry = key != 0 ? findPersisted(key) : nullptr;
+    if (!entry) {
         return;
     }
-
-    if (!clockValid(nowUtc)) {
-        return;
+    entry->claimed = false;
+    entry->jobId = 0;
+    if (entry->savedCrc == 0) {
+        *entry = m_persisted.back();
+        m_persisted.pop_back();
     }
+}
 
-    for (auto& job : m_inlineJobs) {
-        if (job.finished || job.paused) {
-            continue;
-        }
-        if (!job.hasNext) {
-            if (job.schedule.isOneShot) {
-                job.nextRunUtc = job.schedule.onceAtUtc;
-                job.hasNext = true;
-            } else {
-                job.hasNext = computeNextOccurrence(job.schedule, nowUtc, job.nextRunUtc);
-                if (!job.hasNext) {
-                    job.finished = true;
-                    continue;
-                }
-            }
-        }
-
-        if (m_date.isAfter(job.nextRunUtc, nowUtc)) {
-            continue;
-        }
-        job.callback(job.userData);
-        if (job.schedule.isOneShot) {
-            job.finished = true;
-            continue;
+// The record a live job would be saved as; false once the job is gone.
+bool ESPScheduler::snapshotRecordFor(uint32_t jobId, SchedulerSnapshotRecord& record) const {
+    const size_t inlineSlot = findInlineSlot(jobId);
+    if (inlineSlot != kNotQueued) {
+        const InlineJob& job = m_inlineJobs[inlineSlot];
+        record = packSchedule(scheduleOf(job), job.options, SchedulerJobMode::Inline);
+        if (job.paused) {
+            record.flags |= SchedulerSnapshotRecord::kPaused;
         }
-        DateTime from = m_date.addMinutes(job.nextRunUtc, 1);
-        job.hasNext = computeNextOccurrence(job.schedule, from, job.nextRunUtc);
-        if (!job.hasNext) {
-            job.finished = true;
+        if (record.kind == kSnapshotCalendar && job.hasNext) {
+            record.flags |= SchedulerSnapshotRecord::kHasNext;
+            record.nextRunUtc = job.nextRunUtc.epochSeconds;
         }
+        record.lastRunUtc = job.lastRunUtc;
+        return true;
     }
-
-    cleanupInline();
-    cleanupWorkers();
-}
-
-void ESPScheduler::cleanup() {
-    if (!isInitialized()) {
-        return;
+    const size_t workerSlot = findWorkerSlot(jobId);
+    if (workerSlot == kNotQueued) {
+        return false;
     }
-
-    cleanupInline();
-    cleanupWorkers();
-}
-
-bool ESPScheduler::getJobInfo(size_t index, JobInfo& out) const {
-    if (!isInitialized()) {
-        out = JobInfo{};
+    const WorkerJob& job = m_workerJobs[workerSlot];
+    const WorkerJobContext& ctx = *job.context;
+    if (ctx.finished.load() || ctx.cancelRequested.load()) {
         return false;
     }
-
-    out = JobInfo{};
-    size_t current = 0;
-    auto fillNext = [this](const Schedule& schedule, bool hasNext, const DateTime& storedNext, DateTime& outNext) {
-        if (hasNext) {
-            outNext = storedNext;
-            return;
-        }
-        if (schedule.isOneShot) {
-            outNext = schedule.onceAtUtc;
-            return;
-        }
-        DateTime computed{};
-        if (computeNextOccurrence(schedule, m_date.now(), computed)) {
-            outNext = computed;
-        } else {
-            outNext = {};
-        }
-    };
-
-    for (const auto& job : m_inlineJobs) {
-        if (job.finished) {
-            continue;
-        }
-        if (current == index) {
-            out.id = job.id;
-            out.enabled = !job.paused;
-            out.mode = SchedulerJobMode::Inline;
-            out.schedule = job.schedule;
-            fillNext(job.schedule, job.hasNext, job.nextRunUtc, out.nextRunUtc);
-            return true;
-        }
-        ++current;
+    record = packSchedule(ctx.schedule, ctx.options, SchedulerJobMode::WorkerTask);
+    if (ctx.paused.load()) {
+        record.flags |= SchedulerSnapshotRecord::kPaused;
     }
-
-    for (const auto& job : m_workerJobs) {
-        if (!job.context) {
-            continue;
-        }
-        if (job.context->cancelRequested.load() || job.context->finished.load()) {
-            continue;
+    if (record.kind == kSnapshotCalendar) {
+        int64_t next = kUnresolvedDeadline;
+        if (job.task) {
+            next = ctx.publishedNextUtc.load();
+        } else {
+            m_workerPool->lock();
+            next = ctx.hasNext ? ctx.nextRunUtc.epochSeconds : kUnresolvedDeadline;
+            m_workerPool->unlock();
         }
-        if (current == index) {
-            out.id = job.id;
-            out.enabled = !job.context->paused.load();
-            out.mode = SchedulerJobMode::WorkerTask;
-            out.schedule = job.context->schedule;
-            fillNext(job.context->schedule, job.context->hasNext, job.context->nextRunUtc, out.nextRunUtc);
-            return true;
+        if (next != kUnresolvedDeadline) {
+            record.flags |= SchedulerSnapshotRecord::kHasNext;
+            record.nextRunUtc = next;
         }
-        ++current;
     }
-
-    return false;
-}
-
-bool ESPScheduler::computeNextOccurrence(const Schedule& schedule,
-                                         const DateTime& fromUtc,
-                                         DateTime& outNextUtc) const {
-    return computeNextOccurrenceForDate(m_date, schedule, fromUtc, outNextUtc);
+    record.lastRunUtc = ctx.lastRunUtc.load();
+    return true;
 }
 
 void ESPScheduler::runWorkerJob(const std::shared_ptr<WorkerJobContext>& ctx) {
@@ -643,51 +3517,161 @@ void ESPScheduler::runWorkerJob(const std::shared_ptr<WorkerJobContext>& ctx) {
         return;
     }
 
+    if (ctx->schedule.isOnDemand) {
+        while (!ctx->cancelRequested.load()) {
+            runTriggeredWorkerJob(ctx);
+            waitForWake(-1);  // triggerJob()/cancelJob() notify us
+        }
+        return;
+    }
+
     ESPDate& date = *ctx->date;
     while (!ctx->cancelRequested.load()) {
+        if (runTriggeredWorkerJob(ctx)) {
+            break;
+        }
         DateTime now = date.now();
         const int64_t minValidEpochSeconds =
             ctx->minValidEpochSeconds ? ctx->minValidEpochSeconds->load() : kDefaultMinValidEpochSeconds;
         if (!clockValidForMin(now, minValidEpochSeconds)) {
-            vTaskDelay(pdMS_TO_TICKS(kWorkerSleepChunkSeconds * 1000));
+            traceEvent(ctx->trace, SchedulerTraceEvent::ClockInvalid, ctx->jobId, now.epochSeconds,
+                       traceRunner(SchedulerTraceRunner::Worker));
+            // SNTP sets the clock without telling us, so keep polling while it is invalid.
+            ctx->clockWatch.reset();
+            waitForWake(kWorkerSleepChunkSeconds);
             continue;
         }
+        const int64_t stepSeconds = ctx->clockWatch.observe(now.epochSeconds, esp_timer_get_time());
+        const uint32_t generation = ctx->clockGeneration ? ctx->clockGeneration->load() : 0;
+        if (generation != ctx->clockGenerationSeen) {
+            ctx->clockGenerationSeen = generation;
+            traceEvent(ctx->trace, SchedulerTraceEvent::ClockStepped, ctx->jobId, stepSeconds,
+                       traceRunner(SchedulerTraceRunner::Worker));
+            const int64_t afterUtc = rescheduleAfterUtc(now.epochSeconds, stepSeconds);
+            if (ctx->hasNext && !ctx->schedule.isOneShot && ctx->nextRunUtc.epochSeconds > afterUtc) {
+                ctx->localTime.invalidate();
+                ctx->localTime.revalidate();
+                ctx->cursor = ScheduleCursor::startingAt(dateTimeFromEpoch(afterUtc + 1));
+                ctx->hasNext =
+                    advanceScheduleCursor(ctx->schedule, ctx->splayOffset, ctx->cursor, ctx->localTime, ctx->nextRunUtc);
+            }
+        }
         if (!ctx->hasNext) {
             if (ctx->schedule.isOneShot) {
                 ctx->nextRunUtc = ctx->schedule.onceAtUtc;
                 ctx->hasNext = true;
             } else {
-                ctx->hasNext = computeNextOccurrenceForDate(date, ctx->schedule, now, ctx->nextRunUtc);
+                ctx->localTime.revalidate();
+                ctx->cursor = ScheduleCursor::startingAt(now);
+                ctx->hasNext =
+                    advanceScheduleCursor(ctx->schedule, ctx->splayOffset, ctx->cursor, ctx->localTime, ctx->nextRunUtc);
                 if (!ctx->hasNext) {
                     break;
                 }
             }
         }
 
+        ctx->publishedNextUtc.store(ctx->hasNext ? ctx->nextRunUtc.epochSeconds : kUnresolvedDeadline);
         if (ctx->paused.load()) {
-            vTaskDelay(pdMS_TO_TICKS(kWorkerSleepChunkSeconds * 1000));
+            waitForWake(-1);  // resumeJob()/cancelJob() notify us
             continue;
         }
 
         const int64_t diffSec = date.differenceInSeconds(ctx->nextRunUtc, now);
         if (diffSec > 0) {
-            const int64_t chunk = (diffSec > kWorkerSleepChunkSeconds) ? kWorkerSleepChunkSeconds : diffSec;
-            vTaskDelay(pdMS_TO_TICKS(static_cast<TickType_t>(chunk * 1000)));
+            waitForWake(diffSec);
             continue;
         }
 
-        ctx->callback(ctx->userData);
+        ctx->localTime.revalidate();
+        const MisfireDecision misfire =
+            resolveMisfire(ctx->schedule, ctx->options, ctx->cursor, ctx->localTime, ctx->nextRunUtc, now);
+        ctx->stats.recordMissed(misfire.missed);
+        for (uint32_t run = 0; run < misfire.runs && !ctx->cancelRequested.load(); ++run) {
+            traceEvent(ctx->trace, SchedulerTraceEvent::Dispatch, ctx->jobId, -diffSec * 1000000,
+                       traceRunner(SchedulerTraceRunner::Worker));
+            const int64_t startUs = statsClockUs();
+            ctx->callback();
+            ctx->stats.recordRun(startUs, statsClockUs(), -diffSec * 1000000, now.epochSeconds);
+            ctx->lastRunUtc.store(now.epochSeconds);
+            noteWorkerCompletion(*ctx);
+        }
 
         if (ctx->schedule.isOneShot) {
             break;
         }
-        DateTime from = date.addMinutes(ctx->nextRunUtc, 1);
-        ctx->hasNext = computeNextOccurrenceForDate(date, ctx->schedule, from, ctx->nextRunUtc);
+        ctx->localTime.revalidate();
+        ctx->hasNext = misfire.movedOn
+                           ? misfire.hasNext
+                           : advanceScheduleCursor(ctx->schedule, ctx->splayOffset, ctx->cursor, ctx->localTime,
+                                                   ctx->nextRunUtc);
+        traceCalendarReschedule(ctx->trace, ctx->jobId, ctx->hasNext, ctx->nextRunUtc, now);
         if (!ctx->hasNext) {
             break;
         }
+        if (JobStatsRecorder::kEnabled && ctx->nextRunUtc.epochSeconds <= date.now().epochSeconds) {
+            ctx->stats.recordOverrun();
+        }
+    }
+}
+
+// Interval jobs sleep on their esp_timer deadline; the wall-clock guard does not apply.
+void ESPScheduler::runIntervalWorkerJob(const std::shared_ptr<WorkerJobContext>& ctx) {
+    while (!ctx->cancelRequested.load()) {
+        runTriggeredWorkerJob(ctx);
+        if (ctx->paused.load()) {
+            waitForWake(-1);  // resumeJob()/cancelJob() notify us
+            continue;
+        }
+        const int64_t dueUs = ctx->nextDueUs.load();
+        const int64_t nowUs = esp_timer_get_time();
+        if (dueUs > nowUs) {
+            waitForWakeMs((dueUs - nowUs + 999) / 1000);
+            continue;
+        }
+
+        traceDispatch(ctx->trace, ctx->jobId, SchedulerTraceRunner::Worker, dueUs);
+        const int64_t startUs = statsClockUs();
+        ctx->callback();
+        const int64_t endUs = esp_timer_get_time();
+        const int64_t startEpochSeconds = ctx->date->now().epochSeconds;
+        ctx->stats.recordRun(startUs, endUs, startUs - dueUs, startEpochSeconds);
+        ctx->lastRunUtc.store(startEpochSeconds);
+        noteWorkerCompletion(*ctx);
+        uint32_t skipped = 0;
+        ctx->nextDueUs.store(nextIntervalDueUs(ctx->schedule, dueUs, endUs, &skipped));
+        recordIntervalRun(ctx->stats, skipped);
+        traceIntervalReschedule(ctx->trace, ctx->jobId, ctx->nextDueUs.load());
+    }
+}
+
+// Runs a pending triggerNow outside the schedule; true if it used up a one-shot job.
+bool ESPScheduler::runTriggeredWorkerJob(const std::shared_ptr<WorkerJobContext>& ctx) {
+    if (!ctx->triggered.exchange(false) || ctx->paused.load()) {
+        return false;
+    }
+    traceTriggered(ctx->trace, ctx->jobId, SchedulerTraceRunner::Worker);
+    const int64_t startUs = statsClockUs();
+    ctx->callback();
+    const int64_t endUs = statsClockUs();
+    const int64_t startEpochSeconds = ctx->date->now().epochSeconds;
+    ctx->stats.recordRun(startUs, endUs, 0, startEpochSeconds);
+    ctx->lastRunUtc.store(startEpochSeconds);
+    noteWorkerCompletion(*ctx);
+    return ctx->schedule.isOneShot;
+}
+
+// Counts a finished run; with dependents, tells the tick task to look at the counts.
+void ESPScheduler::noteWorkerCompletion(WorkerJobContext& ctx) {
+    ctx.completedRuns.fetch_add(1);
+    if (!ctx.hasDependents.load() || !ctx.completions) {
+        return;
+    }
+    ctx.completions->fetch_add(1);
+    TaskHandle_t task = ctx.tickTask ? ctx.tickTask->load(std::memory_order_relaxed) : nullptr;
+    if (task) {
+        xTaskNotifyGive(task);
     }
-    ctx->finished.store(true);
 }
 
 bool ESPScheduler::clockValid(const DateTime& nowUtc) const {
@@ -700,6 +3684,7 @@ SchedulerTaskConfig ESPScheduler::makeTaskConfig(const SchedulerTaskConfig* task
     cfg.priority = taskCfg ? taskCfg->priority : SchedulerTaskConfig{}.priority;
     cfg.coreId = taskCfg ? taskCfg->coreId : SchedulerTaskConfig{}.coreId;
     cfg.usePsramStack = taskCfg ? taskCfg->usePsramStack : SchedulerTaskConfig{}.usePsramStack;
+    cfg.maxConcurrentRuns = taskCfg ? taskCfg->maxConcurrentRuns : SchedulerTaskConfig{}.maxConcurrentRuns;
     cfg.name = taskCfg && taskCfg->name ? taskCfg->name : "sched-job";
     return cfg;
 }
@@ -712,23 +3697,347 @@ void ESPScheduler::workerTaskEntry(void* arg) {
     }
     std::shared_ptr<WorkerJobContext> ctx = *ctxPtr;
     delete ctxPtr;
-    runWorkerJob(ctx);
+    if (ctx->schedule.isInterval()) {
+        runIntervalWorkerJob(ctx);
+    } else {
+        runWorkerJob(ctx);
+    }
+    traceEvent(ctx->trace, SchedulerTraceEvent::WorkerExited, ctx->jobId);
+    ctx->finished.store(true);
+    if (ctx->exitedWorkers) {
+        ctx->exitedWorkers->fetch_add(1);
+    }
+
+    const WorkerTaskState previous = ctx->taskState.exchange(WorkerTaskState::Exited);
+    ctx.reset();
+    if (previous != WorkerTaskState::Detached) {
+        // The scheduler may still notify this handle; park until releaseWorker() deletes us.
+        for (;;) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        }
+    }
+    vTaskDelete(nullptr);
+}
+
+void ESPScheduler::wakeWorker(const WorkerJob& job) {
+    if (job.task) {
+        xTaskNotifyGive(job.task);
+    } else if (m_workerPool) {
+        m_workerPool->notifyAll();
+    }
+}
+
+void ESPScheduler::wakeAllWorkers() {
+    for (const auto& job : m_workerJobs) {
+        if (job.task) {
+            xTaskNotifyGive(job.task);
+        }
+    }
+    if (m_workerPool) {
+        m_workerPool->notifyAll();
+    }
+}
+
+void ESPScheduler::cancelWorker(WorkerJob& job) {
+    if (!job.context) {
+        return;
+    }
+    WorkerJobContext& ctx = *job.context;
+    ctx.cancelRequested.store(true);
+    if (m_workerPool && !job.task) {
+        m_workerPool->lock();
+        m_workerPool->heapFor(ctx).remove(ctx);
+        m_workerPool->unpark(ctx);
+        m_workerPool->dropFromReady(ctx);
+        m_workerPool->retireIfIdle(ctx);
+        m_workerPool->unlock();
+    }
+    wakeWorker(job);
+    releaseWorker(job);
+}
+
+void ESPScheduler::releaseWorker(WorkerJob& job) {
+    if (job.task && job.context) {
+        if (job.context->taskState.exchange(WorkerTaskState::Detached) == WorkerTaskState::Exited) {
+            vTaskDelete(job.task);
+        }
+    }
+    job.task = nullptr;
+}
+
+bool ESPScheduler::ensureWorkerPool() {
+    if (m_workerPool) {
+        return true;
+    }
+    auto pool = std::allocate_shared<WorkerPool>(SchedulerAllocator<WorkerPool>(usePSRAMBuffers_), usePSRAMBuffers_);
+    pool->mutex = xSemaphoreCreateMutex();
+    if (!pool->mutex) {
+        return false;
+    }
+    pool->date = &m_date;
+    pool->minValidEpochSeconds = m_minValidEpochSecondsRef;
+    pool->trace = m_trace;
+    pool->clockGeneration = m_clockGenerationRef;
+    pool->clockGenerationSeen = m_clockGenerationRef->load();
+
+    const SchedulerTaskConfig runtimeCfg = makeTaskConfig(&m_workerPoolTask);
+    // Hold the lock so dispatchers cannot read the task list while it is filled in.
+    pool->lock();
+    for (uint8_t i = 0; i < m_workerPoolSize; ++i) {
+        const BaseType_t core =
+            m_workerPoolPerCore ? static_cast<BaseType_t>(i % portNUM_PROCESSORS) : runtimeCfg.coreId;
+        auto* taskCtx = new (std::nothrow) PoolTaskArgs{pool, core};
+        if (!taskCtx) {
+            break;
+        }
+        TaskHandle_t taskHandle = nullptr;
+        const BaseType_t created = xTaskCreatePinnedToCore(&ESPScheduler::poolTaskEntry,
+                                                           runtimeCfg.name,
+                                                           runtimeCfg.stackSize,
+                                                           taskCtx,
+                                                           runtimeCfg.priority,
+                                                           &taskHandle,
+                                                           core);
+        if (created != pdPASS || taskHandle == nullptr) {
+            delete taskCtx;
+            break;
+        }
+        pool->tasks.push_back(taskHandle);
+        pool->taskCores.push_back(core);
+        trace(SchedulerTraceEvent::WorkerCreated, 0, runtimeCfg.stackSize, 1);
+    }
+    const bool started = !pool->tasks.empty();
+    pool->stopping = !started;
+    pool->unlock();
+    if (!started) {
+        return false;
+    }
+    m_workerPool = pool;
+    return true;
+}
+
+void ESPScheduler::poolTaskEntry(void* arg) {
+    auto* args = static_cast<PoolTaskArgs*>(arg);
+    if (!args) {
+        vTaskDelete(nullptr);
+        return;
+    }
+    std::shared_ptr<WorkerPool> pool = args->pool;
+    const BaseType_t core = args->core;
+    delete args;
+    runPoolDispatcher(pool, core);
+    traceEvent(pool->trace, SchedulerTraceEvent::WorkerExited, 0, 0, 1);
     vTaskDelete(nullptr);
 }
 
+void ESPScheduler::runPoolDispatcher(const std::shared_ptr<WorkerPool>& pool, BaseType_t core) {
+    ESPDate& date = *pool->date;
+    pool->lock();
+    while (!pool->stopping) {
+        const DateTime now = date.now();
+        const bool valid = clockValidForMin(now, pool->minValidEpochSeconds->load());
+        if (valid) {
+            const int64_t stepSeconds = pool->clockWatch.observe(now.epochSeconds, esp_timer_get_time());
+            const uint32_t generation = pool->clockGeneration->load();
+            if (generation != pool->clockGenerationSeen) {
+                pool->clockGenerationSeen = generation;
+                traceEvent(pool->trace, SchedulerTraceEvent::ClockStepped, 0, stepSeconds,
+                           traceRunner(SchedulerTraceRunner::Pool));
+                pool->rescheduleDeadlines(rescheduleAfterUtc(now.epochSeconds, stepSeconds));
+            }
+            pool->promoteDue(now);
+        } else if (!pool->clockWasInvalid) {
+            traceEvent(pool->trace, SchedulerTraceEvent::ClockInvalid, 0, now.epochSeconds,
+                       traceRunner(SchedulerTraceRunner::Pool));
+        }
+        pool->clockWasInvalid = !valid;
+        if (!valid) {
+            pool->clockWatch.reset();
+        }
+        pool->promoteIntervals(esp_timer_get_time());
+
+        std::shared_ptr<WorkerJobContext> ctx = pool->takeRunnable(core);
+        if (ctx) {
+            const int64_t dueUs = ctx->poolReadyDueUs;
+            pool->unlock();
+            traceDispatch(ctx->trace, ctx->jobId, SchedulerTraceRunner::Pool, dueUs);
+            const int64_t startEpochSeconds = date.now().epochSeconds;
+            const int64_t startUs = statsClockUs();
+            ctx->callback();
+            const int64_t endUs = statsClockUs();
+            noteWorkerCompletion(*ctx);
+            pool->lock();
+            pool->finishRun(ctx, startUs, endUs, dueUs, startEpochSeconds);
+            if (ctx->pendingRuns > 0) {
+                pool->notifyAll();
+            }
+            continue;
+        }
+
+        // Sleep exactly until the earliest deadline; adds, resumes and clock
+        // changes notify us. Only an invalid clock needs polling.
+        int64_t waitMs = kWorkerSleepChunkSeconds * 1000;
+        if (valid) {
+            waitMs = -1;
+            if (!pool->deadlines.empty()) {
+                const int64_t untilDue = pool->deadlines.top()->poolDue - now.epochSeconds;
+                waitMs = (untilDue < 1 ? 1 : untilDue) * 1000;
+            }
+        }
+        if (!pool->intervals.empty()) {
+            const int64_t untilDueUs = pool->intervals.top()->poolDue - esp_timer_get_time();
+            const int64_t intervalWaitMs = untilDueUs <= 0 ? 0 : (untilDueUs + 999) / 1000;
+            if (waitMs < 0 || intervalWaitMs < waitMs) {
+                waitMs = intervalWaitMs;
+            }
+        }
+        pool->unlock();
+        waitForWakeMs(waitMs);
+        pool->lock();
+    }
+    pool->unlock();
+}
+
+ESPScheduler::InlineQueue& ESPScheduler::queueFor(const InlineJob& job) {
+    if (job.ready) {
+        return m_readyQueue;
+    }
+    return scheduleOf(job).isInterval() ? m_intervalQueue : m_inlineQueue;
+}
+
+void ESPScheduler::queueSet(InlineQueue& queue, size_t pos, const InlineQueueEntry& entry) {
+    queue[pos] = entry;
+    m_inlineJobs[entry.jobIndex].queuePos = pos;
+}
+
+void ESPScheduler::queueSiftUp(InlineQueue& queue, size_t pos) {
+    const InlineQueueEntry entry = queue[pos];
+    while (pos > 0) {
+        const size_t parent = (pos - 1) / 2;
+        if (queue[parent].due <= entry.due) {
+            break;
+        }
+        queueSet(queue, pos, queue[parent]);
+        pos = parent;
+    }
+    queueSet(queue, pos, entry);
+}
+
+void ESPScheduler::queueSiftDown(InlineQueue& queue, size_t pos) {
+    const InlineQueueEntry entry = queue[pos];
+    const size_t count = queue.size();
+    while (true) {
+        size_t child = pos * 2 + 1;
+        if (child >= count) {
+            break;
+        }
+        if (child + 1 < count && queue[child + 1].due < queue[child].due) {
+            ++child;
+        }
+        if (entry.due <= queue[child].due) {
+            break;
+        }
+        queueSet(queue, pos, queue[child]);
+        pos = child;
+    }
+    queueSet(queue, pos, entry);
+}
+
+void ESPScheduler::queuePush(InlineQueue& queue, size_t jobIndex, int64_t due) {
+    InlineQueueEntry entry{};
+    entry.due = due;
+    entry.jobIndex = jobIndex;
+    queue.push_back(entry);
+    queueSiftUp(queue, queue.size() - 1);
+}
+
+void ESPScheduler::queueUpdate(InlineQueue& queue, size_t pos, int64_t due) {
+    const int64_t previous = queue[pos].due;
+    queue[pos].due = due;
+    if (due < previous) {
+        queueSiftUp(queue, pos);
+    } else {
+        queueSiftDown(queue, pos);
+    }
+}
+
+void ESPScheduler::queueRemove(InlineQueue& queue, size_t pos) {
+    InlineJob& removed = m_inlineJobs[queue[pos].jobIndex];
+    removed.queuePos = kNotQueued;
+    removed.ready = false;
+    const size_t last = queue.size() - 1;
+    if (pos == last) {
+        queue.pop_back();
+        return;
+    }
+    const InlineQueueEntry moved = queue[last];
+    queue.pop_back();
+    queueSet(queue, pos, moved);
+    if (pos > 0 && queue[(pos - 1) / 2].due > moved.due) {
+        queueSiftUp(queue, pos);
+    } else {
+        queueSiftDown(queue, pos);
+    }
+}
+
+void ESPScheduler::queueInlineJob(size_t jobIndex) {
+    const InlineJob& job = m_inlineJobs[jobIndex];
+    if (scheduleOf(job).isOnDemand) {
+        return;  // only triggerJob() runs it
+    }
+    if (scheduleOf(job).isInterval()) {
+        queuePush(m_intervalQueue, jobIndex, job.nextDueUs);
+        return;
+    }
+    queuePush(m_inlineQueue, jobIndex, job.hasNext ? job.nextRunUtc.epochSeconds : kUnresolvedDeadline);
+}
+
+void ESPScheduler::finishInlineJob(size_t jobIndex) {
+    InlineJob& job = m_inlineJobs[jobIndex];
+    job.finished = true;
+    if (job.queuePos != kNotQueued) {
+        queueRemove(queueFor(job), job.queuePos);
+    }
+    m_finishedInline.push_back(jobIndex);
+}
+
+void ESPScheduler::removeInlineJobAt(size_t jobIndex) {
+    InlineJob& job = m_inlineJobs[jobIndex];
+    if (!job.live) {
+        return;
+    }
+    if (job.queuePos != kNotQueued) {
+        queueRemove(queueFor(job), job.queuePos);
+    }
+    m_schedules.release(job.scheduleRef);
+    const uint16_t generation = nextGeneration(job.generation);
+    job = InlineJob{};
+    job.generation = generation;
+    if (m_fixedJobCapacity > 0 && jobIndex >= m_fixedJobCapacity) {
+        m_freePostedSlots.push_back(jobIndex);
+    } else {
+        m_freeInlineSlots.push_back(jobIndex);
+    }
+}
+
 void ESPScheduler::cleanupInline() {
-    m_inlineJobs.erase(std::remove_if(m_inlineJobs.begin(),
-                                      m_inlineJobs.end(),
-                                      [](const InlineJob& job) { return job.finished; }),
-                       m_inlineJobs.end());
+    if (m_finishedInline.empty() || m_dispatchingInline) {
+        return;
+    }
+    for (const size_t index : m_finishedInline) {
+        removeInlineJobAt(index);
+    }
+    m_finishedInline.clear();
 }
 
 void ESPScheduler::cleanupWorkers() {
-    m_workerJobs.erase(std::remove_if(m_workerJobs.begin(),
-                                      m_workerJobs.end(),
-                                      [](const WorkerJob& job) {
-                                          return !job.context || job.context->finished.load() ||
-                                                 job.context->cancelRequested.load();
-                                      }),
-                       m_workerJobs.end());
+    collectWorkerCompletions();  // runs of a finished predecessor still count
+    for (size_t i = 0; i < m_workerJobs.size(); ++i) {
+        WorkerJob& job = m_workerJobs[i];
+        if (!job.context || (!job.context->finished.load() && !job.context->cancelRequested.load())) {
+            continue;
+        }
+        releaseWorker(job);
+        releaseWorkerSlot(i);
+    }
 }
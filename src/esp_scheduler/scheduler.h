@@ -4,15 +4,26 @@
 #include <ESPDate.h>
 
 #include <atomic>
+#include <cstdint>
 #include <functional>
+#include <initializer_list>
 #include <memory>
+#include <type_traits>
 
 extern "C" {
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 }
 
+#include "clock_watch.h"
+#include "cron_expression.h"
+#include "job_stats.h"
+#include "local_time_cache.h"
 #include "scheduler_allocator.h"
+#include "scheduler_callable.h"
+#include "scheduler_ring.h"
+#include "scheduler_snapshot.h"
+#include "scheduler_trace.h"
 
 class ESPWorker;
 
@@ -21,21 +32,64 @@ enum class SchedulerJobMode : uint8_t {
     WorkerTask
 };
 
+// How an interval schedule picks its next deadline after a run.
+enum class SchedulerIntervalMode : uint8_t {
+    FixedRate,  // keep the original phase; slots missed entirely are skipped, not replayed
+    FixedDelay  // wait a full period after each run finishes
+};
+
+// What a calendar or one-shot job does when it comes due more than
+// JobOptions::misfireThresholdSeconds late (tick() not called, long callback,
+// clock stepped forward). Interval jobs follow SchedulerIntervalMode instead.
+enum class SchedulerMisfirePolicy : uint8_t {
+    // Run every missed occurrence in order. Inline jobs replay one per tick(), a
+    // dedicated worker task back to back in its own task, and the pool folds them
+    // into one pending run; bound a large backlog with RunOnce or Coalesce.
+    CatchUp,
+    RunOnce,   // run once now, then continue with the first occurrence after now
+    Coalesce,  // run up to JobOptions::misfireMaxRuns times back to back, then continue after now
+    Skip       // drop the late run and every other missed one; continue after now
+};
+
 struct SchedulerTaskConfig {
     const char* name = "sched-job";
     uint32_t stackSize = 4096;         // bytes
     UBaseType_t priority = 1;
+    // Dedicated task affinity. In a per-core worker pool, the core whose dispatchers
+    // run the job (tskNO_AFFINITY: any dispatcher that is free).
     BaseType_t coreId = tskNO_AFFINITY;
     bool usePsramStack = false;
+    // Worker pool only: how many runs of the same job may execute in parallel.
+    uint8_t maxConcurrentRuns = 1;
 };
 
 struct ESPSchedulerConfig {
     // Prefer PSRAM-backed buffers for scheduler-owned dynamic containers.
     // Falls back to default heap automatically when unavailable.
     bool usePSRAMBuffers = false;
+    // 0 keeps one dedicated FreeRTOS task per WorkerTask job. N > 0 runs every
+    // WorkerTask job on a shared pool of N dispatcher tasks created on first use.
+    uint8_t workerPoolSize = 0;
+    // Task settings for the pool dispatchers (per-job stack/priority are ignored in pool mode).
+    SchedulerTaskConfig workerPoolTask{"sched-pool"};
+    // Pin pool dispatcher i to core i % portNUM_PROCESSORS (workerPoolTask.coreId is
+    // ignored) and honour SchedulerTaskConfig::coreId of pool jobs. Unpinned jobs run
+    // on whichever core has a dispatcher free, so due work spreads over both cores.
+    bool workerPoolPerCore = false;
+    // 0 disables postJob()/postCancel()/postPause()/postResume(). N > 0 preallocates a
+    // lock-free ring of N commands that other tasks fill and tick() drains, and keeps
+    // N job ids per mode reserved so posted jobs get their id immediately.
+    uint16_t commandQueueSize = 0;
+    // 0 disables the event trace. N > 0 buffers up to N undrained SchedulerTraceRecords
+    // (16 bytes each) in a lock-free ring; newer records are dropped while it is full.
+    uint16_t traceBufferSize = 0;
+    // 0 re-derives deadlines only on notifyClockChanged(). N > 0 also lets tick()
+    // treat a TZ change, or wall-clock progress that disagrees with esp_timer by
+    // more than N seconds, as a clock change (2 or more; the wall clock has 1 s resolution).
+    uint32_t clockStepThresholdSeconds = 0;
 };
 
-using SchedulerCallback = void (*)(void* userData);
+// Still accepted by addJob()/addJobOnceUtc(); any callable is stored as a SchedulerCallable.
 using SchedulerFunction = std::function<void(void* userData)>;
 using SchedulerFunctionNoData = std::function<void()>;
 
@@ -44,24 +98,32 @@ public:
     static ScheduleField any();
     static ScheduleField only(int value);
     static ScheduleField range(int from, int to);
+    // 0, step, 2*step, ... for whichever field it fills: the only builder whose bits may
+    // run past the field's range, and only the values inside it count.
     static ScheduleField every(int step);
     static ScheduleField rangeEvery(int from, int to, int step);
     // If any value is out of range, the field is cleared and will fail validation.
     static ScheduleField list(const int* values, size_t count);
+    // Bit n set = value n matches. Bits outside the field's range fail validation.
+    static ScheduleField fromMask(uint64_t mask);
 
     bool matches(int value) const;
     bool isAny() const { return m_isAny; }
     bool empty() const { return !m_isAny && m_mask == 0; }
     uint64_t rawMask() const { return m_mask; }
+    bool runsPastRange() const { return m_pastRange; }
 
 private:
     uint64_t m_mask = 0;
     bool m_isAny = false;
+    bool m_pastRange = false;  // every()
 };
 
 struct Schedule {
     bool isOneShot = false;
     DateTime onceAtUtc{};
+    // Never due on its own (see onDemand()); the calendar fields are ignored.
+    bool isOnDemand = false;
 
     ScheduleField minute = ScheduleField::any();
     ScheduleField hour = ScheduleField::any();
@@ -69,7 +131,19 @@ struct Schedule {
     ScheduleField month = ScheduleField::any();
     ScheduleField dayOfWeek = ScheduleField::any();
 
+    // Interval schedules (intervalMs > 0) run on the monotonic esp_timer clock:
+    // no calendar math, sub-minute periods, and unaffected by SNTP steps or TZ.
+    uint32_t intervalMs = 0;
+    SchedulerIntervalMode intervalMode = SchedulerIntervalMode::FixedRate;
+
+    bool isInterval() const { return intervalMs > 0; }
+
     static Schedule onceUtc(const DateTime& whenUtc);
+    // Runs only when triggered: postTrigger(), triggerNowFromISR(), or the predecessors
+    // given to addJobAfter(). Repeats for as long as it is triggered.
+    static Schedule onDemand();
+    // First run one period after the job is added.
+    static Schedule everyMs(uint32_t periodMs, SchedulerIntervalMode mode = SchedulerIntervalMode::FixedRate);
     static Schedule dailyAtLocal(int hour, int minute);
     // dowMask bits: 0=Sun..6=Sat; empty mask falls back to any day of week.
     static Schedule weeklyAtLocal(uint8_t dowMask, int hour, int minute);
@@ -79,6 +153,80 @@ struct Schedule {
                            const ScheduleField& dom,
                            const ScheduleField& month,
                            const ScheduleField& dow);
+    // Cron string parsed at run time without heap allocation (see CronExpression).
+    // An invalid expression yields a schedule that addJob() rejects.
+    static Schedule cron(const char* expression);
+    static Schedule cron(const CronExpression& expression);
+};
+
+// Per-job policy handed to addJob()/postJob() next to the Schedule, which only
+// describes timing. Jobs on the same timing with different options still share
+// their occurrence searches. Built by chaining, e.g.
+//   addJob(Schedule::dailyAtLocal(3, 0), JobOptions{}.withMisfire(SchedulerMisfirePolicy::RunOnce).persistAs(1), ...)
+struct JobOptions {
+    // Applied when a run is found more than misfireThresholdSeconds past its deadline.
+    SchedulerMisfirePolicy misfirePolicy = SchedulerMisfirePolicy::CatchUp;
+    uint32_t misfireThresholdSeconds = 60;
+    uint8_t misfireMaxRuns = 1;  // Coalesce only
+
+    // Inline jobs due in the same tick() run highest priority first; ties run in
+    // deadline order. Matters most with a tick() budget, where low priorities wait.
+    uint8_t priority = 0;
+
+    // Calendar schedules only: run each occurrence splayOffsetFor() seconds late, an offset
+    // in [0, splaySeconds) fixed by splayKey. addJob() fills a zero key from persistKey,
+    // else from the job id (stable within one boot only). For fleet-wide spreading,
+    // mix something device-specific into the key. Keep the window below the period.
+    uint32_t splaySeconds = 0;
+    uint32_t splayKey = 0;
+
+    // Non-zero: saveSnapshot() persists the job under this key, and after loadSnapshot()
+    // addJob() resumes it from its record. Unique among live jobs; pick stable values,
+    // since the key is what rebinds a stored record to the callback added after a reboot.
+    uint32_t persistKey = 0;
+
+    JobOptions withMisfire(SchedulerMisfirePolicy policy, uint32_t thresholdSeconds = 60, uint8_t maxRuns = 1) const;
+    JobOptions withPriority(uint8_t jobPriority) const;
+    JobOptions withSplay(uint32_t windowSeconds, uint32_t key = 0) const;
+    JobOptions persistAs(uint32_t key) const;
+    // Seconds each occurrence of schedule runs late; 0 unless it is a calendar schedule.
+    uint32_t splayOffsetFor(const Schedule& schedule) const;
+};
+
+// Resumable position of a next-occurrence search: the UTC instant and local
+// calendar fields of the last match, so the following step continues from there.
+struct ScheduleCursor {
+    int64_t fromUtc = 0;  // search start until the first match
+    int64_t lastUtc = 0;
+    int32_t year = 0;
+    int8_t month = 0;
+    int8_t day = 0;
+    int8_t hour = 0;
+    int8_t minute = 0;
+    uint32_t steps = 0;  // interval schedules: occurrences yielded so far
+    bool started = false;
+    bool exhausted = false;
+
+    static ScheduleCursor startingAt(const DateTime& fromUtc);
+};
+
+// Yields the occurrences of a schedule in order: the first at or after fromUtc,
+// then each following one. Cheaper than repeated computeNextOccurrence() calls
+// because every step resumes from the previous match. One-shot schedules yield once;
+// interval schedules yield fromUtc + k * period, rounded up to whole seconds.
+class ScheduleIterator {
+public:
+    ScheduleIterator() = default;
+    ScheduleIterator(const Schedule& schedule, const DateTime& fromUtc);
+
+    void reset(const Schedule& schedule, const DateTime& fromUtc);
+    bool next(DateTime& outNextUtc);
+    const Schedule& schedule() const { return m_schedule; }
+
+private:
+    Schedule m_schedule{};
+    ScheduleCursor m_cursor{};
+    SchedulerLocalTimeCache m_localTime{};
 };
 
 struct JobInfo {
@@ -86,7 +234,21 @@ struct JobInfo {
     bool enabled = false;
     SchedulerJobMode mode = SchedulerJobMode::Inline;
     Schedule schedule{};
+    JobOptions options{};  // splayKey as resolved by addJob()
     DateTime nextRunUtc{};
+    JobStats stats{};  // zeros when ESP_SCHEDULER_ENABLE_STATS is 0
+};
+
+// What forEachJob() and listJobs() report per job: the cached state only, without a
+// copy of the Schedule or the stats (see getJobInfo() and getJobStats() for those).
+struct JobSummary {
+    uint32_t id = 0;
+    uint32_t persistKey = 0;
+    SchedulerJobMode mode = SchedulerJobMode::Inline;
+    bool enabled = false;
+    bool hasNext = false;     // false while the next run is not resolved yet (invalid clock)
+    DateTime nextRunUtc{};    // interval jobs: wall-clock estimate
+    int64_t lastRunUtc = 0;   // 0 before the first run
 };
 
 class ESPScheduler {
@@ -105,7 +267,13 @@ public:
     void setMinValidUnixSeconds(int64_t minEpochSeconds);
     void setMinValidUtc(const DateTime& minUtc);
     int64_t minValidUnixSeconds() const;
+    // Call after SNTP steps the time or TZ changes: the next tick() recomputes every
+    // upcoming calendar deadline in one pass (overdue ones are left to the misfire
+    // policy) and every worker wakes to do the same.
+    void notifyClockChanged();
 
+    // Function pointer plus userData, a lambda or other callable taking void* (userData is
+    // bound into it), or a no-argument callable. Small captures are stored inline.
     uint32_t addJobOnceUtc(const DateTime& whenUtc,
                            SchedulerJobMode mode,
                            SchedulerCallback cb,
@@ -113,13 +281,23 @@ public:
                            const SchedulerTaskConfig* taskCfg = nullptr);
     uint32_t addJobOnceUtc(const DateTime& whenUtc,
                            SchedulerJobMode mode,
-                           SchedulerFunction cb,
-                           void* userData = nullptr,
+                           SchedulerCallable cb,
                            const SchedulerTaskConfig* taskCfg = nullptr);
+    template <typename F, typename = scheduler_callable_detail::EnableWithData<F>>
     uint32_t addJobOnceUtc(const DateTime& whenUtc,
                            SchedulerJobMode mode,
-                           SchedulerFunctionNoData cb,
-                           const SchedulerTaskConfig* taskCfg = nullptr);
+                           F&& cb,
+                           void* userData = nullptr,
+                           const SchedulerTaskConfig* taskCfg = nullptr) {
+        return addJobOnceUtc(whenUtc, mode, SchedulerCallable::from(std::forward<F>(cb), userData, usePSRAMBuffers_), taskCfg);
+    }
+    template <typename F, typename = scheduler_callable_detail::EnableNoData<F>>
+    uint32_t addJobOnceUtc(const DateTime& whenUtc,
+                           SchedulerJobMode mode,
+                           F&& cb,
+                           const SchedulerTaskConfig* taskCfg = nullptr) {
+        return addJobOnceUtc(whenUtc, mode, SchedulerCallable::from(std::forward<F>(cb), usePSRAMBuffers_), taskCfg);
+    }
 
     uint32_t addJob(const Schedule& schedule,
                     SchedulerJobMode mode,
@@ -128,78 +306,646 @@ public:
                     const SchedulerTaskConfig* taskCfg = nullptr);
     uint32_t addJob(const Schedule& schedule,
                     SchedulerJobMode mode,
-                    SchedulerFunction cb,
+                    SchedulerCallable cb,
+                    const SchedulerTaskConfig* taskCfg = nullptr);
+    template <typename F, typename = scheduler_callable_detail::EnableWithData<F>>
+    uint32_t addJob(const Schedule& schedule,
+                    SchedulerJobMode mode,
+                    F&& cb,
+                    void* userData = nullptr,
+                    const SchedulerTaskConfig* taskCfg = nullptr) {
+        return addJob(schedule, mode, SchedulerCallable::from(std::forward<F>(cb), userData, usePSRAMBuffers_), taskCfg);
+    }
+    template <typename F, typename = scheduler_callable_detail::EnableNoData<F>>
+    uint32_t addJob(const Schedule& schedule,
+                    SchedulerJobMode mode,
+                    F&& cb,
+                    const SchedulerTaskConfig* taskCfg = nullptr) {
+        return addJob(schedule, mode, SchedulerCallable::from(std::forward<F>(cb), usePSRAMBuffers_), taskCfg);
+    }
+    // Same, with per-job policy (misfire handling, priority, splay, persistence).
+    uint32_t addJob(const Schedule& schedule,
+                    const JobOptions& options,
+                    SchedulerJobMode mode,
+                    SchedulerCallback cb,
                     void* userData = nullptr,
                     const SchedulerTaskConfig* taskCfg = nullptr);
     uint32_t addJob(const Schedule& schedule,
+                    const JobOptions& options,
                     SchedulerJobMode mode,
-                    SchedulerFunctionNoData cb,
+                    SchedulerCallable cb,
                     const SchedulerTaskConfig* taskCfg = nullptr);
+    template <typename F, typename = scheduler_callable_detail::EnableWithData<F>>
+    uint32_t addJob(const Schedule& schedule,
+                    const JobOptions& options,
+                    SchedulerJobMode mode,
+                    F&& cb,
+                    void* userData = nullptr,
+                    const SchedulerTaskConfig* taskCfg = nullptr) {
+        return addJob(schedule, options, mode, SchedulerCallable::from(std::forward<F>(cb), userData, usePSRAMBuffers_),
+                      taskCfg);
+    }
+    template <typename F, typename = scheduler_callable_detail::EnableNoData<F>>
+    uint32_t addJob(const Schedule& schedule,
+                    const JobOptions& options,
+                    SchedulerJobMode mode,
+                    F&& cb,
+                    const SchedulerTaskConfig* taskCfg = nullptr) {
+        return addJob(schedule, options, mode, SchedulerCallable::from(std::forward<F>(cb), usePSRAMBuffers_), taskCfg);
+    }
+
+    // Runs cb once every predecessor has completed a run since this job last ran: one
+    // predecessor makes a chain, several fan in. The job gets Schedule::onDemand() and
+    // runs through the usual dispatch for its mode. An inline dependent of an inline job
+    // runs in the same tick(). Completions of worker predecessors wake waitForWork().
+    // Pausing the job skips the runs it would have made, and a predecessor that is
+    // cancelled or finishes stops gating it. Returns 0 unless 1..kMaxJobPredecessors
+    // distinct live job ids are given.
+    static constexpr size_t kMaxJobPredecessors = 8;
+    uint32_t addJobAfter(const uint32_t* predecessors,
+                         size_t count,
+                         SchedulerJobMode mode,
+                         SchedulerCallable cb,
+                         const SchedulerTaskConfig* taskCfg = nullptr);
+    uint32_t addJobAfter(std::initializer_list<uint32_t> predecessors,
+                         SchedulerJobMode mode,
+                         SchedulerCallable cb,
+                         const SchedulerTaskConfig* taskCfg = nullptr) {
+        return addJobAfter(predecessors.begin(), predecessors.size(), mode, std::move(cb), taskCfg);
+    }
+    template <typename F, typename = scheduler_callable_detail::EnableWithData<F>>
+    uint32_t addJobAfter(std::initializer_list<uint32_t> predecessors,
+                         SchedulerJobMode mode,
+                         F&& cb,
+                         void* userData = nullptr,
+                         const SchedulerTaskConfig* taskCfg = nullptr) {
+        return addJobAfter(predecessors.begin(), predecessors.size(), mode,
+                           SchedulerCallable::from(std::forward<F>(cb), userData, usePSRAMBuffers_), taskCfg);
+    }
+    template <typename F, typename = scheduler_callable_detail::EnableNoData<F>>
+    uint32_t addJobAfter(std::initializer_list<uint32_t> predecessors,
+                         SchedulerJobMode mode,
+                         F&& cb,
+                         const SchedulerTaskConfig* taskCfg = nullptr) {
+        return addJobAfter(predecessors.begin(), predecessors.size(), mode,
+                           SchedulerCallable::from(std::forward<F>(cb), usePSRAMBuffers_), taskCfg);
+    }
 
     bool cancelJob(uint32_t jobId);
     bool pauseJob(uint32_t jobId);
     bool resumeJob(uint32_t jobId);
     void cancelAll();
 
+    // Safe from any task or core: queue the change without blocking and let the next
+    // tick() (or cleanup()) apply it. postJob() returns the job id right away, or 0 if
+    // the schedule is invalid or the command queue is full or disabled. Posted commands
+    // run in the order they were posted; until then the job is invisible to getJobInfo()
+    // and the direct cancel/pause/resume calls.
+    uint32_t postJob(const Schedule& schedule,
+                     SchedulerJobMode mode,
+                     SchedulerCallback cb,
+                     void* userData = nullptr,
+                     const SchedulerTaskConfig* taskCfg = nullptr);
+    uint32_t postJob(const Schedule& schedule,
+                     SchedulerJobMode mode,
+                     SchedulerCallable cb,
+                     const SchedulerTaskConfig* taskCfg = nullptr);
+    template <typename F, typename = scheduler_callable_detail::EnableWithData<F>>
+    uint32_t postJob(const Schedule& schedule,
+                     SchedulerJobMode mode,
+                     F&& cb,
+                     void* userData = nullptr,
+                     const SchedulerTaskConfig* taskCfg = nullptr) {
+        return postJob(schedule, mode, SchedulerCallable::from(std::forward<F>(cb), userData, usePSRAMBuffers_), taskCfg);
+    }
+    template <typename F, typename = scheduler_callable_detail::EnableNoData<F>>
+    uint32_t postJob(const Schedule& schedule,
+                     SchedulerJobMode mode,
+                     F&& cb,
+                     const SchedulerTaskConfig* taskCfg = nullptr) {
+        return postJob(schedule, mode, SchedulerCallable::from(std::forward<F>(cb), usePSRAMBuffers_), taskCfg);
+    }
+    uint32_t postJob(const Schedule& schedule,
+                     const JobOptions& options,
+                     SchedulerJobMode mode,
+                     SchedulerCallable cb,
+                     const SchedulerTaskConfig* taskCfg = nullptr);
+    template <typename F, typename = scheduler_callable_detail::EnableWithData<F>>
+    uint32_t postJob(const Schedule& schedule,
+                     const JobOptions& options,
+                     SchedulerJobMode mode,
+                     F&& cb,
+                     void* userData = nullptr,
+                     const SchedulerTaskConfig* taskCfg = nullptr) {
+        return postJob(schedule, options, mode,
+                       SchedulerCallable::from(std::forward<F>(cb), userData, usePSRAMBuffers_), taskCfg);
+    }
+    template <typename F, typename = scheduler_callable_detail::EnableNoData<F>>
+    uint32_t postJob(const Schedule& schedule,
+                     const JobOptions& options,
+                     SchedulerJobMode mode,
+                     F&& cb,
+                     const SchedulerTaskConfig* taskCfg = nullptr) {
+        return postJob(schedule, options, mode, SchedulerCallable::from(std::forward<F>(cb), usePSRAMBuffers_),
+                       taskCfg);
+    }
+    bool postCancel(uint32_t jobId);
+    bool postPause(uint32_t jobId);
+    bool postResume(uint32_t jobId);
+    // Run the job once as soon as the command is applied, ahead of (and without moving)
+    // its schedule; ignored while the job is paused. A one-shot job is consumed by it.
+    bool postTrigger(uint32_t jobId);
+
+    // Interrupt-safe variants of the post* calls (commandQueueSize > 0): they only touch
+    // the lock-free command ring and then wake the task that last ran tick(). Pass
+    // higherPriorityTaskWoken to yield yourself; with nullptr they call portYIELD_FROM_ISR.
+    bool triggerNowFromISR(uint32_t jobId, BaseType_t* higherPriorityTaskWoken = nullptr);
+    uint32_t postJobFromISR(const Schedule& schedule,
+                            SchedulerJobMode mode,
+                            SchedulerCallback cb,
+                            void* userData = nullptr,
+                            BaseType_t* higherPriorityTaskWoken = nullptr);
+    // Deferred one-shot: runs cb once on the next tick() (or right away on a worker),
+    // independent of the wall clock.
+    uint32_t runOnceFromISR(SchedulerJobMode mode,
+                            SchedulerCallback cb,
+                            void* userData = nullptr,
+                            BaseType_t* higherPriorityTaskWoken = nullptr);
+    // Block the calling tick() task until a post*/ISR command arrives, the next inline
+    // job is due, or maxWaitMs passes. Uses the task's notification value.
+    void waitForWork(uint32_t maxWaitMs = 1000);
+
     void tick(const DateTime& nowUtc);
     void tick();
+    // Bounded tick(): once budgetMicros of esp_timer time have passed since the call
+    // began, no further inline job is started (at least one always runs). Triggered
+    // runs and dependents count too. Due jobs left over keep their place and run first
+    // on the next call, highest JobOptions::priority first. Returns true while such
+    // work is pending; 0 = no budget.
+    bool tick(const DateTime& nowUtc, uint32_t budgetMicros);
     void cleanup();
 
     bool computeNextOccurrence(const Schedule& schedule,
                                const DateTime& fromUtc,
                                DateTime& outNextUtc) const;
+    // Fill out[0..n) with consecutive occurrences starting at fromUtc; returns how many were found.
+    size_t computeNextOccurrences(const Schedule& schedule,
+                                  const DateTime& fromUtc,
+                                  DateTime* out,
+                                  size_t n) const;
 
+    // index-th live job (inline jobs first). Each call walks the table from the
+    // start, so use forEachJob() or listJobs() to enumerate.
     bool getJobInfo(size_t index, JobInfo& out) const;
+    // Walk every live job once, in getJobInfo() order, reporting cached next runs
+    // without searching. A visitor returning false stops the walk. Call it from
+    // the tick() task and do not add or cancel jobs from the visitor. Returns the
+    // number of jobs visited.
+    using JobVisitor = bool (*)(const JobSummary& job, void* userData);
+    size_t forEachJob(JobVisitor visitor, void* userData = nullptr) const;
+    template <typename Visitor>
+    size_t forEachJob(Visitor&& visitor) const {
+        using Fn = typename std::remove_reference<Visitor>::type;
+        return forEachJob(&visitJob<Fn>, const_cast<void*>(static_cast<const void*>(&visitor)));
+    }
+    // Copy up to capacity summaries into out; returns how many were written.
+    size_t listJobs(JobSummary* out, size_t capacity) const;
+    // Run count, callback duration, lateness, overruns and missed slots of one job.
+    // Safe from any task for worker jobs; inline job stats change during tick().
+    bool getJobStats(uint32_t jobId, JobStats& out) const;
+
+    // Event trace (traceBufferSize > 0). Moves up to maxRecords of the oldest records
+    // into out and returns how many were moved. Safe from any task.
+    size_t drainTrace(SchedulerTraceRecord* out, size_t maxRecords);
+    // Writes the pending records to anything with write(const uint8_t*, size_t), such as
+    // Serial or an SD card File, behind a Sync record that anchors them to the wall clock.
+    // tools/trace_decode turns the captured bytes into a timeline.
+    template <typename Sink>
+    size_t drainTrace(Sink& sink) {
+        SchedulerTraceRecord record{};
+        if (!m_trace || !m_trace->pop(record)) {
+            return 0;
+        }
+        SchedulerTraceRecord sync{};
+        sync.timeUs = static_cast<uint32_t>(esp_timer_get_time());
+        sync.jobId = kSchedulerTraceSyncMagic;
+        sync.value = static_cast<int32_t>(static_cast<uint32_t>(m_date.now().epochSeconds));
+        sync.event = static_cast<uint8_t>(SchedulerTraceEvent::Sync);
+        sink.write(reinterpret_cast<const uint8_t*>(&sync), sizeof(sync));
+        size_t count = 0;
+        do {
+            sink.write(reinterpret_cast<const uint8_t*>(&record), sizeof(record));
+            ++count;
+        } while (m_trace->pop(record));
+        return count;
+    }
+    // Records lost because the ring was full.
+    uint32_t traceDropped() const;
+
+    // Job table persistence for jobs with JobOptions::persistKey. Call loadSnapshot() once
+    // at boot before re-adding jobs: a job whose key, mode and schedule match its stored
+    // record resumes the stored next run (no occurrence search), pause state and last
+    // run, and a keyed one-shot that already ran is not added again (addJob() returns 0).
+    // A snapshot taken under another TZ restores only pause and last-run state.
+    bool loadSnapshot(SchedulerSnapshotStore& store);
+    // Writes only the records that changed since the last save (or load), then the
+    // header. Call it after every keyed job is back: records of keys that were not
+    // re-added, and of recurring jobs that were cancelled, are erased.
+    bool saveSnapshot(SchedulerSnapshotStore& store);
+
+    // Worker pool metrics: due runs waiting for a free dispatcher, and the peak seen so far.
+    size_t workerQueueDepth() const;
+    size_t workerQueueHighWater() const;
+
+protected:
+    // Fixed-capacity mode behind ESPSchedulerStatic: every container is sized for
+    // fixedJobCapacity inline jobs up front, so adding, firing and cancelling jobs
+    // never allocates. addJob() returns 0 once full and for WorkerTask jobs.
+    ESPScheduler(ESPDate& date, const ESPSchedulerConfig& config, size_t fixedJobCapacity);
+    // Slot the next inline addJob() will occupy (job id & 0xFFFF), or SIZE_MAX when full.
+    size_t nextInlineSlot() const;
 
 private:
+    static constexpr size_t kNotQueued = static_cast<size_t>(-1);
+    static constexpr int64_t kUnresolvedDeadline = INT64_MIN;
+    // Job ids pack [generation:15][worker:1][slot:16]. Inline and worker jobs live
+    // in their own slot arrays; a freed slot bumps its generation so old ids miss.
+    static constexpr uint32_t kJobSlotBits = 16;
+    static constexpr size_t kMaxJobSlots = static_cast<size_t>(1) << kJobSlotBits;
+    static constexpr uint32_t kJobWorkerFlag = static_cast<uint32_t>(1) << kJobSlotBits;
+    static constexpr uint32_t kJobGenerationShift = kJobSlotBits + 1;
+    static constexpr uint16_t kJobGenerationMask = 0x7FFF;
+    static constexpr int kReadyRankShift = 48;
+    static constexpr uint64_t kReadySequenceMask = (static_cast<uint64_t>(1) << kReadyRankShift) - 1;
+
     struct InlineJob {
         uint32_t id = 0;
-        Schedule schedule{};
-        SchedulerFunction callback{};
-        void* userData = nullptr;
+        uint16_t generation = 1;
+        bool live = false;
+        uint32_t scheduleRef = 0;  // entry in m_schedules, see scheduleOf()
+        JobOptions options{};
+        uint32_t splayOffset = 0;  // options.splayOffsetFor(schedule), fixed by addJob()
+        SchedulerCallable callback{};
         DateTime nextRunUtc{};
+        ScheduleCursor cursor{};
+        int64_t nextDueUs = 0;  // interval schedules
+        size_t queuePos = kNotQueued;
         bool hasNext = false;
         bool paused = false;
         bool finished = false;
+        bool triggered = false;  // in m_triggeredInline
+        bool ready = false;      // due and waiting in m_readyQueue
+        int64_t lastRunUtc = 0;  // wall clock of the last run, for snapshots
+        bool hasDependents = false;  // a predecessor in m_dependencies
+        JobStatsRecorder stats{};
+    };
+
+    // Min-heap entry ordering inline jobs by their next deadline: epoch seconds in
+    // the calendar queue, esp_timer microseconds in the interval queue. Jobs that
+    // have not computed a deadline yet sit at the front so the next tick resolves them.
+    // In the ready queue, due is a rank: inverted priority above the order jobs came due.
+    struct InlineQueueEntry {
+        int64_t due = 0;
+        size_t jobIndex = 0;
+    };
+    using InlineQueue = SchedulerVector<InlineQueueEntry>;
+
+    // Exit handshake between a dedicated worker task and the scheduler: the task
+    // is only deleted once both sides agree, so a wake-up never targets a dead task.
+    enum class WorkerTaskState : uint8_t {
+        Running,
+        Exited,    // task finished and parks until the scheduler reaps it
+        Detached   // scheduler dropped the job; the task deletes itself on exit
     };
 
     struct WorkerJobContext {
         Schedule schedule{};
-        SchedulerFunction callback{};
-        void* userData = nullptr;
+        JobOptions options{};
+        uint32_t splayOffset = 0;  // options.splayOffsetFor(schedule), fixed by addJob()
+        SchedulerCallable callback{};
         ESPDate* date = nullptr;
         std::shared_ptr<std::atomic<int64_t>> minValidEpochSeconds{};
+        std::shared_ptr<std::atomic<uint32_t>> exitedWorkers{};
         std::atomic<bool> paused{false};
         std::atomic<bool> cancelRequested{false};
         std::atomic<bool> finished{false};
+        std::atomic<bool> triggered{false};  // dedicated task only
+        std::atomic<WorkerTaskState> taskState{WorkerTaskState::Running};
         DateTime nextRunUtc{};
+        ScheduleCursor cursor{};
+        std::atomic<int64_t> nextDueUs{0};  // interval schedules
         bool hasNext = false;
+        // Dedicated task only: nextRunUtc as published for getJobInfo(), or kUnresolvedDeadline.
+        std::atomic<int64_t> publishedNextUtc{kUnresolvedDeadline};
+        SchedulerLocalTimeCache localTime{};  // dedicated task only
+        JobStatsRecorder stats{};
+        std::atomic<int64_t> lastRunUtc{0};  // wall clock of the last run, for snapshots
+        BaseType_t poolCore = tskNO_AFFINITY;  // per-core pool: only dispatchers on this core run it
+        // Runs completed so far. With dependents, each completion also bumps the shared
+        // counter and wakes the tick task, which compares the counts (see m_dependencies).
+        std::atomic<uint32_t> completedRuns{0};
+        std::atomic<bool> hasDependents{false};
+        std::shared_ptr<std::atomic<uint32_t>> completions{};
+        std::shared_ptr<std::atomic<TaskHandle_t>> tickTask{};
+        uint32_t jobId = 0;
+        std::shared_ptr<SchedulerTrace> trace{};
+        std::shared_ptr<std::atomic<uint32_t>> clockGeneration{};
+        uint32_t clockGenerationSeen = 0;     // dedicated task only
+        SchedulerClockWatch clockWatch{};     // dedicated task only
+
+        // Worker pool bookkeeping, guarded by the pool lock. poolDue uses the
+        // clock of the heap the job sits in (epoch seconds or esp_timer microseconds).
+        int64_t poolDue = 0;
+        int64_t poolReadyDueUs = 0;  // esp_timer instant the pending run became due
+        size_t poolHeapPos = kNotQueued;
+        uint8_t maxConcurrentRuns = 1;
+        uint8_t runningCount = 0;
+        uint8_t pendingRuns = 0;
+        bool inReadyQueue = false;
+        bool poolParked = false;  // paused, listed in WorkerPool::parked
+        bool exhausted = false;
+    };
+
+    // Interns calendar schedules so jobs that share one search for each occurrence
+    // once. Schedules are reduced to a canonical key (field masks with "any" spelled
+    // out, plus the splay offset) and hashed into a small direct-mapped table whose
+    // slots remember the last step taken from a given cursor position. A collision
+    // only costs a repeated search. Not thread-safe, like the local-time cache it is
+    // paired with: the tick loop and the pool dispatcher own one each.
+    class OccurrenceCache {
+    public:
+        // Same contract as stepping a ScheduleCursor by hand; one-shot and interval
+        // schedules go straight through.
+        bool advance(const Schedule& schedule,
+                     uint32_t splayOffset,
+                     ScheduleCursor& cursor,
+                     SchedulerLocalTimeCache& localTime,
+                     DateTime& outNextUtc);
+
+    private:
+        static constexpr size_t kEntries = 16;
+
+        struct Key {
+            uint64_t minuteMask = 0;
+            uint32_t hourMask = 0;
+            uint32_t dayOfMonthMask = 0;
+            uint16_t monthMask = 0;
+            uint8_t dayOfWeekMask = 0;
+            uint8_t anyDays = 0;  // bit 0 day of month, bit 1 weekday: they combine with OR unless "any"
+            uint32_t splayOffset = 0;
+
+            bool operator==(const Key& other) const;
+        };
+
+        struct Entry {
+            Key key{};
+            int64_t fromUtc = 0;  // where the cursor stood: lastUtc once started, else fromUtc
+            bool started = false;
+            bool used = false;
+            bool hasNext = false;
+            ScheduleCursor cursor{};  // after the step
+            DateTime nextUtc{};
+        };
+
+        static Key keyFor(const Schedule& schedule, uint32_t splayOffset);
+        static size_t slotFor(const Key& key);
+
+        Entry m_entries[kEntries];
+        uint32_t m_generation = 0;
     };
 
+    // Holds one copy of each distinct schedule the inline jobs use; a job keeps the
+    // index of its entry instead of a Schedule of its own. Entries are refcounted,
+    // found by hash on addJob() and recycled once the last job using them is removed.
+    // Worker jobs keep their copy in WorkerJobContext, which a pool dispatcher or task
+    // may still read after the scheduler has gone. Used by the tick loop only.
+    class ScheduleTable {
+    public:
+        explicit ScheduleTable(bool usePSRAMBuffers);
+
+        // Index of the entry equal to schedule, created if needed, with one more reference.
+        uint32_t acquire(const Schedule& schedule);
+        void release(uint32_t index);
+        const Schedule& operator[](uint32_t index) const { return m_entries[index].schedule; }
+        // Room for count distinct schedules, so acquiring up to that many never allocates.
+        void reserve(size_t count);
+        void clear();
+
+    private:
+        static constexpr uint32_t kNone = UINT32_MAX;
+
+        struct Entry {
+            Schedule schedule{};
+            uint32_t hash = 0;
+            uint32_t refs = 0;
+            uint32_t next = kNone;  // bucket chain while in use, free list once released
+        };
+
+        static uint32_t hashOf(const Schedule& schedule);
+        static bool sameSchedule(const Schedule& a, const Schedule& b);
+        void rehash(size_t bucketCount);
+        void link(uint32_t index);
+
+        bool m_usePSRAMBuffers = false;
+        SchedulerVector<Entry> m_entries;
+        SchedulerVector<uint32_t> m_buckets;  // power-of-two sized heads of the bucket chains
+        uint32_t m_freeHead = kNone;
+    };
+
+    struct WorkerPool;
+    struct PoolTaskArgs;
+
     struct WorkerJob {
         uint32_t id = 0;
+        uint16_t generation = 1;
         std::shared_ptr<WorkerJobContext> context{};
         TaskHandle_t task = nullptr;
     };
 
-    uint32_t nextId();
+    enum class CommandOp : uint8_t {
+        Add,
+        Cancel,
+        Pause,
+        Resume,
+        Trigger
+    };
+
+    // Job change posted from another task; Add carries the job's reserved id.
+    struct Command {
+        CommandOp op = CommandOp::Cancel;
+        uint32_t jobId = 0;
+        SchedulerJobMode mode = SchedulerJobMode::Inline;
+        bool hasTaskConfig = false;
+        bool runNow = false;  // Add: trigger right after installing
+        SchedulerTaskConfig taskConfig{};
+        Schedule schedule{};
+        JobOptions options{};
+        SchedulerCallable callback{};
+    };
+
+    // A keyed job known to the snapshot: loaded by loadSnapshot() and/or added since.
+    // savedCrc is the CRC of the record as last loaded or written (0: not in the store).
+    struct PersistedJob {
+        SchedulerSnapshotRecord record{};
+        uint32_t jobId = 0;  // 0 until addJob() claims the key this boot
+        uint32_t savedCrc = 0;
+        bool claimed = false;
+    };
+
+    template <typename Fn>
+    static bool visitJob(const JobSummary& job, void* userData) {
+        Fn& visitor = *static_cast<Fn*>(userData);
+        if constexpr (std::is_void<decltype(visitor(job))>::value) {
+            visitor(job);
+            return true;
+        } else {
+            return static_cast<bool>(visitor(job));
+        }
+    }
+
+    // A job started by the completion of others (addJobAfter). A predecessor's bit in
+    // doneMask is set once it completes a run; when all are set the job is triggered
+    // and the mask starts over.
+    struct JobDependency {
+        uint32_t jobId = 0;
+        uint8_t count = 0;
+        uint8_t doneMask = 0;
+        uint32_t predecessors[kMaxJobPredecessors] = {};
+        uint32_t seenRuns[kMaxJobPredecessors] = {};  // worker predecessors: completedRuns already counted
+    };
+
+    static uint32_t makeJobId(size_t slot, uint16_t generation, bool worker);
+    static uint16_t nextGeneration(uint16_t generation);
+    size_t findInlineSlot(uint32_t jobId) const;
+    size_t findWorkerSlot(uint32_t jobId) const;
+    size_t acquireInlineSlot();
+    size_t acquirePostedSlot();
+    size_t acquireWorkerSlot();
+    void releaseWorkerSlot(size_t slot);
+    uint32_t installJob(size_t slot, const Schedule& schedule, const JobOptions& requested, SchedulerJobMode mode,
+                        SchedulerCallable cb, const SchedulerTaskConfig* taskCfg);
+    bool postCommand(CommandOp op, uint32_t jobId);
+    uint32_t postAdd(const Schedule& schedule,
+                     const JobOptions& options,
+                     SchedulerJobMode mode,
+                     SchedulerCallable cb,
+                     const SchedulerTaskConfig* taskCfg,
+                     bool runNow);
+    void wakeTickTask();
+    void wakeTickTaskFromISR(BaseType_t* higherPriorityTaskWoken);
+    void triggerJob(uint32_t jobId);
+    bool dispatchTriggeredJobs(const DateTime& nowUtc, int64_t startUs, uint32_t budgetMicros, bool& ranOne);
+    void initCommandQueue();
+    void drainCommands();
+    void applyPostedAdd(Command& command);
+    void refillPostedIds();
     bool validateSchedule(const Schedule& schedule) const;
+    bool fixedCapacityAllows(const JobOptions& options) const;
     bool fieldWithinRange(const ScheduleField& field, int min, int max) const;
     uint64_t allowedMask(int min, int max) const;
     static void runWorkerJob(const std::shared_ptr<WorkerJobContext>& ctx);
+    static void runIntervalWorkerJob(const std::shared_ptr<WorkerJobContext>& ctx);
     SchedulerTaskConfig makeTaskConfig(const SchedulerTaskConfig* taskCfg) const;
     static void workerTaskEntry(void* arg);
+    void wakeWorker(const WorkerJob& job);
+    void wakeAllWorkers();
+    void cancelWorker(WorkerJob& job);
+    void releaseWorker(WorkerJob& job);
+    static bool runTriggeredWorkerJob(const std::shared_ptr<WorkerJobContext>& ctx);
+    static void noteWorkerCompletion(WorkerJobContext& ctx);
+    bool jobExists(uint32_t jobId) const;
+    void noteInlineCompletion(uint32_t jobId);
+    void collectWorkerCompletions();
+    void collectWorkerRuns(const WorkerJob& job);
+    void settleDependencies();
+    static void poolTaskEntry(void* arg);
+    static void runPoolDispatcher(const std::shared_ptr<WorkerPool>& pool, BaseType_t core);
+    bool ensureWorkerPool();
+    const Schedule& scheduleOf(const InlineJob& job) const { return m_schedules[job.scheduleRef]; }
+    InlineQueue& queueFor(const InlineJob& job);
+    void queuePush(InlineQueue& queue, size_t jobIndex, int64_t due);
+    void queueUpdate(InlineQueue& queue, size_t pos, int64_t due);
+    void queueRemove(InlineQueue& queue, size_t pos);
+    void queueSiftUp(InlineQueue& queue, size_t pos);
+    void queueSiftDown(InlineQueue& queue, size_t pos);
+    void queueSet(InlineQueue& queue, size_t pos, const InlineQueueEntry& entry);
+    void queueInlineJob(size_t jobIndex);
+    bool invokeInlineJob(size_t jobIndex, int64_t dueUs, const DateTime& nowUtc);
+    void promoteCalendarJobs(const DateTime& nowUtc);
+    void promoteIntervalJobs();
+    void pushReady(size_t jobIndex);
+    bool dispatchReadyJobs(const DateTime& nowUtc, int64_t startUs, uint32_t budgetMicros, bool& ranOne);
+    bool runReadyCalendarJob(size_t index, const DateTime& nowUtc, int64_t nowUs);
+    bool runReadyIntervalJob(size_t index, const DateTime& nowUtc);
+    void watchClock(const DateTime& nowUtc);
+    void rescheduleInlineCalendarJobs(int64_t afterUtc);
+    void finishInlineJob(size_t jobIndex);
+    void removeInlineJobAt(size_t jobIndex);
     void cleanupInline();
     void cleanupWorkers();
     bool clockValid(const DateTime& nowUtc) const;
     void ensureInitialized();
+    void reserveFixedCapacity();
+    void trace(SchedulerTraceEvent event, uint32_t jobId, int64_t value = 0, uint8_t detail = 0);
+    PersistedJob* findPersisted(uint32_t key);
+    bool persistedJobBlocksAdd(const Schedule& schedule, const JobOptions& options, SchedulerJobMode mode);
+    bool claimPersisted(uint32_t jobId, const Schedule& schedule, const JobOptions& options, SchedulerJobMode mode,
+                        SchedulerSnapshotRecord& restored);
+    void releasePersisted(uint32_t key);
+    bool snapshotRecordFor(uint32_t jobId, SchedulerSnapshotRecord& record) const;
 
     ESPDate& m_date;
-    uint32_t m_nextId = 1;
     int64_t m_minValidEpochSeconds = kDefaultMinValidEpochSeconds;
     std::shared_ptr<std::atomic<int64_t>> m_minValidEpochSecondsRef;
+    std::shared_ptr<std::atomic<uint32_t>> m_exitedWorkersRef;
+    uint32_t m_exitedWorkersSeen = 0;
+    // Bumped by notifyClockChanged(); the tick loop, workers and pool each reschedule once per bump.
+    std::shared_ptr<std::atomic<uint32_t>> m_clockGenerationRef;
+    uint32_t m_clockGenerationSeen = 0;
+    // Bumped when a worker job with dependents completes a run.
+    std::shared_ptr<std::atomic<uint32_t>> m_completionsRef;
+    uint32_t m_completionsSeen = 0;
+    uint32_t m_clockStepThresholdSeconds = 0;
+    SchedulerClockWatch m_clockWatch{};
     std::atomic<bool> m_initialized{true};
     bool usePSRAMBuffers_ = false;
+    size_t m_fixedJobCapacity = 0;  // 0: containers grow on demand
+    bool m_dispatchingInline = false;
+    size_t m_inFlightInline = kNotQueued;
+    // Shared by every reschedule the tick loop performs; tick() is single-threaded.
+    SchedulerLocalTimeCache m_localTimeCache{};
+    OccurrenceCache m_occurrences{};
+    ScheduleTable m_schedules;
     SchedulerVector<InlineJob> m_inlineJobs;
+    InlineQueue m_inlineQueue;
+    InlineQueue m_intervalQueue;
+    InlineQueue m_readyQueue;  // due jobs a budgeted tick() has not reached yet
+    uint64_t m_readySequence = 0;
+    SchedulerVector<size_t> m_finishedInline;
+    SchedulerVector<size_t> m_triggeredInline;
+    SchedulerVector<size_t> m_freeInlineSlots;
+    SchedulerVector<size_t> m_freePostedSlots;  // fixed capacity only: the slots past it
     SchedulerVector<WorkerJob> m_workerJobs;
+    SchedulerVector<size_t> m_freeWorkerSlots;
+    uint8_t m_workerPoolSize = 0;
+    SchedulerTaskConfig m_workerPoolTask{};
+    bool m_workerPoolPerCore = false;
+    std::shared_ptr<WorkerPool> m_workerPool;
+    // Cross-task command queue plus the ids reserved for posted jobs. Slots behind a
+    // reserved id carry that id but stay out of every lookup until the Add is drained.
+    uint16_t m_commandQueueSize = 0;
+    SchedulerRing<Command> m_commands;
+    SchedulerRing<uint32_t> m_postedInlineIds;
+    SchedulerRing<uint32_t> m_postedWorkerIds;
+    size_t m_reservedInlineIds = 0;
+    size_t m_reservedWorkerIds = 0;
+    // Woken by post*, the ISR calls and worker predecessors completing a run.
+    std::shared_ptr<std::atomic<TaskHandle_t>> m_tickTaskRef;
+    // Shared with worker tasks and the pool, which may outlive a deinit().
+    std::shared_ptr<SchedulerTrace> m_trace;
+    bool m_traceClockInvalid = false;  // tick() records only the change to an invalid clock
+    SchedulerVector<PersistedJob> m_persisted;
+    uint32_t m_snapshotTimeZone = 0;   // TZ hash in the stored header; 0 before load/save
+    bool m_snapshotKeysDirty = false;  // key set changed since the header was last written
+    SchedulerVector<JobDependency> m_dependencies;
 };
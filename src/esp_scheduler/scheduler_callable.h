@@ -0,0 +1,203 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "scheduler_allocator.h"
+
+// Inline capture budget of SchedulerCallable: at least 24 bytes whatever the pointer
+// width, so on the ESP32 a lambda with up to six word-sized captures, or a
+// std::function (SchedulerFunction) bound to its userData, needs no allocation.
+// 64-bit hosts get five words so the same std::function binding fits there too.
+#ifndef ESP_SCHEDULER_CALLABLE_INLINE_BYTES
+#define ESP_SCHEDULER_CALLABLE_INLINE_BYTES (5 * sizeof(void*) > 24 ? 5 * sizeof(void*) : 24)
+#endif
+
+using SchedulerCallback = void (*)(void* userData);
+
+class SchedulerCallable;
+
+namespace scheduler_callable_detail {
+template <typename F>
+using Decayed = typename std::decay<F>::type;
+
+// Callables taking no arguments; a SchedulerCallable itself uses the non-template overloads.
+template <typename F>
+using EnableNoData = typename std::enable_if<std::is_invocable<Decayed<F>&>::value &&
+                                             !std::is_same<Decayed<F>, SchedulerCallable>::value>::type;
+
+// Callables taking userData; plain SchedulerCallback pointers use the non-template overloads.
+template <typename F>
+using EnableWithData = typename std::enable_if<std::is_invocable<Decayed<F>&, void*>::value &&
+                                               !std::is_same<Decayed<F>, SchedulerCallback>::value>::type;
+
+// Empty std::function objects and null function pointers are rejected like before.
+template <typename F>
+bool isEmpty(const F& fn) {
+    if constexpr (std::is_pointer<F>::value) {
+        return fn == nullptr;
+    } else if constexpr (std::is_constructible<bool, const F&>::value && !std::is_convertible<const F&, bool>::value) {
+        return !static_cast<bool>(fn);  // explicit operator bool, e.g. std::function
+    } else {
+        return false;
+    }
+}
+
+template <typename F>
+struct WithData {
+    F fn;
+    void* userData;
+    void operator()() { fn(userData); }
+};
+
+template <typename T>
+struct MemberCall {
+    T* object;
+    void (T::*method)();
+    void operator()() { (object->*method)(); }
+};
+}  // namespace scheduler_callable_detail
+
+// Move-only `void()` callable used by the job records. Targets up to
+// ESP_SCHEDULER_CALLABLE_INLINE_BYTES live inside the object; larger ones go
+// through the scheduler allocator (PSRAM when requested, default heap otherwise).
+// userData is bound into the target, so jobs need no separate field for it.
+class SchedulerCallable {
+public:
+    static constexpr size_t kInlineBytes = ESP_SCHEDULER_CALLABLE_INLINE_BYTES;
+    static_assert(kInlineBytes >= sizeof(void*), "the inline buffer must hold at least one pointer");
+
+    SchedulerCallable() = default;
+    SchedulerCallable(SchedulerCallback fn, void* userData) {
+        if (fn) {
+            emplace(scheduler_callable_detail::WithData<SchedulerCallback>{fn, userData}, false);
+        }
+    }
+    template <typename T>
+    SchedulerCallable(T* object, void (T::*method)()) {
+        if (object && method) {
+            emplace(scheduler_callable_detail::MemberCall<T>{object, method}, false);
+        }
+    }
+
+    SchedulerCallable(SchedulerCallable&& other) noexcept { moveFrom(other); }
+    SchedulerCallable& operator=(SchedulerCallable&& other) noexcept {
+        if (this != &other) {
+            reset();
+            moveFrom(other);
+        }
+        return *this;
+    }
+    SchedulerCallable(const SchedulerCallable&) = delete;
+    SchedulerCallable& operator=(const SchedulerCallable&) = delete;
+    ~SchedulerCallable() { reset(); }
+
+    // Wraps a no-argument callable. Empty std::function or null pointers leave it empty.
+    template <typename F, typename = scheduler_callable_detail::EnableNoData<F>>
+    static SchedulerCallable from(F&& fn, bool usePSRAMBuffers = false) {
+        SchedulerCallable callable;
+        if (!scheduler_callable_detail::isEmpty(fn)) {
+            callable.emplace(scheduler_callable_detail::Decayed<F>(std::forward<F>(fn)), usePSRAMBuffers);
+        }
+        return callable;
+    }
+
+    // Wraps a callable taking userData, binding userData into the target.
+    template <typename F, typename = scheduler_callable_detail::EnableWithData<F>>
+    static SchedulerCallable from(F&& fn, void* userData, bool usePSRAMBuffers = false) {
+        SchedulerCallable callable;
+        if (!scheduler_callable_detail::isEmpty(fn)) {
+            using Target = scheduler_callable_detail::WithData<scheduler_callable_detail::Decayed<F>>;
+            callable.emplace(Target{std::forward<F>(fn), userData}, usePSRAMBuffers);
+        }
+        return callable;
+    }
+
+    explicit operator bool() const { return m_ops != nullptr; }
+    // Safe to call from several tasks at once if the target itself is.
+    void operator()() const { m_ops->invoke(target()); }
+
+    // True when the target was too large for the inline buffer.
+    bool onHeap() const { return m_ops && m_ops->heap; }
+
+    void reset() {
+        if (m_ops) {
+            m_ops->destroy(target());
+            if (m_ops->heap) {
+                scheduler_allocator_detail::deallocate(m_heap);
+            }
+            m_ops = nullptr;
+        }
+    }
+
+private:
+    struct Ops {
+        void (*invoke)(void* target);
+        void (*relocate)(void* dst, void* src);  // inline targets only
+        void (*destroy)(void* target);
+        bool heap;
+    };
+
+    template <typename T>
+    static void invokeTarget(void* target) {
+        (*static_cast<T*>(target))();
+    }
+    template <typename T>
+    static void relocateTarget(void* dst, void* src) {
+        ::new (dst) T(std::move(*static_cast<T*>(src)));
+        static_cast<T*>(src)->~T();
+    }
+    template <typename T>
+    static void destroyTarget(void* target) {
+        static_cast<T*>(target)->~T();
+    }
+
+    template <typename T>
+    static constexpr bool fitsInline() {
+        return sizeof(T) <= kInlineBytes && alignof(T) <= alignof(void*) &&
+               std::is_nothrow_move_constructible<T>::value;
+    }
+
+    template <typename T>
+    void emplace(T&& value, bool usePSRAMBuffers) {
+        using Target = scheduler_callable_detail::Decayed<T>;
+        if constexpr (fitsInline<Target>()) {
+            static constexpr Ops ops{&invokeTarget<Target>, &relocateTarget<Target>, &destroyTarget<Target>, false};
+            ::new (static_cast<void*>(m_storage)) Target(std::forward<T>(value));
+            m_ops = &ops;
+        } else {
+            static constexpr Ops ops{&invokeTarget<Target>, nullptr, &destroyTarget<Target>, true};
+            void* memory = scheduler_allocator_detail::allocate(sizeof(Target), usePSRAMBuffers);
+            if (!memory) {
+                return;  // leaves the callable empty; addJob() reports 0
+            }
+            m_heap = ::new (memory) Target(std::forward<T>(value));
+            m_ops = &ops;
+        }
+    }
+
+    void moveFrom(SchedulerCallable& other) noexcept {
+        if (!other.m_ops) {
+            return;
+        }
+        if (other.m_ops->heap) {
+            m_heap = other.m_heap;
+        } else {
+            other.m_ops->relocate(m_storage, other.m_storage);
+        }
+        m_ops = other.m_ops;
+        other.m_ops = nullptr;
+    }
+
+    void* target() const {
+        return m_ops->heap ? m_heap : const_cast<unsigned char*>(m_storage);
+    }
+
+    union {
+        alignas(void*) unsigned char m_storage[kInlineBytes];
+        void* m_heap;
+    };
+    const Ops* m_ops = nullptr;
+};
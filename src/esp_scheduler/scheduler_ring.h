@@ -0,0 +1,103 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include "scheduler_allocator.h"
+
+// Bounded lock-free FIFO (Vyukov's sequence-numbered ring). Any number of tasks
+// may push and pop concurrently; neither side ever blocks or allocates once
+// init() has sized the buffer. Capacity is rounded up to a power of two.
+template <typename T>
+class SchedulerRing {
+public:
+    explicit SchedulerRing(bool usePSRAMBuffers = false)
+        : m_cells(SchedulerAllocator<Cell>(usePSRAMBuffers)), m_usePSRAMBuffers(usePSRAMBuffers) {}
+
+    SchedulerRing(const SchedulerRing&) = delete;
+    SchedulerRing& operator=(const SchedulerRing&) = delete;
+
+    // Not thread-safe: call before any task pushes or pops.
+    void init(size_t capacity) {
+        size_t size = 1;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        SchedulerVector<Cell>(size, SchedulerAllocator<Cell>(m_usePSRAMBuffers)).swap(m_cells);
+        for (size_t i = 0; i < size; ++i) {
+            m_cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        m_mask = size - 1;
+        m_enqueuePos.store(0, std::memory_order_relaxed);
+        m_dequeuePos.store(0, std::memory_order_relaxed);
+    }
+
+    // Not thread-safe: drops queued items and frees the buffer.
+    void release() {
+        SchedulerVector<Cell>(SchedulerAllocator<Cell>(m_usePSRAMBuffers)).swap(m_cells);
+        m_mask = 0;
+    }
+
+    bool enabled() const { return !m_cells.empty(); }
+    size_t capacity() const { return m_cells.size(); }
+
+    bool push(T&& value) {
+        if (m_cells.empty()) {
+            return false;
+        }
+        size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = m_cells[pos & m_mask];
+            const size_t seq = cell.sequence.load(std::memory_order_acquire);
+            const intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.value = std::move(value);
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;  // full
+            } else {
+                pos = m_enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool pop(T& out) {
+        if (m_cells.empty()) {
+            return false;
+        }
+        size_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = m_cells[pos & m_mask];
+            const size_t seq = cell.sequence.load(std::memory_order_acquire);
+            const intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (m_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    out = std::move(cell.value);
+                    cell.sequence.store(pos + m_mask + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;  // empty
+            } else {
+                pos = m_dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence{0};
+        T value{};
+    };
+
+    SchedulerVector<Cell> m_cells;
+    size_t m_mask = 0;
+    bool m_usePSRAMBuffers = false;
+    std::atomic<size_t> m_enqueuePos{0};
+    std::atomic<size_t> m_dequeuePos{0};
+};
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+#if defined(ESP_PLATFORM)
+#include "nvs.h"
+#endif
+
+// Where ESPScheduler::saveSnapshot() and loadSnapshot() keep the job table: a set
+// of small named blobs (one header plus one per persisted job). Keys are at most
+// 15 characters, the NVS limit.
+class SchedulerSnapshotStore {
+public:
+    virtual ~SchedulerSnapshotStore() = default;
+    // Fill exactly size bytes; false if the blob is missing or has another size.
+    virtual bool load(const char* key, uint8_t* out, size_t size) = 0;
+    virtual bool save(const char* key, const uint8_t* data, size_t size) = 0;
+    // Removing a blob that does not exist succeeds.
+    virtual bool erase(const char* key) = 0;
+};
+
+// One file per blob inside an existing directory: a host directory, or a mounted
+// LittleFS/SPIFFS/SD path on the device. Writes go through a temporary file and a
+// rename so a power cut never leaves a half-written record behind.
+class SchedulerFileSnapshotStore : public SchedulerSnapshotStore {
+public:
+    explicit SchedulerFileSnapshotStore(const char* directory) : m_directory(directory) {}
+
+    bool load(const char* key, uint8_t* out, size_t size) override {
+        char path[kPathSize];
+        if (!pathFor(key, "", path)) {
+            return false;
+        }
+        FILE* file = std::fopen(path, "rb");
+        if (!file) {
+            return false;
+        }
+        const bool ok = std::fread(out, 1, size, file) == size && std::fgetc(file) == EOF;
+        std::fclose(file);
+        return ok;
+    }
+
+    bool save(const char* key, const uint8_t* data, size_t size) override {
+        char path[kPathSize];
+        char temp[kPathSize];
+        if (!pathFor(key, "", path) || !pathFor(key, ".tmp", temp)) {
+            return false;
+        }
+        FILE* file = std::fopen(temp, "wb");
+        if (!file) {
+            return false;
+        }
+        const bool written = std::fwrite(data, 1, size, file) == size;
+        if (std::fclose(file) != 0 || !written) {
+            std::remove(temp);
+            return false;
+        }
+        return std::rename(temp, path) == 0;
+    }
+
+    bool erase(const char* key) override {
+        char path[kPathSize];
+        if (!pathFor(key, "", path)) {
+            return false;
+        }
+        FILE* file = std::fopen(path, "rb");
+        if (!file) {
+            return true;
+        }
+        std::fclose(file);
+        return std::remove(path) == 0;
+    }
+
+private:
+    static constexpr size_t kPathSize = 128;
+
+    bool pathFor(const char* key, const char* suffix, char (&out)[kPathSize]) const {
+        const int length = std::snprintf(out, kPathSize, "%s/%s%s", m_directory, key, suffix);
+        return length > 0 && static_cast<size_t>(length) < kPathSize;
+    }
+
+    const char* m_directory;
+};
+
+#if defined(ESP_PLATFORM)
+// Blobs in one NVS namespace; nvs_flash_init() must have run first. Every save
+// commits, and NVS wear-levels the flash underneath.
+class SchedulerNvsSnapshotStore : public SchedulerSnapshotStore {
+public:
+    explicit SchedulerNvsSnapshotStore(const char* nvsNamespace = "esp_sched") : m_namespace(nvsNamespace) {}
+
+    bool load(const char* key, uint8_t* out, size_t size) override {
+        nvs_handle_t handle = 0;
+        if (nvs_open(m_namespace, NVS_READONLY, &handle) != ESP_OK) {
+            return false;
+        }
+        size_t length = size;
+        const esp_err_t err = nvs_get_blob(handle, key, out, &length);
+        nvs_close(handle);
+        return err == ESP_OK && length == size;
+    }
+
+    bool save(const char* key, const uint8_t* data, size_t size) override {
+        nvs_handle_t handle = 0;
+        if (nvs_open(m_namespace, NVS_READWRITE, &handle) != ESP_OK) {
+            return false;
+        }
+        const bool ok = nvs_set_blob(handle, key, data, size) == ESP_OK && nvs_commit(handle) == ESP_OK;
+        nvs_close(handle);
+        return ok;
+    }
+
+    bool erase(const char* key) override {
+        nvs_handle_t handle = 0;
+        if (nvs_open(m_namespace, NVS_READWRITE, &handle) != ESP_OK) {
+            return false;
+        }
+        const esp_err_t err = nvs_erase_key(handle, key);
+        const bool ok = (err == ESP_OK || err == ESP_ERR_NVS_NOT_FOUND) && nvs_commit(handle) == ESP_OK;
+        nvs_close(handle);
+        return ok;
+    }
+
+private:
+    const char* m_namespace;
+};
+#endif
+
+// A persisted job as decoded from a snapshot. On the wire it is a fixed 64-byte
+// little-endian record with its own CRC-32, so one job can be rewritten alone;
+// the blob is named "sched.<key as 8 hex digits>".
+struct SchedulerSnapshotRecord {
+    static constexpr uint8_t kWorker = 0x01;
+    static constexpr uint8_t kPaused = 0x02;
+    static constexpr uint8_t kHasNext = 0x04;
+    static constexpr uint8_t kDone = 0x08;  // one-shot that ran (or was cancelled)
+
+    uint32_t key = 0;
+    uint8_t flags = 0;
+    // Schedule, packed: field masks (bit n = value n) with bit 0..4 of anyFields
+    // marking minute/hour/day/month/weekday as "any".
+    uint8_t kind = 0;  // 0 calendar, 1 one-shot, 2 interval, 3 on demand
+    uint8_t anyFields = 0;
+    uint8_t intervalMode = 0;
+    uint64_t minuteMask = 0;
+    uint32_t hourMask = 0;
+    uint32_t dayOfMonthMask = 0;
+    uint16_t monthMask = 0;
+    uint8_t dayOfWeekMask = 0;
+    uint32_t intervalMs = 0;
+    int64_t onceAtUtc = 0;
+    int64_t nextRunUtc = 0;  // calendar jobs with kHasNext
+    int64_t lastRunUtc = 0;  // 0 before the first run
+    uint32_t splayOffsetSeconds = 0;
+};
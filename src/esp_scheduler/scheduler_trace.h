@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "esp_timer.h"
+#include "scheduler_ring.h"
+
+enum class SchedulerTraceEvent : uint8_t {
+    Sync = 0,           // written by drainTrace(sink): value = wall clock (epoch seconds)
+    JobAdded = 1,       // detail = SchedulerJobMode, value = intervalMs (0 for calendar jobs)
+    JobCancelled = 2,
+    JobPaused = 3,
+    JobResumed = 4,
+    JobTriggered = 5,
+    Dispatch = 6,       // detail = SchedulerTraceRunner, value = start minus deadline (us)
+    Rescheduled = 7,    // detail = SchedulerTraceReschedule, value = time until the next run
+    ClockInvalid = 8,   // detail = SchedulerTraceRunner, value = wall clock that was rejected
+    WorkerCreated = 9,  // detail = 0 dedicated / 1 pool dispatcher, value = stack size
+    WorkerExited = 10,  // detail = 0 dedicated / 1 pool dispatcher
+    ClockStepped = 11,  // detail = SchedulerTraceRunner, value = step seen in seconds (0 if only TZ changed)
+};
+
+enum class SchedulerTraceRunner : uint8_t {
+    Inline = 0,
+    Worker = 1,  // dedicated worker task
+    Pool = 2,
+    Triggered = 0x80  // or-ed in: run requested by triggerNow rather than the schedule
+};
+
+enum class SchedulerTraceReschedule : uint8_t {
+    Done = 0,         // no further occurrence
+    Seconds = 1,      // value = seconds from now to the next calendar run
+    Microseconds = 2  // value = esp_timer microseconds to the next interval run
+};
+
+// Fixed 16-byte record, little-endian on every ESP32 target and on the host
+// decoder (tools/trace_decode). timeUs is the low half of esp_timer_get_time():
+// it wraps every ~71.6 minutes, so drain at least that often. sequence grows by
+// one per record, so a gap shows how many records were dropped while the ring was full.
+struct SchedulerTraceRecord {
+    uint32_t timeUs;
+    uint32_t jobId;
+    int32_t value;
+    uint16_t sequence;
+    uint8_t event;  // SchedulerTraceEvent
+    uint8_t detail;
+};
+static_assert(sizeof(SchedulerTraceRecord) == 16, "trace records are 16 bytes on the wire");
+
+// jobId of the Sync record that starts every drainTrace(sink) chunk ("ESTR").
+constexpr uint32_t kSchedulerTraceSyncMagic = 0x52545345;
+
+// Lock-free trace ring shared by the scheduler, its worker tasks and the pool
+// dispatchers. record() costs one atomic increment, one esp_timer read and a
+// ring push; when the ring is full the new record is dropped, never blocking.
+class SchedulerTrace {
+public:
+    explicit SchedulerTrace(bool usePSRAMBuffers) : m_ring(usePSRAMBuffers) {}
+
+    void init(size_t capacity) { m_ring.init(capacity); }
+    size_t capacity() const { return m_ring.capacity(); }
+
+    void record(SchedulerTraceEvent event, uint32_t jobId, int64_t value = 0, uint8_t detail = 0) {
+        SchedulerTraceRecord entry{};
+        entry.timeUs = static_cast<uint32_t>(esp_timer_get_time());
+        entry.jobId = jobId;
+        entry.value = saturate(value);
+        entry.sequence = static_cast<uint16_t>(m_sequence.fetch_add(1, std::memory_order_relaxed));
+        entry.event = static_cast<uint8_t>(event);
+        entry.detail = detail;
+        if (!m_ring.push(std::move(entry))) {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    bool pop(SchedulerTraceRecord& out) { return m_ring.pop(out); }
+    uint32_t dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+
+private:
+    static int32_t saturate(int64_t value) {
+        if (value > INT32_MAX) {
+            return INT32_MAX;
+        }
+        if (value < INT32_MIN) {
+            return INT32_MIN;
+        }
+        return static_cast<int32_t>(value);
+    }
+
+    SchedulerRing<SchedulerTraceRecord> m_ring;
+    std::atomic<uint32_t> m_sequence{0};
+    std::atomic<uint32_t> m_dropped{0};
+};
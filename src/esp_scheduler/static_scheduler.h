@@ -0,0 +1,147 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "scheduler.h"
+
+// Inline-only scheduler with a compile-time job capacity. All job storage is
+// reserved by the constructor and capturing callables are copied into a per-slot
+// buffer of CallableBytes, so adding, firing and cancelling jobs never touches the
+// heap afterwards. addJob() returns 0 once MaxJobs jobs are live and for
+// WorkerTask jobs (those need a heap-allocated task stack). Captures must be
+// trivially destructible and fit CallableBytes; both are checked at compile time.
+// Features whose tables grow on the heap are refused: keyed jobs
+// (JobOptions::persistAs) return 0, loadSnapshot()/saveSnapshot() return false and
+// addJobAfter() returns 0. With ESPSchedulerConfig::commandQueueSize > 0 the
+// constructor also reserves one slot per command-ring entry (the size rounded up to
+// a power of two) for postJob(), on top of MaxJobs. postJob() returns 0 while all of
+// those hold live posted jobs; a posted callable must fit SchedulerCallable's inline
+// buffer or it is allocated.
+template <size_t MaxJobs, size_t CallableBytes = 24>
+class ESPSchedulerStatic : public ESPScheduler {
+    static_assert(MaxJobs > 0 && MaxJobs <= 65536, "MaxJobs must be in 1..65536");
+    static_assert(CallableBytes >= sizeof(void*), "CallableBytes must hold at least one pointer");
+
+public:
+    explicit ESPSchedulerStatic(ESPDate& date, const ESPSchedulerConfig& config = ESPSchedulerConfig{})
+        : ESPScheduler(date, config, MaxJobs) {}
+
+    static constexpr size_t capacity() { return MaxJobs; }
+
+    using ESPScheduler::addJob;
+    using ESPScheduler::addJobOnceUtc;
+
+    template <typename F, typename = scheduler_callable_detail::EnableNoData<F>>
+    uint32_t addJob(const Schedule& schedule,
+                    SchedulerJobMode mode,
+                    F&& fn,
+                    const SchedulerTaskConfig* taskCfg = nullptr) {
+        return addJob(schedule, JobOptions{}, mode, std::forward<F>(fn), taskCfg);
+    }
+
+    template <typename F, typename = scheduler_callable_detail::EnableWithData<F>>
+    uint32_t addJob(const Schedule& schedule,
+                    SchedulerJobMode mode,
+                    F&& fn,
+                    void* userData = nullptr,
+                    const SchedulerTaskConfig* taskCfg = nullptr) {
+        return addJob(schedule, JobOptions{}, mode, std::forward<F>(fn), userData, taskCfg);
+    }
+
+    template <typename F, typename = scheduler_callable_detail::EnableNoData<F>>
+    uint32_t addJob(const Schedule& schedule,
+                    const JobOptions& options,
+                    SchedulerJobMode mode,
+                    F&& fn,
+                    const SchedulerTaskConfig* taskCfg = nullptr) {
+        return addBound(schedule,
+                        options,
+                        mode,
+                        NoDataCall<typename std::decay<F>::type>{std::forward<F>(fn)},
+                        taskCfg);
+    }
+
+    template <typename F, typename = scheduler_callable_detail::EnableWithData<F>>
+    uint32_t addJob(const Schedule& schedule,
+                    const JobOptions& options,
+                    SchedulerJobMode mode,
+                    F&& fn,
+                    void* userData = nullptr,
+                    const SchedulerTaskConfig* taskCfg = nullptr) {
+        return addBound(schedule,
+                        options,
+                        mode,
+                        DataCall<typename std::decay<F>::type>{std::forward<F>(fn), userData},
+                        taskCfg);
+    }
+
+    template <typename F, typename = scheduler_callable_detail::EnableNoData<F>>
+    uint32_t addJobOnceUtc(const DateTime& whenUtc,
+                           SchedulerJobMode mode,
+                           F&& fn,
+                           const SchedulerTaskConfig* taskCfg = nullptr) {
+        return addJob(Schedule::onceUtc(whenUtc), mode, std::forward<F>(fn), taskCfg);
+    }
+
+    template <typename F, typename = scheduler_callable_detail::EnableWithData<F>>
+    uint32_t addJobOnceUtc(const DateTime& whenUtc,
+                           SchedulerJobMode mode,
+                           F&& fn,
+                           void* userData = nullptr,
+                           const SchedulerTaskConfig* taskCfg = nullptr) {
+        return addJob(Schedule::onceUtc(whenUtc), mode, std::forward<F>(fn), userData, taskCfg);
+    }
+
+private:
+    template <typename F>
+    struct NoDataCall {
+        F fn;
+        void operator()() { fn(); }
+    };
+
+    template <typename F>
+    struct DataCall {
+        F fn;
+        void* userData;
+        void operator()() { fn(userData); }
+    };
+
+    struct alignas(alignof(std::max_align_t)) CallableSlot {
+        unsigned char bytes[CallableBytes];
+    };
+
+    template <typename Bound>
+    static void invokeSlot(void* slot) {
+        (*static_cast<Bound*>(slot))();
+    }
+
+    template <typename Bound>
+    uint32_t addBound(const Schedule& schedule,
+                      const JobOptions& options,
+                      SchedulerJobMode mode,
+                      Bound&& bound,
+                      const SchedulerTaskConfig* taskCfg) {
+        static_assert(sizeof(Bound) <= CallableBytes, "callable captures exceed CallableBytes");
+        static_assert(alignof(Bound) <= alignof(CallableSlot), "callable is over-aligned");
+        static_assert(std::is_trivially_destructible<Bound>::value,
+                      "callable captures must be trivially destructible");
+        if (mode != SchedulerJobMode::Inline) {
+            return 0;
+        }
+        const size_t slot = nextInlineSlot();
+        if (slot >= MaxJobs) {
+            return 0;
+        }
+        // A slot is only handed out again after its previous job is gone, so the
+        // old callable is never invoked once it has been overwritten.
+        void* storage = m_callables[slot].bytes;
+        ::new (storage) Bound(std::move(bound));
+        return ESPScheduler::addJob(schedule, options, mode, &invokeSlot<Bound>, storage, taskCfg);
+    }
+
+    CallableSlot m_callables[MaxJobs];
+};
@@ -0,0 +1,203 @@
+// Host benchmark for ESPScheduler hot paths. Prints one JSON object per line:
+//   {"bench":"tick_idle","jobs":1000,"iterations":20000,"ns_per_op":41.7}
+// Pass --quick for a fast smoke run (used by CTest); the default sizes are
+// meant for comparing builds, e.g. `bench_esp_scheduler > bench_output.txt`.
+#include <Arduino.h>
+#include <ESPDate.h>
+#include <ESPScheduler.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+ESPDate date;
+volatile uint32_t sink = 0;
+
+void countingCallback(void* userData) {
+    (void)userData;
+    sink = sink + 1;
+}
+
+struct Stopwatch {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    double elapsedNs() const {
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    }
+};
+
+void report(const char* bench, size_t jobs, size_t iterations, double totalNs) {
+    const double perOp = iterations ? totalNs / static_cast<double>(iterations) : 0.0;
+    std::printf("{\"bench\":\"%s\",\"jobs\":%zu,\"iterations\":%zu,\"ns_per_op\":%.1f}\n",
+                bench,
+                jobs,
+                iterations,
+                perOp);
+    std::fflush(stdout);
+}
+
+Schedule everyMinute() {
+    return Schedule::custom(ScheduleField::every(1),
+                            ScheduleField::any(),
+                            ScheduleField::any(),
+                            ScheduleField::any(),
+                            ScheduleField::any());
+}
+
+// 09:00 on March 1st: the worst case for a minute-granular search.
+Schedule sparseYearly() {
+    return Schedule::custom(ScheduleField::only(0),
+                            ScheduleField::only(9),
+                            ScheduleField::only(1),
+                            ScheduleField::only(3),
+                            ScheduleField::any());
+}
+
+// Daily slots spread over the day so deadlines differ between jobs.
+Schedule spreadDaily(size_t i) {
+    return Schedule::dailyAtLocal(static_cast<int>(i % 24), static_cast<int>((i * 7) % 60));
+}
+
+const DateTime kBase = date.fromUtc(2025, 1, 1, 0, 0, 30);
+
+void benchAddJob(size_t jobs) {
+    ESPScheduler scheduler(date);
+    Stopwatch sw;
+    for (size_t i = 0; i < jobs; ++i) {
+        scheduler.addJob(spreadDaily(i), SchedulerJobMode::Inline, &countingCallback, nullptr);
+    }
+    report("add_job", jobs, jobs, sw.elapsedNs());
+}
+
+void benchTick(size_t jobs, size_t idleIterations) {
+    ESPScheduler scheduler(date);
+    for (size_t i = 0; i < jobs; ++i) {
+        scheduler.addJob(spreadDaily(i), SchedulerJobMode::Inline, &countingCallback, nullptr);
+    }
+
+    {
+        Stopwatch sw;
+        scheduler.tick(kBase);  // resolves every job's first deadline
+        report("tick_first_resolve", jobs, 1, sw.elapsedNs());
+    }
+    {
+        Stopwatch sw;
+        for (size_t i = 0; i < idleIterations; ++i) {
+            scheduler.tick(kBase);
+        }
+        report("tick_idle", jobs, idleIterations, sw.elapsedNs());
+    }
+
+    ESPScheduler busy(date);
+    for (size_t i = 0; i < jobs; ++i) {
+        busy.addJob(everyMinute(), SchedulerJobMode::Inline, &countingCallback, nullptr);
+    }
+    DateTime now = kBase;
+    busy.tick(now);
+    const size_t minutes = 5;
+    Stopwatch sw;
+    for (size_t i = 0; i < minutes; ++i) {
+        now = date.addMinutes(now, 1);
+        busy.tick(now);
+    }
+    report("tick_all_due_per_job", jobs, minutes * jobs, sw.elapsedNs());
+}
+
+void benchCancel(size_t jobs) {
+    ESPScheduler scheduler(date);
+    std::vector<uint32_t> ids;
+    ids.reserve(jobs);
+    for (size_t i = 0; i < jobs; ++i) {
+        ids.push_back(scheduler.addJob(spreadDaily(i), SchedulerJobMode::Inline, &countingCallback, nullptr));
+    }
+    scheduler.tick(kBase);
+    // Cancel from the middle outwards so neither end of the table is favoured.
+    Stopwatch sw;
+    for (size_t i = 0; i < jobs; ++i) {
+        const size_t index = (i % 2 == 0) ? (jobs / 2 + i / 2) : (jobs / 2 - 1 - i / 2);
+        scheduler.cancelJob(ids[index % jobs]);
+    }
+    report("cancel_job", jobs, jobs, sw.elapsedNs());
+}
+
+void benchJobInfo(size_t jobs) {
+    ESPScheduler scheduler(date);
+    for (size_t i = 0; i < jobs; ++i) {
+        scheduler.addJob(spreadDaily(i), SchedulerJobMode::Inline, &countingCallback, nullptr);
+    }
+    scheduler.tick(kBase);
+    JobInfo info{};
+    Stopwatch sw;
+    size_t index = 0;
+    while (scheduler.getJobInfo(index, info)) {
+        ++index;
+    }
+    report("get_job_info_enumerate_per_job", jobs, index, sw.elapsedNs());
+
+    Stopwatch walk;
+    int64_t latest = 0;
+    const size_t visited = scheduler.forEachJob([&latest](const JobSummary& job) {
+        latest = std::max(latest, job.nextRunUtc.epochSeconds);
+    });
+    report("for_each_job_per_job", jobs, visited, walk.elapsedNs());
+}
+
+void benchCompute(const char* name, const Schedule& schedule, size_t iterations) {
+    ESPScheduler scheduler(date);
+    DateTime from = kBase;
+    DateTime next{};
+    Stopwatch sw;
+    for (size_t i = 0; i < iterations; ++i) {
+        scheduler.computeNextOccurrence(schedule, from, next);
+        from = date.addMinutes(from, 37);
+    }
+    report(name, 0, iterations, sw.elapsedNs());
+}
+
+void benchIterate(const char* name, const Schedule& schedule, size_t iterations) {
+    ScheduleIterator it(schedule, kBase);
+    DateTime next{};
+    Stopwatch sw;
+    size_t steps = 0;
+    while (steps < iterations && it.next(next)) {
+        ++steps;
+    }
+    report(name, 0, steps, sw.elapsedNs());
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    bool quick = false;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--quick") == 0) {
+            quick = true;
+        }
+    }
+    if (!std::getenv("TZ")) {
+        setenv("TZ", "UTC", 1);
+    }
+    tzset();
+
+    const std::vector<size_t> sizes = quick ? std::vector<size_t>{10, 100}
+                                            : std::vector<size_t>{10, 100, 1000, 10000};
+    const size_t idleIterations = quick ? 1000 : 100000;
+    const size_t computeIterations = quick ? 200 : 20000;
+
+    for (size_t jobs : sizes) {
+        benchAddJob(jobs);
+        benchTick(jobs, idleIterations);
+        benchCancel(jobs);
+        benchJobInfo(jobs);
+    }
+    benchCompute("compute_next_dense", everyMinute(), computeIterations);
+    benchCompute("compute_next_daily", Schedule::dailyAtLocal(9, 30), computeIterations);
+    benchCompute("compute_next_sparse", sparseYearly(), computeIterations);
+    benchIterate("iterate_dense", everyMinute(), computeIterations);
+    benchIterate("iterate_daily", Schedule::dailyAtLocal(9, 30), computeIterations);
+    return 0;
+}
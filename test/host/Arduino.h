@@ -0,0 +1,15 @@
+#pragma once
+// Host stand-in for the Arduino core: only what ESPScheduler and its tests touch.
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <chrono>
+#include <thread>
+
+inline void delay(uint32_t ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+inline unsigned long millis() {
+    using namespace std::chrono;
+    static const auto start = steady_clock::now();
+    return static_cast<unsigned long>(duration_cast<milliseconds>(steady_clock::now() - start).count());
+}
@@ -0,0 +1,84 @@
+#pragma once
+// Host stand-in for ESPDate backed by libc time/TZ functions.
+#include <cstdint>
+#include <ctime>
+
+struct DateTime {
+    int64_t epochSeconds = 0;
+    int yearUtc() const { return utc().tm_year + 1900; }
+    int monthUtc() const { return utc().tm_mon + 1; }
+    int dayUtc() const { return utc().tm_mday; }
+    int hourUtc() const { return utc().tm_hour; }
+    int minuteUtc() const { return utc().tm_min; }
+    int secondUtc() const { return utc().tm_sec; }
+
+private:
+    std::tm utc() const {
+        std::tm tm{};
+        const time_t t = static_cast<time_t>(epochSeconds);
+        gmtime_r(&t, &tm);
+        return tm;
+    }
+};
+
+class ESPDate {
+public:
+    DateTime now() const { return make(static_cast<int64_t>(std::time(nullptr))); }
+    DateTime fromUnixSeconds(int64_t seconds) const { return make(seconds); }
+    DateTime fromUtc(int year, int month, int day, int hour = 0, int minute = 0, int second = 0) const {
+        std::tm tm{};
+        tm.tm_year = year - 1900;
+        tm.tm_mon = month - 1;
+        tm.tm_mday = day;
+        tm.tm_hour = hour;
+        tm.tm_min = minute;
+        tm.tm_sec = second;
+        return make(static_cast<int64_t>(timegm(&tm)));
+    }
+    DateTime addSeconds(const DateTime& dt, int64_t s) const { return make(dt.epochSeconds + s); }
+    DateTime addMinutes(const DateTime& dt, int64_t m) const { return make(dt.epochSeconds + m * 60); }
+    DateTime addHours(const DateTime& dt, int64_t h) const { return make(dt.epochSeconds + h * 3600); }
+    DateTime addDays(const DateTime& dt, int64_t d) const { return make(dt.epochSeconds + d * 86400); }
+    int64_t differenceInSeconds(const DateTime& a, const DateTime& b) const { return a.epochSeconds - b.epochSeconds; }
+    int64_t differenceInMinutes(const DateTime& a, const DateTime& b) const {
+        return (a.epochSeconds - b.epochSeconds) / 60;
+    }
+    bool isAfter(const DateTime& a, const DateTime& b) const { return a.epochSeconds > b.epochSeconds; }
+    bool isBefore(const DateTime& a, const DateTime& b) const { return a.epochSeconds < b.epochSeconds; }
+    bool isEqual(const DateTime& a, const DateTime& b) const { return a.epochSeconds == b.epochSeconds; }
+
+    int getYearLocal(const DateTime& dt) const { return local(dt).tm_year + 1900; }
+    int getMonthLocal(const DateTime& dt) const { return local(dt).tm_mon + 1; }
+    int getDayLocal(const DateTime& dt) const { return local(dt).tm_mday; }
+    int getWeekdayLocal(const DateTime& dt) const { return local(dt).tm_wday; }
+    int getHourLocal(const DateTime& dt) const { return local(dt).tm_hour; }
+    int getMinuteLocal(const DateTime& dt) const { return local(dt).tm_min; }
+
+    DateTime startOfDayLocal(const DateTime& dt) const { return setTimeOfDayLocal(dt, 0, 0, 0); }
+    DateTime setTimeOfDayLocal(const DateTime& dt, int hour, int minute, int second) const {
+        std::tm tm = local(dt);
+        tm.tm_hour = hour;
+        tm.tm_min = minute;
+        tm.tm_sec = second;
+        tm.tm_isdst = -1;
+        return make(static_cast<int64_t>(mktime(&tm)));
+    }
+    DateTime setTimeOfDayUtc(const DateTime& dt, int hour, int minute, int second) const {
+        const int64_t day = floorDiv(dt.epochSeconds, 86400);
+        return make(day * 86400 + hour * 3600 + minute * 60 + second);
+    }
+
+private:
+    static int64_t floorDiv(int64_t a, int64_t b) { return (a >= 0) ? a / b : -((-a + b - 1) / b); }
+    static DateTime make(int64_t seconds) {
+        DateTime dt{};
+        dt.epochSeconds = seconds;
+        return dt;
+    }
+    static std::tm local(const DateTime& dt) {
+        std::tm tm{};
+        const time_t t = static_cast<time_t>(dt.epochSeconds);
+        localtime_r(&t, &tm);
+        return tm;
+    }
+};
@@ -0,0 +1,59 @@
+#include "alloc_counter.h"
+
+#include <cstdlib>
+
+namespace {
+// Plain thread_locals of the executable live in static TLS, so reading them
+// from inside malloc never allocates.
+thread_local bool t_counting = false;
+thread_local size_t t_count = 0;
+}  // namespace
+
+namespace alloc_counter {
+bool supported() {
+#if defined(__GLIBC__)
+    return true;
+#else
+    return false;
+#endif
+}
+
+void start() {
+    t_count = 0;
+    t_counting = true;
+}
+
+size_t stop() {
+    t_counting = false;
+    return t_count;
+}
+}  // namespace alloc_counter
+
+#if defined(__GLIBC__)
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+
+void* malloc(size_t size) {
+    if (t_counting) {
+        ++t_count;
+    }
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) {
+    if (t_counting) {
+        ++t_count;
+    }
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* ptr, size_t size) {
+    if (t_counting) {
+        ++t_count;
+    }
+    return __libc_realloc(ptr, size);
+}
+}
+#endif
@@ -0,0 +1,12 @@
+#pragma once
+// Host-only: counts heap allocations (malloc, calloc, realloc, and operator new
+// through them) made by the calling thread between start() and stop(). Counting
+// needs glibc, where the test binary can interpose malloc; elsewhere supported()
+// is false and stop() always returns 0.
+#include <cstddef>
+
+namespace alloc_counter {
+bool supported();
+void start();
+size_t stop();
+}  // namespace alloc_counter
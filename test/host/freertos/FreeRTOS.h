@@ -0,0 +1,24 @@
+#pragma once
+// Host stand-in for the FreeRTOS kernel types used by ESPScheduler.
+
+// The scheduler includes FreeRTOS headers inside extern "C"; these shims are C++.
+extern "C++" {
+#include <cstdint>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdPASS 1
+#define pdFAIL 0
+#define configTICK_RATE_HZ 1000
+#define portTICK_PERIOD_MS (1000 / configTICK_RATE_HZ)
+#define portMAX_DELAY 0xffffffffUL
+#define tskNO_AFFINITY 0x7FFFFFFF
+#define portNUM_PROCESSORS 2  // dual-core, like the ESP32
+#define pdMS_TO_TICKS(ms) (static_cast<TickType_t>(((uint64_t)(ms) * configTICK_RATE_HZ) / 1000U))
+#define portYIELD_FROM_ISR(x) ((void)(x))
+
+}  // extern "C++"
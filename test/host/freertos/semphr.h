@@ -0,0 +1,33 @@
+#pragma once
+// Host stand-in for FreeRTOS mutexes backed by std::timed_mutex.
+
+// The scheduler includes FreeRTOS headers inside extern "C"; these shims are C++.
+extern "C++" {
+#include <chrono>
+#include <mutex>
+
+#include "freertos/FreeRTOS.h"
+
+typedef std::timed_mutex* SemaphoreHandle_t;
+
+inline SemaphoreHandle_t xSemaphoreCreateMutex() { return new std::timed_mutex(); }
+inline void vSemaphoreDelete(SemaphoreHandle_t sem) { delete sem; }
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticksToWait) {
+    if (!sem) {
+        return pdFALSE;
+    }
+    if (ticksToWait == portMAX_DELAY) {
+        sem->lock();
+        return pdTRUE;
+    }
+    return sem->try_lock_for(std::chrono::milliseconds(ticksToWait * portTICK_PERIOD_MS)) ? pdTRUE : pdFALSE;
+}
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) {
+    if (!sem) {
+        return pdFALSE;
+    }
+    sem->unlock();
+    return pdTRUE;
+}
+
+}  // extern "C++"
@@ -0,0 +1,183 @@
+#pragma once
+// Host stand-in for FreeRTOS tasks: every task is a detached std::thread with a
+// notification slot. Handles stay alive for the process lifetime so late
+// notifications never touch freed memory.
+
+// The scheduler includes FreeRTOS headers inside extern "C"; these shims are C++.
+extern "C++" {
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+#include "freertos/FreeRTOS.h"
+
+typedef void (*TaskFunction_t)(void*);
+
+struct HostTask {
+    std::mutex mutex;
+    std::condition_variable cv;
+    uint32_t notifyValue = 0;
+    bool notifyPending = false;
+    bool deleted = false;
+};
+typedef HostTask* TaskHandle_t;
+
+typedef enum { eNoAction = 0, eSetBits, eIncrement, eSetValueWithOverwrite, eSetValueWithoutOverwrite } eNotifyAction;
+
+namespace freertos_host {
+// Thrown inside a task blocked on a notification after another task deleted it.
+struct TaskDeleted {};
+
+inline TaskHandle_t& currentTask() {
+    static thread_local TaskHandle_t task = nullptr;
+    return task;
+}
+inline TaskHandle_t self() {
+    TaskHandle_t& task = currentTask();
+    if (!task) {
+        task = new HostTask();
+    }
+    return task;
+}
+}  // namespace freertos_host
+
+inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn,
+                                          const char* /*name*/,
+                                          uint32_t /*stackDepth*/,
+                                          void* arg,
+                                          UBaseType_t /*priority*/,
+                                          TaskHandle_t* outHandle,
+                                          BaseType_t /*coreId*/) {
+    TaskHandle_t task = new HostTask();
+    if (outHandle) {
+        *outHandle = task;
+    }
+    std::thread([task, fn, arg]() {
+        freertos_host::currentTask() = task;
+        try {
+            fn(arg);
+        } catch (const freertos_host::TaskDeleted&) {
+        }
+    }).detach();
+    return pdPASS;
+}
+
+inline BaseType_t xTaskCreate(TaskFunction_t fn,
+                              const char* name,
+                              uint32_t stackDepth,
+                              void* arg,
+                              UBaseType_t priority,
+                              TaskHandle_t* outHandle) {
+    return xTaskCreatePinnedToCore(fn, name, stackDepth, arg, priority, outHandle, tskNO_AFFINITY);
+}
+
+// Threads cannot be killed from outside: a self-delete simply lets the thread
+// return, and deleting another task unwinds it at its next notification wait.
+inline void vTaskDelete(TaskHandle_t task) {
+    if (!task || task == freertos_host::currentTask()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(task->mutex);
+        task->deleted = true;
+    }
+    task->cv.notify_all();
+}
+
+inline void vTaskDelay(TickType_t ticks) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ticks * portTICK_PERIOD_MS));
+}
+
+inline TaskHandle_t xTaskGetCurrentTaskHandle() { return freertos_host::self(); }
+
+inline TickType_t xTaskGetTickCount() {
+    using namespace std::chrono;
+    static const auto start = steady_clock::now();
+    return static_cast<TickType_t>(duration_cast<milliseconds>(steady_clock::now() - start).count() /
+                                   portTICK_PERIOD_MS);
+}
+
+inline BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action) {
+    if (!task) {
+        return pdFAIL;
+    }
+    {
+        std::lock_guard<std::mutex> lock(task->mutex);
+        switch (action) {
+            case eSetBits: task->notifyValue |= value; break;
+            case eIncrement: ++task->notifyValue; break;
+            case eSetValueWithOverwrite:
+            case eSetValueWithoutOverwrite: task->notifyValue = value; break;
+            case eNoAction: break;
+        }
+        task->notifyPending = true;
+    }
+    task->cv.notify_all();
+    return pdPASS;
+}
+
+inline BaseType_t xTaskNotifyGive(TaskHandle_t task) { return xTaskNotify(task, 0, eIncrement); }
+
+inline BaseType_t xTaskNotifyFromISR(TaskHandle_t task,
+                                     uint32_t value,
+                                     eNotifyAction action,
+                                     BaseType_t* higherPriorityTaskWoken) {
+    if (higherPriorityTaskWoken) {
+        *higherPriorityTaskWoken = pdTRUE;
+    }
+    return xTaskNotify(task, value, action);
+}
+
+inline void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* higherPriorityTaskWoken) {
+    xTaskNotifyFromISR(task, 0, eIncrement, higherPriorityTaskWoken);
+}
+
+inline uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticksToWait) {
+    TaskHandle_t task = freertos_host::self();
+    std::unique_lock<std::mutex> lock(task->mutex);
+    auto ready = [task]() { return task->notifyValue != 0 || task->deleted; };
+    if (ticksToWait == portMAX_DELAY) {
+        task->cv.wait(lock, ready);
+    } else {
+        task->cv.wait_for(lock, std::chrono::milliseconds(ticksToWait * portTICK_PERIOD_MS), ready);
+    }
+    if (task->deleted) {
+        throw freertos_host::TaskDeleted{};
+    }
+    const uint32_t value = task->notifyValue;
+    if (value != 0) {
+        task->notifyValue = clearOnExit ? 0 : value - 1;
+    }
+    task->notifyPending = false;
+    return value;
+}
+
+inline BaseType_t xTaskNotifyWait(uint32_t clearOnEntry, uint32_t clearOnExit, uint32_t* outValue, TickType_t ticksToWait) {
+    TaskHandle_t task = freertos_host::self();
+    std::unique_lock<std::mutex> lock(task->mutex);
+    if (!task->notifyPending) {
+        task->notifyValue &= ~clearOnEntry;
+    }
+    auto ready = [task]() { return task->notifyPending || task->deleted; };
+    if (ticksToWait == portMAX_DELAY) {
+        task->cv.wait(lock, ready);
+    } else {
+        task->cv.wait_for(lock, std::chrono::milliseconds(ticksToWait * portTICK_PERIOD_MS), ready);
+    }
+    if (task->deleted) {
+        throw freertos_host::TaskDeleted{};
+    }
+    if (outValue) {
+        *outValue = task->notifyValue;
+    }
+    if (!task->notifyPending) {
+        return pdFALSE;
+    }
+    task->notifyPending = false;
+    task->notifyValue &= ~clearOnExit;
+    return pdTRUE;
+}
+
+}  // extern "C++"
@@ -0,0 +1,54 @@
+#pragma once
+// Minimal host stand-in for Unity: enough to run the device test sketches under CTest.
+#include <cstdio>
+#include <cstdlib>
+
+namespace unity_host {
+inline int& failures() { static int f = 0; return f; }
+inline int& tests() { static int t = 0; return t; }
+struct Failure {};
+inline void fail(const char* file, int line, const char* msg) {
+    std::printf("%s:%d: FAIL: %s\n", file, line, msg);
+    throw Failure{};
+}
+}  // namespace unity_host
+
+void setUp();
+void tearDown();
+
+#define UNITY_BEGIN() (unity_host::failures() = 0, unity_host::tests() = 0)
+#define UNITY_END()                                                                       \
+    (std::printf("%d Tests %d Failures\n", unity_host::tests(), unity_host::failures()), \
+     unity_host::failures())
+#define RUN_TEST(fn)                                    \
+    do {                                                \
+        ++unity_host::tests();                          \
+        try {                                           \
+            setUp();                                    \
+            fn();                                       \
+            tearDown();                                 \
+            std::printf("%s: PASS\n", #fn);             \
+        } catch (const unity_host::Failure&) {          \
+            ++unity_host::failures();                   \
+            tearDown();                                 \
+        }                                               \
+    } while (0)
+
+#define UNITY_HOST_CHECK(cond, msg) \
+    do {                            \
+        if (!(cond)) unity_host::fail(__FILE__, __LINE__, msg); \
+    } while (0)
+#define TEST_ASSERT_TRUE(c) UNITY_HOST_CHECK((c), #c)
+#define TEST_ASSERT_FALSE(c) UNITY_HOST_CHECK(!(c), "!(" #c ")")
+#define TEST_ASSERT(c) UNITY_HOST_CHECK((c), #c)
+#define TEST_ASSERT_EQUAL(e, a) UNITY_HOST_CHECK((e) == (a), #e " == " #a)
+#define TEST_ASSERT_EQUAL_INT(e, a) UNITY_HOST_CHECK((e) == (a), #e " == " #a)
+#define TEST_ASSERT_EQUAL_UINT32(e, a) UNITY_HOST_CHECK((e) == (a), #e " == " #a)
+#define TEST_ASSERT_EQUAL_INT64(e, a) UNITY_HOST_CHECK((e) == (a), #e " == " #a)
+#define TEST_ASSERT_NOT_EQUAL(e, a) UNITY_HOST_CHECK((e) != (a), #e " != " #a)
+#define TEST_ASSERT_GREATER_THAN(t, a) UNITY_HOST_CHECK((a) > (t), #a " > " #t)
+#define TEST_ASSERT_GREATER_OR_EQUAL(t, a) UNITY_HOST_CHECK((a) >= (t), #a " >= " #t)
+#define TEST_ASSERT_LESS_THAN(t, a) UNITY_HOST_CHECK((a) < (t), #a " < " #t)
+#define TEST_ASSERT_LESS_OR_EQUAL(t, a) UNITY_HOST_CHECK((a) <= (t), #a " <= " #t)
+#define TEST_ASSERT_NULL(p) UNITY_HOST_CHECK((p) == nullptr, #p " == NULL")
+#define TEST_ASSERT_NOT_NULL(p) UNITY_HOST_CHECK((p) != nullptr, #p " != NULL")
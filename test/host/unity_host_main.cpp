@@ -0,0 +1,9 @@
+// Entry point for running an Arduino-style Unity sketch (setup()/loop()) on the host.
+#include <unity.h>
+
+void setup();
+
+int main() {
+    setup();
+    return unity_host::failures() == 0 ? 0 : 1;
+}
@@ -1,12 +1,27 @@
 #include <Arduino.h>
 #include <ESPDate.h>
 #include <ESPScheduler.h>
+#include <esp_timer.h>
 #include <unity.h>
 
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#if __has_include(<alloc_counter.h>)
+#include <alloc_counter.h>
+#define ESP_SCHEDULER_TEST_COUNTS_ALLOCATIONS 1
+#endif
+
 ESPDate date;
 ESPScheduler scheduler(date);
 
 static int inlineHits = 0;
+static std::atomic<int> workerHits{0};
 
 static void inlineCallback(void* userData) {
     (void)userData;
@@ -57,6 +72,175 @@ static void test_dom_dow_or_logic_matches_either() {
     TEST_ASSERT_TRUE(date.isEqual(next, date.fromUtc(2024, 7, 1, 9, 0, 0)));  // passes via DOW even though DOM mismatch
 }
 
+static void test_sparse_schedule_skips_to_matching_month() {
+    // 09:00 on March 1st only: the solver must jump months instead of scanning minutes.
+    Schedule s = Schedule::custom(ScheduleField::only(0),
+                                  ScheduleField::only(9),
+                                  ScheduleField::only(1),
+                                  ScheduleField::only(3),
+                                  ScheduleField::any());
+    DateTime from = date.fromUtc(2025, 3, 1, 9, 0, 30);
+    DateTime next{};
+    TEST_ASSERT_TRUE(scheduler.computeNextOccurrence(s, from, next));
+    TEST_ASSERT_TRUE(date.isEqual(next, date.fromUtc(2026, 3, 1, 9, 0, 0)));
+}
+
+static void test_leap_day_schedule_finds_next_leap_year() {
+    Schedule s = Schedule::monthlyOnDayLocal(29, 12, 0);
+    s.month = ScheduleField::only(2);
+    DateTime from = date.fromUtc(2025, 3, 1, 0, 0, 0);
+    DateTime next{};
+    TEST_ASSERT_TRUE(scheduler.computeNextOccurrence(s, from, next));
+    TEST_ASSERT_TRUE(date.isEqual(next, date.fromUtc(2028, 2, 29, 12, 0, 0)));
+}
+
+static void test_dst_gap_runs_after_transition() {
+    setenv("TZ", "EST5EDT,M3.2.0,M11.1.0", 1);
+    tzset();
+    // 2025-03-09 02:30 local does not exist; it resolves to 03:30 EDT (07:30 UTC).
+    Schedule s = Schedule::dailyAtLocal(2, 30);
+    DateTime from = date.fromUtc(2025, 3, 9, 6, 0, 0);  // 01:00 EST
+    DateTime next{};
+    const bool found = scheduler.computeNextOccurrence(s, from, next);
+    setenv("TZ", "UTC", 1);
+    tzset();
+    TEST_ASSERT_TRUE(found);
+    TEST_ASSERT_TRUE(date.isEqual(next, date.fromUtc(2025, 3, 9, 7, 30, 0)));
+}
+
+static void test_schedule_iterator_matches_repeated_compute() {
+    const int minutes[] = {0, 30};
+    Schedule s = Schedule::custom(ScheduleField::list(minutes, 2),
+                                  ScheduleField::range(8, 10),
+                                  ScheduleField::any(),
+                                  ScheduleField::any(),
+                                  ScheduleField::range(1, 5));
+    DateTime from = date.fromUtc(2025, 1, 1, 9, 10, 0);
+    ScheduleIterator it(s, from);
+    DateTime expected{};
+    TEST_ASSERT_TRUE(scheduler.computeNextOccurrence(s, from, expected));
+    for (int i = 0; i < 50; ++i) {
+        DateTime got{};
+        TEST_ASSERT_TRUE(it.next(got));
+        TEST_ASSERT_TRUE(date.isEqual(got, expected));
+        TEST_ASSERT_TRUE(scheduler.computeNextOccurrence(s, date.addMinutes(got, 1), expected));
+    }
+}
+
+static void test_compute_next_occurrences_fills_batch() {
+    DateTime out[3]{};
+    const size_t count =
+        scheduler.computeNextOccurrences(Schedule::dailyAtLocal(6, 0), date.fromUtc(2025, 1, 30, 7, 0, 0), out, 3);
+    TEST_ASSERT_EQUAL(3, static_cast<int>(count));
+    TEST_ASSERT_TRUE(date.isEqual(out[0], date.fromUtc(2025, 1, 31, 6, 0, 0)));
+    TEST_ASSERT_TRUE(date.isEqual(out[1], date.fromUtc(2025, 2, 1, 6, 0, 0)));
+    TEST_ASSERT_TRUE(date.isEqual(out[2], date.fromUtc(2025, 2, 2, 6, 0, 0)));
+
+    Schedule once = Schedule::onceUtc(date.fromUtc(2025, 3, 1, 12, 0, 0));
+    TEST_ASSERT_EQUAL(1, static_cast<int>(scheduler.computeNextOccurrences(once, date.fromUtc(2025, 1, 1, 0, 0, 0), out, 3)));
+}
+
+static void test_cron_expression_is_parsed_at_compile_time() {
+    constexpr CronExpression workHours = CronExpression::compile("*/15 9-17 * * MON-FRI");
+    static_assert(workHours.valid(), "valid expression");
+    static_assert(workHours.fieldMask(0) == ((1ULL << 0) | (1ULL << 15) | (1ULL << 30) | (1ULL << 45)), "minute step");
+    static_assert(workHours.fieldMask(1) == 0x3FE00ULL, "hour range 9-17");
+    static_assert(workHours.fieldIsAny(2) && workHours.fieldIsAny(3), "wildcards stay wildcards");
+    static_assert(workHours.fieldMask(4) == 0x3EULL, "MON-FRI");
+    constexpr CronExpression names = CronExpression::compile("0 6,18 1 jan,Jul sun,7");
+    static_assert(names.fieldMask(3) == ((1ULL << 1) | (1ULL << 7)), "month names");
+    static_assert(names.fieldMask(4) == 1ULL, "7 and SUN are both Sunday");
+    static_assert(CronExpression::compile("5/20 * * * *").fieldMask(0) == ((1ULL << 5) | (1ULL << 25) | (1ULL << 45)),
+                  "stepped start");
+    static_assert(CronExpression::compile("@daily").fieldMask(1) == 1ULL, "macros");
+    static_assert(!CronExpression::parse("60 * * * *").valid(), "minute out of range");
+
+    const Schedule s = ESP_SCHEDULER_CRON("*/15 9-17 * * MON-FRI");
+    // A parsed schedule gets no pass on validation once its fields are edited.
+    Schedule edited = s;
+    edited.hour = ScheduleField::fromMask(1ULL << 30);
+    TEST_ASSERT_EQUAL_UINT32(0, scheduler.addJob(edited, SchedulerJobMode::Inline, &inlineCallback, nullptr));
+    edited.hour = ScheduleField::fromMask((1ULL << 9) | (1ULL << 30));  // one bit in range is not enough
+    TEST_ASSERT_EQUAL_UINT32(0, scheduler.addJob(edited, SchedulerJobMode::Inline, &inlineCallback, nullptr));
+    edited.hour = ScheduleField::rangeEvery(0, 30, 6);
+    TEST_ASSERT_EQUAL_UINT32(0, scheduler.addJob(edited, SchedulerJobMode::Inline, &inlineCallback, nullptr));
+    // every() fits any field; its values past the field's range are simply never reached.
+    edited.hour = ScheduleField::every(6);
+    TEST_ASSERT_EQUAL_INT64(ScheduleField::rangeEvery(0, 63, 6).rawMask(), edited.hour.rawMask());
+    const uint32_t everySixHours = scheduler.addJob(edited, SchedulerJobMode::Inline, &inlineCallback, nullptr);
+    TEST_ASSERT_NOT_EQUAL(0u, everySixHours);
+    TEST_ASSERT_TRUE(scheduler.cancelJob(everySixHours));
+    DateTime next{};
+    TEST_ASSERT_TRUE(scheduler.computeNextOccurrence(s, date.fromUtc(2025, 3, 7, 17, 50, 0), next));  // Friday
+    TEST_ASSERT_TRUE(date.isEqual(next, date.fromUtc(2025, 3, 10, 9, 0, 0)));  // Monday 09:00
+}
+
+static void test_cron_runtime_parse_reports_errors_and_rejects_bad_jobs() {
+    const char payload[] = {'5', '/', '2', '0', ' ', '3', ' ', 'L', ' ', '*', ' ', '*'};  // no NUL, as received
+    const CronExpression bad = CronExpression::parse(payload, sizeof(payload));
+    TEST_ASSERT_FALSE(bad.valid());
+    TEST_ASSERT_EQUAL(7, static_cast<int>(bad.errorOffset()));
+    TEST_ASSERT_FALSE(CronExpression::parse("* * * *").valid());
+    TEST_ASSERT_FALSE(CronExpression::parse("0 0 * * FRI-MON").valid());
+    TEST_ASSERT_FALSE(CronExpression::parse("@sometimes").valid());
+
+    const Schedule s = Schedule::cron("5/20 3 1-7 * ?");
+    TEST_ASSERT_TRUE(s.minute.rawMask() == ((1ULL << 5) | (1ULL << 25) | (1ULL << 45)));
+    TEST_ASSERT_TRUE(s.dayOfMonth.rawMask() == 0xFEULL);
+    TEST_ASSERT_TRUE(s.dayOfWeek.isAny());
+
+    ESPScheduler local(date);
+    TEST_ASSERT_EQUAL_UINT32(0, local.addJob(Schedule::cron("61 * * * *"), SchedulerJobMode::Inline, inlineCallback));
+    TEST_ASSERT_NOT_EQUAL(0, local.addJob(s, SchedulerJobMode::Inline, inlineCallback));
+    local.deinit();
+}
+
+static void test_tick_reschedules_hourly_job_across_dst_fall_back() {
+    setenv("TZ", "EST5EDT,M3.2.0,M11.1.0", 1);
+    tzset();
+    ESPScheduler localScheduler(date);
+    inlineHits = 0;
+    Schedule s = Schedule::custom(ScheduleField::only(30),
+                                  ScheduleField::any(),
+                                  ScheduleField::any(),
+                                  ScheduleField::any(),
+                                  ScheduleField::any());
+    localScheduler.addJob(s, SchedulerJobMode::Inline, &inlineCallback, nullptr);
+
+    // 2025-11-02 00:00 EDT .. 05:00 EST; the repeated 01:30 wall-clock slot fires once.
+    for (DateTime now = date.fromUtc(2025, 11, 2, 4, 0, 0); !date.isAfter(now, date.fromUtc(2025, 11, 2, 10, 0, 0));
+         now = date.addMinutes(now, 30)) {
+        localScheduler.tick(now);
+    }
+    JobInfo info{};
+    const bool hasInfo = localScheduler.getJobInfo(0, info);
+    setenv("TZ", "UTC", 1);
+    tzset();
+    TEST_ASSERT_EQUAL(5, inlineHits);
+    TEST_ASSERT_TRUE(hasInfo);
+    TEST_ASSERT_TRUE(date.isEqual(info.nextRunUtc, date.fromUtc(2025, 11, 2, 10, 30, 0)));
+}
+
+static void test_tick_picks_up_timezone_change() {
+    ESPScheduler localScheduler(date);
+    localScheduler.addJob(Schedule::dailyAtLocal(9, 0), SchedulerJobMode::Inline, &inlineCallback, nullptr);
+    localScheduler.tick(date.fromUtc(2025, 1, 1, 0, 0, 0));
+
+    setenv("TZ", "IST-5:30", 1);
+    tzset();
+    localScheduler.addJob(Schedule::dailyAtLocal(9, 0), SchedulerJobMode::Inline, &inlineCallback, nullptr);
+    localScheduler.tick(date.fromUtc(2025, 1, 1, 0, 0, 0));
+    JobInfo utcJob{};
+    JobInfo istJob{};
+    const bool hasUtc = localScheduler.getJobInfo(0, utcJob);
+    const bool hasIst = localScheduler.getJobInfo(1, istJob);
+    setenv("TZ", "UTC", 1);
+    tzset();
+    TEST_ASSERT_TRUE(hasUtc && hasIst);
+    TEST_ASSERT_TRUE(date.isEqual(utcJob.nextRunUtc, date.fromUtc(2025, 1, 1, 9, 0, 0)));
+    TEST_ASSERT_TRUE(date.isEqual(istJob.nextRunUtc, date.fromUtc(2025, 1, 1, 3, 30, 0)));
+}
+
 static void test_inline_tick_runs_and_reschedules() {
     inlineHits = 0;
     Schedule s = Schedule::dailyAtLocal(6, 0);
@@ -76,6 +260,110 @@ static void test_inline_tick_runs_and_reschedules() {
     TEST_ASSERT_EQUAL(2, inlineHits);
 }
 
+static uint32_t selfCancelId = 0;
+
+static void selfCancelCallback(void* userData) {
+    (void)userData;
+    inlineHits++;
+    scheduler.cancelJob(selfCancelId);
+}
+
+static void test_inline_queue_fires_in_deadline_order_with_pause_and_cancel() {
+    uint32_t late = scheduler.addJob(Schedule::dailyAtLocal(8, 0), SchedulerJobMode::Inline, &inlineCallback, nullptr);
+    uint32_t early = scheduler.addJob(Schedule::dailyAtLocal(6, 0), SchedulerJobMode::Inline, &inlineCallback, nullptr);
+    uint32_t middle = scheduler.addJob(Schedule::dailyAtLocal(7, 0), SchedulerJobMode::Inline, &inlineCallback, nullptr);
+    TEST_ASSERT_NOT_EQUAL(0u, late);
+    TEST_ASSERT_NOT_EQUAL(0u, early);
+    TEST_ASSERT_NOT_EQUAL(0u, middle);
+
+    scheduler.tick(date.fromUtc(2025, 1, 1, 5, 0, 0));  // resolves deadlines only
+    TEST_ASSERT_EQUAL(0, inlineHits);
+
+    TEST_ASSERT_TRUE(scheduler.cancelJob(middle));
+    TEST_ASSERT_TRUE(scheduler.pauseJob(late));
+    scheduler.tick(date.fromUtc(2025, 1, 1, 9, 0, 0));
+    TEST_ASSERT_EQUAL(1, inlineHits);  // only the 06:00 job
+
+    TEST_ASSERT_TRUE(scheduler.resumeJob(late));
+    scheduler.tick(date.fromUtc(2025, 1, 1, 9, 0, 0));
+    TEST_ASSERT_EQUAL(2, inlineHits);  // resumed job catches its pending 08:00 slot
+    TEST_ASSERT_FALSE(scheduler.cancelJob(middle));
+}
+
+static void test_job_still_due_after_its_run_waits_for_the_next_tick() {
+    ESPScheduler local(date);
+    int hits = 0;
+    const Schedule everyMinute = Schedule::custom(ScheduleField::any(), ScheduleField::any(), ScheduleField::any(),
+                                                  ScheduleField::any(), ScheduleField::any());
+    TEST_ASSERT_NOT_EQUAL(0u, local.addJob(everyMinute, SchedulerJobMode::Inline, [&hits] { ++hits; }));
+
+    // However far behind the job is, each tick replays one occurrence.
+    const DateTime start = date.fromUtc(2025, 1, 1, 0, 0, 0);
+    local.tick(start);
+    TEST_ASSERT_EQUAL(1, hits);
+    local.tick(date.addSeconds(start, 60));
+    TEST_ASSERT_EQUAL(2, hits);
+    local.tick(date.addSeconds(start, 11 * 60));
+    TEST_ASSERT_EQUAL(3, hits);
+    local.tick(date.addSeconds(start, 30 * 24 * 3600));
+    TEST_ASSERT_EQUAL(4, hits);
+    local.deinit();
+}
+
+static void test_callback_can_cancel_itself_during_tick() {
+    selfCancelId = scheduler.addJob(Schedule::dailyAtLocal(6, 0), SchedulerJobMode::Inline, &selfCancelCallback, nullptr);
+    uint32_t other = scheduler.addJob(Schedule::dailyAtLocal(6, 0), SchedulerJobMode::Inline, &inlineCallback, nullptr);
+    TEST_ASSERT_NOT_EQUAL(0u, selfCancelId);
+
+    scheduler.tick(date.fromUtc(2025, 1, 1, 6, 0, 0));
+    TEST_ASSERT_EQUAL(2, inlineHits);
+    scheduler.tick(date.fromUtc(2025, 1, 2, 6, 0, 0));
+    TEST_ASSERT_EQUAL(3, inlineHits);
+
+    JobInfo info{};
+    TEST_ASSERT_TRUE(scheduler.getJobInfo(0, info));
+    TEST_ASSERT_EQUAL(other, info.id);
+    TEST_ASSERT_FALSE(scheduler.getJobInfo(1, info));
+}
+
+static void test_stale_job_id_is_rejected_after_slot_reuse() {
+    uint32_t first = scheduler.addJob(Schedule::dailyAtLocal(6, 0), SchedulerJobMode::Inline, &inlineCallback, nullptr);
+    TEST_ASSERT_NOT_EQUAL(0u, first);
+    TEST_ASSERT_TRUE(scheduler.cancelJob(first));
+    scheduler.tick(date.fromUtc(2025, 1, 1, 5, 0, 0));  // releases the slot
+
+    uint32_t second = scheduler.addJob(Schedule::dailyAtLocal(6, 0), SchedulerJobMode::Inline, &inlineCallback, nullptr);
+    TEST_ASSERT_NOT_EQUAL(0u, second);
+    TEST_ASSERT_NOT_EQUAL(first, second);
+    TEST_ASSERT_FALSE(scheduler.pauseJob(first));
+    TEST_ASSERT_FALSE(scheduler.cancelJob(first));
+
+    scheduler.tick(date.fromUtc(2025, 1, 1, 6, 0, 0));
+    TEST_ASSERT_EQUAL(1, inlineHits);
+    TEST_ASSERT_TRUE(scheduler.cancelJob(second));
+}
+
+static void test_job_ids_address_their_own_job_among_many() {
+    uint32_t ids[64];
+    for (int i = 0; i < 64; ++i) {
+        ids[i] = scheduler.addJob(Schedule::dailyAtLocal(6, 0), SchedulerJobMode::Inline, &inlineCallback, nullptr);
+        TEST_ASSERT_NOT_EQUAL(0u, ids[i]);
+    }
+    for (int i = 0; i < 64; i += 2) {
+        TEST_ASSERT_TRUE(scheduler.cancelJob(ids[i]));
+    }
+    for (int i = 1; i < 64; i += 4) {
+        TEST_ASSERT_TRUE(scheduler.pauseJob(ids[i]));
+    }
+    scheduler.tick(date.fromUtc(2025, 1, 1, 5, 0, 0));
+    scheduler.tick(date.fromUtc(2025, 1, 1, 6, 0, 0));
+    TEST_ASSERT_EQUAL(16, inlineHits);
+
+    JobInfo info{};
+    TEST_ASSERT_TRUE(scheduler.getJobInfo(31, info));
+    TEST_ASSERT_FALSE(scheduler.getJobInfo(32, info));
+}
+
 static void test_get_job_info_reports_next_run() {
     inlineHits = 0;
     Schedule s = Schedule::dailyAtLocal(6, 0);
@@ -124,6 +412,1274 @@ static void test_psram_buffer_config_constructor_adds_inline_job() {
     localScheduler.cancelAll();
 }
 
+struct CallableCounter {
+    int hits = 0;
+    void bump() { hits++; }
+};
+
+static void test_callable_keeps_small_targets_inline() {
+    CallableCounter counter;
+    int* hits = &counter.hits;
+    SchedulerCallable pointer(&inlineCallback, nullptr);
+    SchedulerCallable member(&counter, &CallableCounter::bump);
+    SchedulerCallable lambda = SchedulerCallable::from([hits]() { *hits += 10; });
+    TEST_ASSERT_FALSE(pointer.onHeap());
+    TEST_ASSERT_FALSE(member.onHeap());
+    TEST_ASSERT_FALSE(lambda.onHeap());
+
+    // 24 bytes of captures and a SchedulerFunction bound to userData fit on every target.
+    TEST_ASSERT_GREATER_OR_EQUAL(24u, SchedulerCallable::kInlineBytes);
+    const uint32_t words[6] = {1, 2, 3, 4, 5, 6};
+    SchedulerCallable sixWords = SchedulerCallable::from([words]() { inlineHits += static_cast<int>(words[5]) - 6; });
+    TEST_ASSERT_FALSE(sixWords.onHeap());
+    SchedulerFunction function = [](void* userData) { *static_cast<int*>(userData) += 0; };
+    SchedulerCallable bound = SchedulerCallable::from(function, hits);
+    TEST_ASSERT_FALSE(bound.onHeap());
+    SchedulerCallable noData = SchedulerCallable::from(SchedulerFunctionNoData([]() {}));
+    TEST_ASSERT_FALSE(noData.onHeap());
+
+    char big[SchedulerCallable::kInlineBytes + 1] = {};
+    SchedulerCallable large = SchedulerCallable::from([big, hits]() { *hits += 100 + big[0]; });
+    TEST_ASSERT_TRUE(large.onHeap());
+
+    SchedulerCallable moved = std::move(lambda);
+    TEST_ASSERT_FALSE(static_cast<bool>(lambda));
+    pointer();
+    member();
+    moved();
+    large();
+    TEST_ASSERT_EQUAL(1, inlineHits);
+    TEST_ASSERT_EQUAL(111, counter.hits);
+
+    std::function<void()> empty;
+    TEST_ASSERT_FALSE(static_cast<bool>(SchedulerCallable::from(empty)));
+    TEST_ASSERT_EQUAL(0u, scheduler.addJob(Schedule::dailyAtLocal(6, 0), SchedulerJobMode::Inline, empty));
+}
+
+static void test_add_job_accepts_lambdas_member_bindings_and_user_data() {
+    CallableCounter counter;
+    int step = 5;
+    int* hits = &counter.hits;
+    uint32_t a = scheduler.addJob(Schedule::dailyAtLocal(6, 0), SchedulerJobMode::Inline, [hits]() { (*hits)++; });
+    uint32_t b = scheduler.addJob(
+        Schedule::dailyAtLocal(6, 0),
+        SchedulerJobMode::Inline,
+        [hits](void* userData) { *hits += *static_cast<int*>(userData); },
+        &step);
+    uint32_t c = scheduler.addJob(Schedule::dailyAtLocal(6, 0),
+                                  SchedulerJobMode::Inline,
+                                  SchedulerCallable(&counter, &CallableCounter::bump));
+    TEST_ASSERT_NOT_EQUAL(0u, a);
+    TEST_ASSERT_NOT_EQUAL(0u, b);
+    TEST_ASSERT_NOT_EQUAL(0u, c);
+
+    scheduler.tick(date.fromUtc(2025, 1, 1, 5, 0, 0));
+    scheduler.tick(date.fromUtc(2025, 1, 1, 6, 0, 0));
+    TEST_ASSERT_EQUAL(7, counter.hits);
+}
+
+static void test_static_scheduler_runs_captures_and_reports_full() {
+    ESPSchedulerStatic<3, 24> fixed(date);
+    int hits = 0;
+    int step = 5;
+    int* counter = &hits;
+
+    uint32_t a = fixed.addJob(Schedule::dailyAtLocal(6, 0), SchedulerJobMode::Inline, [counter]() { (*counter)++; });
+    uint32_t b = fixed.addJob(
+        Schedule::dailyAtLocal(6, 0),
+        SchedulerJobMode::Inline,
+        [counter](void* userData) { *counter += *static_cast<int*>(userData); },
+        &step);
+    uint32_t c = fixed.addJob(Schedule::dailyAtLocal(7, 0), SchedulerJobMode::Inline, &inlineCallback, nullptr);
+    TEST_ASSERT_NOT_EQUAL(0u, a);
+    TEST_ASSERT_NOT_EQUAL(0u, b);
+    TEST_ASSERT_NOT_EQUAL(0u, c);
+    TEST_ASSERT_EQUAL(0u, fixed.addJob(Schedule::dailyAtLocal(8, 0), SchedulerJobMode::Inline, [counter]() { (*counter)++; }));
+    TEST_ASSERT_EQUAL(0u, fixed.addJob(Schedule::dailyAtLocal(8, 0), SchedulerJobMode::WorkerTask, &inlineCallback, nullptr));
+
+    fixed.tick(date.fromUtc(2025, 1, 1, 5, 0, 0));
+    fixed.tick(date.fromUtc(2025, 1, 1, 6, 0, 0));
+    TEST_ASSERT_EQUAL(6, hits);
+
+    TEST_ASSERT_TRUE(fixed.cancelJob(c));
+    uint32_t d = fixed.addJob(Schedule::dailyAtLocal(8, 0), SchedulerJobMode::Inline, [counter]() { *counter += 10; });
+    TEST_ASSERT_NOT_EQUAL(0u, d);
+    fixed.tick(date.fromUtc(2025, 1, 1, 8, 0, 0));
+    TEST_ASSERT_EQUAL(16, hits);
+    TEST_ASSERT_EQUAL(0, inlineHits);
+}
+
+static void test_static_scheduler_holds_max_jobs_next_to_the_command_queue() {
+    ESPSchedulerConfig cfg{};
+    cfg.commandQueueSize = 2;
+    ESPSchedulerStatic<3, 24> fixed(date, cfg);
+    int hits = 0;
+    int* counter = &hits;
+
+    // The ids held for postJob() come on top of MaxJobs.
+    uint32_t added[3]{};
+    for (uint32_t& id : added) {
+        id = fixed.addJob(Schedule::dailyAtLocal(6, 0), SchedulerJobMode::Inline, [counter]() { ++*counter; });
+        TEST_ASSERT_NOT_EQUAL(0u, id);
+    }
+    TEST_ASSERT_EQUAL(0u, fixed.addJob(Schedule::dailyAtLocal(6, 0), SchedulerJobMode::Inline, [counter]() {}));
+    TEST_ASSERT_NOT_EQUAL(0u, fixed.postJob(Schedule::dailyAtLocal(6, 0), SchedulerJobMode::Inline,
+                                            [counter]() { *counter += 10; }));
+    fixed.tick(date.fromUtc(2025, 1, 1, 5, 0, 0));
+    fixed.tick(date.fromUtc(2025, 1, 1, 6, 0, 0));
+    TEST_ASSERT_EQUAL(13, hits);
+
+    // A posted job leaves the count for addJob() alone.
+    TEST_ASSERT_EQUAL(0u, fixed.addJob(Schedule::dailyAtLocal(7, 0), SchedulerJobMode::Inline, [counter]() {}));
+    TEST_ASSERT_TRUE(fixed.cancelJob(added[0]));
+    TEST_ASSERT_NOT_EQUAL(0u, fixed.addJob(Schedule::dailyAtLocal(7, 0), SchedulerJobMode::Inline, [counter]() {}));
+}
+
+#if ESP_SCHEDULER_TEST_COUNTS_ALLOCATIONS
+static void test_static_scheduler_does_not_allocate_after_construction() {
+    ESPSchedulerConfig cfg{};
+    cfg.commandQueueSize = 2;
+    cfg.traceBufferSize = 16;
+    ESPSchedulerStatic<8, 24> fixed(date, cfg);
+    int hits = 0;
+    int* counter = &hits;
+    int step = 2;
+    // Warm-up outside the window: the first addJob() marks the scheduler initialised
+    // and the first tick loads libc's TZ rules.
+    TEST_ASSERT_NOT_EQUAL(0u, fixed.addJob(Schedule::dailyAtLocal(5, 0), SchedulerJobMode::Inline, [counter]() {}));
+    fixed.tick(date.fromUtc(2025, 1, 1, 4, 0, 0));
+
+    alloc_counter::start();
+    const uint32_t daily = fixed.addJob(Schedule::dailyAtLocal(6, 0), SchedulerJobMode::Inline, [counter]() { ++*counter; });
+    const uint32_t interval = fixed.addJob(Schedule::everyMs(1), SchedulerJobMode::Inline,
+                                           [counter](void* data) { *counter += *static_cast<int*>(data); }, &step);
+    const uint32_t posted = fixed.postJob(Schedule::onDemand(), SchedulerJobMode::Inline, [counter]() { *counter += 100; });
+    // Worker jobs, dependencies, keyed jobs and snapshots are refused rather than allocated.
+    const uint32_t worker = fixed.addJob(Schedule::dailyAtLocal(6, 0), SchedulerJobMode::WorkerTask, [counter]() {});
+    const uint32_t postedWorker = fixed.postJob(Schedule::dailyAtLocal(6, 0), SchedulerJobMode::WorkerTask, [counter]() {});
+    const uint32_t dependent = fixed.addJobAfter({daily}, SchedulerJobMode::Inline, [counter]() {});
+    const uint32_t keyed =
+        fixed.addJob(Schedule::dailyAtLocal(6, 0), JobOptions{}.persistAs(9), SchedulerJobMode::Inline, [counter]() {});
+    SchedulerFileSnapshotStore store("/nonexistent");
+    const bool saved = fixed.saveSnapshot(store);
+    const bool loaded = fixed.loadSnapshot(store);
+
+    delay(2);
+    fixed.tick(date.fromUtc(2025, 1, 1, 6, 0, 0));
+    const bool triggered = fixed.postTrigger(posted);
+    fixed.tick(date.fromUtc(2025, 1, 1, 6, 0, 1));
+    JobInfo info{};
+    const bool listed = fixed.getJobInfo(0, info);
+    const size_t visited = fixed.forEachJob([](const JobSummary&) {});
+    const bool paused = fixed.pauseJob(interval);
+    const bool cancelled = fixed.cancelJob(daily);
+    fixed.tick(date.fromUtc(2025, 1, 2, 6, 0, 0));
+    const uint32_t reused = fixed.addJob(Schedule::dailyAtLocal(7, 0), SchedulerJobMode::Inline, [counter]() {});
+    SchedulerTraceRecord records[16];
+    const size_t traced = fixed.drainTrace(records, 16);
+    const size_t allocations = alloc_counter::stop();
+
+    TEST_ASSERT_TRUE(daily != 0 && interval != 0 && posted != 0 && reused != 0);
+    TEST_ASSERT_EQUAL_UINT32(0, worker);
+    TEST_ASSERT_EQUAL_UINT32(0, postedWorker);
+    TEST_ASSERT_EQUAL_UINT32(0, dependent);
+    TEST_ASSERT_EQUAL_UINT32(0, keyed);
+    TEST_ASSERT_FALSE(saved);
+    TEST_ASSERT_FALSE(loaded);
+    TEST_ASSERT_TRUE(triggered && listed && paused && cancelled);
+    TEST_ASSERT_EQUAL(4u, visited);
+    TEST_ASSERT_GREATER_THAN(0u, traced);
+    TEST_ASSERT_GREATER_OR_EQUAL(103, hits);  // daily, interval (at least once), posted
+    if (alloc_counter::supported()) {
+        TEST_ASSERT_EQUAL(0u, allocations);
+        // The counter itself works: one malloc the compiler cannot elide.
+        void* (*volatile allocate)(size_t) = &std::malloc;
+        alloc_counter::start();
+        void* probe = allocate(16);
+        TEST_ASSERT_EQUAL(1u, alloc_counter::stop());
+        std::free(probe);
+    }
+}
+#endif
+
+static void test_posted_commands_apply_on_next_tick_in_order() {
+    ESPSchedulerConfig cfg{};
+    cfg.commandQueueSize = 4;
+    ESPScheduler posted(date, cfg);
+    JobInfo info{};
+
+    uint32_t kept = posted.postJob(Schedule::dailyAtLocal(6, 0), SchedulerJobMode::Inline, &inlineCallback, nullptr);
+    uint32_t dropped = posted.postJob(Schedule::dailyAtLocal(6, 0), SchedulerJobMode::Inline, &inlineCallback, nullptr);
+    TEST_ASSERT_NOT_EQUAL(0u, kept);
+    TEST_ASSERT_NOT_EQUAL(0u, dropped);
+    TEST_ASSERT_NOT_EQUAL(kept, dropped);
+    TEST_ASSERT_TRUE(posted.postCancel(dropped));
+    TEST_ASSERT_TRUE(posted.postPause(kept));
+    TEST_ASSERT_FALSE(posted.postResume(kept));  // the ring holds four commands
+    TEST_ASSERT_FALSE(posted.getJobInfo(0, info));
+    TEST_ASSERT_FALSE(posted.cancelJob(kept));  // not applied yet
+
+    posted.tick(date.fromUtc(2025, 1, 1, 5, 0, 0));
+    TEST_ASSERT_TRUE(posted.getJobInfo(0, info));
+    TEST_ASSERT_EQUAL(kept, info.id);
+    TEST_ASSERT_FALSE(info.enabled);
+    TEST_ASSERT_FALSE(posted.getJobInfo(1, info));
+
+    TEST_ASSERT_TRUE(posted.postResume(kept));
+    posted.tick(date.fromUtc(2025, 1, 1, 6, 0, 0));
+    TEST_ASSERT_EQUAL(1, inlineHits);
+
+    TEST_ASSERT_EQUAL(0u, scheduler.postJob(Schedule::dailyAtLocal(6, 0), SchedulerJobMode::Inline, &inlineCallback, nullptr));
+}
+
+static ESPScheduler* postTarget = nullptr;
+static std::atomic<int> postersDone{0};
+static std::atomic<int> postedHits{0};
+
+static void postingTask(void* userData) {
+    (void)userData;
+    int posted = 0;
+    while (posted < 50) {
+        uint32_t id = postTarget->postJob(Schedule::dailyAtLocal(7, 0), SchedulerJobMode::Inline, []() { postedHits++; });
+        if (id == 0) {
+            vTaskDelay(1);  // ring full until the next tick drains it
+            continue;
+        }
+        while (!postTarget->postCancel(id)) {
+            vTaskDelay(1);
+        }
+        posted++;
+    }
+    postersDone++;
+    vTaskDelete(nullptr);
+}
+
+static void test_jobs_posted_from_other_tasks_are_applied_by_tick() {
+    ESPSchedulerConfig cfg{};
+    cfg.commandQueueSize = 8;
+    ESPScheduler posted(date, cfg);
+    postTarget = &posted;
+    postersDone = 0;
+    postedHits = 0;
+
+    xTaskCreate(&postingTask, "poster-a", 4096, nullptr, 1, nullptr);
+    xTaskCreate(&postingTask, "poster-b", 4096, nullptr, 1, nullptr);
+    const unsigned long start = millis();
+    while (postersDone.load() < 2 && millis() - start < 5000) {
+        posted.tick(date.fromUtc(2025, 1, 1, 6, 0, 0));
+        delay(1);
+    }
+    posted.tick(date.fromUtc(2025, 1, 1, 6, 0, 0));
+    TEST_ASSERT_EQUAL(2, postersDone.load());
+
+    JobInfo info{};
+    TEST_ASSERT_FALSE(posted.getJobInfo(0, info));  // every posted job was cancelled right after
+    TEST_ASSERT_EQUAL(0, postedHits.load());
+}
+
+static void test_trigger_from_isr_runs_job_early_without_moving_schedule() {
+    ESPSchedulerConfig cfg{};
+    cfg.commandQueueSize = 4;
+    ESPScheduler triggered(date, cfg);
+    triggered.setMinValidUnixSeconds(INT64_MAX);  // clock invalid: only triggers may run
+
+    uint32_t daily = triggered.addJob(Schedule::dailyAtLocal(6, 0), SchedulerJobMode::Inline, &inlineCallback, nullptr);
+    uint32_t paused = triggered.addJob(Schedule::dailyAtLocal(6, 0), SchedulerJobMode::Inline, &inlineCallback, nullptr);
+    TEST_ASSERT_TRUE(triggered.pauseJob(paused));
+
+    BaseType_t woken = pdFALSE;
+    TEST_ASSERT_TRUE(triggered.triggerNowFromISR(daily, &woken));
+    TEST_ASSERT_TRUE(triggered.triggerNowFromISR(daily, &woken));  // coalesces with the first
+    TEST_ASSERT_TRUE(triggered.triggerNowFromISR(paused, &woken));
+    uint32_t once = triggered.runOnceFromISR(SchedulerJobMode::Inline, &inlineCallback, nullptr, &woken);
+    TEST_ASSERT_NOT_EQUAL(0u, once);
+
+    triggered.tick(date.fromUtc(2025, 1, 1, 5, 0, 0));
+    TEST_ASSERT_EQUAL(2, inlineHits);  // daily once, deferred one-shot once
+    TEST_ASSERT_FALSE(triggered.cancelJob(once));
+
+    triggered.setMinValidUnixSeconds(0);
+    triggered.tick(date.fromUtc(2025, 1, 1, 5, 0, 0));  // resolves the daily deadline
+    triggered.tick(date.fromUtc(2025, 1, 1, 6, 0, 0));
+    TEST_ASSERT_EQUAL(3, inlineHits);  // the 06:00 slot still fires for the daily job
+}
+
+static ESPScheduler* isrTarget = nullptr;
+static std::atomic<int> isrWorkerHits{0};
+
+static void isrWorkerCallback(void* userData) {
+    (void)userData;
+    isrWorkerHits++;
+}
+
+static void fakeInterruptTask(void* userData) {
+    (void)userData;
+    delay(20);
+    isrTarget->runOnceFromISR(SchedulerJobMode::Inline, &inlineCallback, nullptr);
+    vTaskDelete(nullptr);
+}
+
+static void test_isr_submission_wakes_tick_task_and_worker() {
+    ESPSchedulerConfig cfg{};
+    cfg.commandQueueSize = 4;
+    ESPScheduler triggered(date, cfg);
+    triggered.setMinValidUnixSeconds(0);
+    isrTarget = &triggered;
+    isrWorkerHits = 0;
+
+    uint32_t worker = triggered.addJob(
+        Schedule::weeklyAtLocal(0x01, 3, 0), SchedulerJobMode::WorkerTask, &isrWorkerCallback, nullptr);
+    TEST_ASSERT_NOT_EQUAL(0u, worker);
+    triggered.tick();
+
+    ulTaskNotifyTake(pdTRUE, 0);  // drop wake-ups left over from earlier tests
+    xTaskCreate(&fakeInterruptTask, "fake-isr", 4096, nullptr, 1, nullptr);
+    const unsigned long start = millis();
+    triggered.waitForWork(2000);
+    TEST_ASSERT_LESS_THAN(1000u, millis() - start);
+    triggered.tick();
+    TEST_ASSERT_EQUAL(1, inlineHits);
+
+    TEST_ASSERT_TRUE(triggered.triggerNowFromISR(worker));
+    triggered.tick();
+    const unsigned long waitStart = millis();
+    while (isrWorkerHits.load() < 1 && millis() - waitStart < 2000) {
+        delay(5);
+    }
+    TEST_ASSERT_EQUAL(1, isrWorkerHits.load());
+}
+
+static void workerCallback(void* userData) {
+    (void)userData;
+    workerHits++;
+    delay(50);
+}
+
+static bool waitForWorkerHits(int expected, uint32_t timeoutMs) {
+    const unsigned long start = millis();
+    while (workerHits.load() < expected && millis() - start < timeoutMs) {
+        delay(10);
+    }
+    return workerHits.load() >= expected;
+}
+
+struct TraceCapture {
+    std::vector<uint8_t> bytes;
+    size_t write(const uint8_t* data, size_t size) {
+        bytes.insert(bytes.end(), data, data + size);
+        return size;
+    }
+};
+
+static void test_trace_records_job_lifecycle_and_dispatch() {
+    ESPSchedulerConfig config;
+    config.traceBufferSize = 8;
+    ESPScheduler local(date, config);
+    const DateTime invalid = date.fromUtc(1970, 1, 1, 0, 0, 0);
+    local.tick(invalid);
+    const uint32_t id = local.addJob(Schedule::dailyAtLocal(9, 0), SchedulerJobMode::Inline, &inlineCallback);
+    local.tick(date.fromUtc(2025, 1, 1, 8, 59, 0));
+    local.tick(date.fromUtc(2025, 1, 1, 9, 0, 2));
+    TEST_ASSERT_TRUE(local.pauseJob(id));
+    TEST_ASSERT_TRUE(local.cancelJob(id));
+
+    SchedulerTraceRecord records[8] = {};
+    TEST_ASSERT_EQUAL(6, static_cast<int>(local.drainTrace(records, 8)));
+    const SchedulerTraceEvent expected[] = {SchedulerTraceEvent::ClockInvalid,
+                                            SchedulerTraceEvent::JobAdded,
+                                            SchedulerTraceEvent::Dispatch,
+                                            SchedulerTraceEvent::Rescheduled,
+                                            SchedulerTraceEvent::JobPaused,
+                                            SchedulerTraceEvent::JobCancelled};
+    for (size_t i = 0; i < 6; ++i) {
+        TEST_ASSERT_EQUAL(static_cast<int>(expected[i]), records[i].event);
+        TEST_ASSERT_EQUAL(static_cast<int>(i), records[i].sequence);
+    }
+    TEST_ASSERT_EQUAL_UINT32(id, records[2].jobId);
+    TEST_ASSERT_GREATER_OR_EQUAL(2000000, records[2].value);  // started two seconds late
+    TEST_ASSERT_EQUAL(24 * 3600 - 2, records[3].value);     // next run tomorrow at 09:00
+
+    // A full ring drops new records and counts them; a sink drain starts with a Sync record.
+    for (int i = 0; i < 10; ++i) {
+        local.cancelJob(id);
+        local.pauseJob(local.addJob(Schedule::dailyAtLocal(10, 0), SchedulerJobMode::Inline, &inlineCallback));
+    }
+    TEST_ASSERT_GREATER_THAN(0u, local.traceDropped());
+    TraceCapture capture;
+    TEST_ASSERT_EQUAL(8, static_cast<int>(local.drainTrace(capture)));
+    TEST_ASSERT_EQUAL(9 * sizeof(SchedulerTraceRecord), capture.bytes.size());
+    SchedulerTraceRecord sync{};
+    std::memcpy(&sync, capture.bytes.data(), sizeof(sync));
+    TEST_ASSERT_EQUAL_UINT32(kSchedulerTraceSyncMagic, sync.jobId);
+    TEST_ASSERT_EQUAL(0, static_cast<int>(local.drainTrace(capture)));
+    local.deinit();
+}
+
+static void test_worker_pool_runs_jobs_on_shared_dispatchers() {
+    ESPSchedulerConfig cfg{};
+    cfg.workerPoolSize = 1;
+    ESPScheduler localScheduler(date, cfg);
+    localScheduler.setMinValidUnixSeconds(0);
+    workerHits = 0;
+
+    DateTime now = date.now();
+    uint32_t first = localScheduler.addJobOnceUtc(now, SchedulerJobMode::WorkerTask, &workerCallback, nullptr);
+    uint32_t second = localScheduler.addJobOnceUtc(now, SchedulerJobMode::WorkerTask, &workerCallback, nullptr);
+    TEST_ASSERT_NOT_EQUAL(0u, first);
+    TEST_ASSERT_NOT_EQUAL(0u, second);
+
+    TEST_ASSERT_TRUE(waitForWorkerHits(2, 3000));
+    TEST_ASSERT_GREATER_OR_EQUAL(1u, localScheduler.workerQueueHighWater());
+    TEST_ASSERT_EQUAL(0u, localScheduler.workerQueueDepth());
+
+    // The last callback is still sleeping when the hit count lands; give it time to finish.
+    JobInfo info{};
+    const unsigned long start = millis();
+    do {
+        delay(10);
+        localScheduler.cleanup();
+    } while (localScheduler.getJobInfo(0, info) && millis() - start < 3000);
+    TEST_ASSERT_FALSE(localScheduler.getJobInfo(0, info));
+}
+
+static void test_worker_task_wakes_on_resume_and_clock_guard_change() {
+    ESPScheduler localScheduler(date);
+    localScheduler.setMinValidUnixSeconds(INT64_MAX);  // hold the worker on the clock guard
+    workerHits = 0;
+
+    uint32_t id = localScheduler.addJobOnceUtc(date.now(), SchedulerJobMode::WorkerTask, &workerCallback, nullptr);
+    TEST_ASSERT_NOT_EQUAL(0u, id);
+    TEST_ASSERT_TRUE(localScheduler.pauseJob(id));
+
+    localScheduler.setMinValidUnixSeconds(0);
+    delay(200);
+    TEST_ASSERT_EQUAL(0, workerHits.load());  // paused: blocked without polling
+
+    TEST_ASSERT_TRUE(localScheduler.resumeJob(id));
+    TEST_ASSERT_TRUE(waitForWorkerHits(1, 1000));  // well under the old 60 s polling chunk
+
+    delay(100);
+    localScheduler.cleanup();
+    JobInfo info{};
+    TEST_ASSERT_FALSE(localScheduler.getJobInfo(0, info));
+}
+
+static void test_inline_interval_job_runs_on_monotonic_clock() {
+    ESPScheduler localScheduler(date);
+    inlineHits = 0;
+    uint32_t id = localScheduler.addJob(Schedule::everyMs(20), SchedulerJobMode::Inline, &inlineCallback, nullptr);
+    TEST_ASSERT_NOT_EQUAL(0u, id);
+
+    // A wall clock below the validity guard does not hold interval jobs back.
+    const DateTime invalid = date.fromUtc(1970, 1, 1, 0, 0, 0);
+    const unsigned long start = millis();
+    while (millis() - start < 210) {
+        localScheduler.tick(invalid);
+        delay(1);
+    }
+    TEST_ASSERT_GREATER_OR_EQUAL(7, inlineHits);
+    TEST_ASSERT_LESS_OR_EQUAL(11, inlineHits);
+
+    JobInfo info{};
+    TEST_ASSERT_TRUE(localScheduler.getJobInfo(0, info));
+    TEST_ASSERT_EQUAL_UINT32(20, info.schedule.intervalMs);
+
+    TEST_ASSERT_TRUE(localScheduler.pauseJob(id));
+    const int paused = inlineHits;
+    delay(60);
+    localScheduler.tick(invalid);
+    TEST_ASSERT_EQUAL(paused, inlineHits);
+    TEST_ASSERT_TRUE(localScheduler.cancelJob(id));
+}
+
+static void test_job_stats_track_runs_lateness_and_overruns() {
+    ESPScheduler local(date);
+    const uint32_t daily = local.addJob(Schedule::dailyAtLocal(9, 0), SchedulerJobMode::Inline, &inlineCallback);
+    local.tick(date.fromUtc(2025, 1, 1, 8, 59, 0));
+    local.tick(date.fromUtc(2025, 1, 1, 9, 0, 3));  // three seconds late
+
+    JobStats stats{};
+    TEST_ASSERT_TRUE(local.getJobStats(daily, stats));
+    TEST_ASSERT_EQUAL_UINT32(1, stats.runCount);
+    TEST_ASSERT_GREATER_OR_EQUAL(3000000, stats.lastLatenessUs);
+    TEST_ASSERT_LESS_THAN(4000000, stats.lastLatenessUs);
+    TEST_ASSERT_EQUAL_INT64(date.fromUtc(2025, 1, 1, 9, 0, 3).epochSeconds, stats.lastRunUtc.epochSeconds);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.overruns);
+
+    // A 20 ms fixed-rate job whose callback takes ~70 ms overruns and skips slots.
+    const uint32_t slow = local.addJob(Schedule::everyMs(20), SchedulerJobMode::Inline, [] { delay(70); });
+    const unsigned long start = millis();
+    while (millis() - start < 500 && local.getJobStats(slow, stats) && stats.runCount < 2) {
+        local.tick(date.fromUtc(2025, 1, 1, 9, 0, 3));
+        delay(1);
+    }
+    TEST_ASSERT_TRUE(local.getJobStats(slow, stats));
+    TEST_ASSERT_EQUAL_UINT32(2, stats.runCount);
+    TEST_ASSERT_GREATER_OR_EQUAL(60000u, stats.maxDurationUs);
+    TEST_ASSERT_GREATER_OR_EQUAL(60000u, stats.meanDurationUs);
+    TEST_ASSERT_EQUAL_UINT32(2, stats.overruns);
+    TEST_ASSERT_GREATER_OR_EQUAL(4u, stats.missedSlots);
+
+    JobInfo info{};
+    TEST_ASSERT_TRUE(local.getJobInfo(1, info));
+    TEST_ASSERT_EQUAL_UINT32(2, info.stats.runCount);
+    TEST_ASSERT_FALSE(local.getJobStats(0xFFFFFFFFu, stats));
+    local.deinit();
+}
+
+static void test_misfire_policies_bound_catch_up_after_a_stall() {
+    ESPScheduler local(date);
+    const Schedule everyMinute = Schedule::custom(ScheduleField::any(), ScheduleField::any(), ScheduleField::any(),
+                                                  ScheduleField::any(), ScheduleField::any());
+    const SchedulerMisfirePolicy policies[] = {SchedulerMisfirePolicy::CatchUp, SchedulerMisfirePolicy::RunOnce,
+                                               SchedulerMisfirePolicy::Coalesce, SchedulerMisfirePolicy::Skip};
+    int hits[4] = {0, 0, 0, 0};
+    uint32_t ids[4] = {0, 0, 0, 0};
+    for (int i = 0; i < 4; ++i) {
+        int* counter = &hits[i];
+        ids[i] = local.addJob(everyMinute, JobOptions{}.withMisfire(policies[i], 60, 3), SchedulerJobMode::Inline,
+                              [counter] { ++*counter; });
+        TEST_ASSERT_NOT_EQUAL(0u, ids[i]);
+    }
+
+    local.tick(date.fromUtc(2025, 1, 1, 10, 0, 0));
+    // Ten minutes without a tick: 10:01..10:10 are all overdue.
+    local.tick(date.fromUtc(2025, 1, 1, 10, 10, 30));
+    TEST_ASSERT_EQUAL(2, hits[0]);
+    TEST_ASSERT_EQUAL(2, hits[1]);
+    TEST_ASSERT_EQUAL(4, hits[2]);
+    TEST_ASSERT_EQUAL(1, hits[3]);
+
+    JobStats stats{};
+    TEST_ASSERT_TRUE(local.getJobStats(ids[2], stats));
+    TEST_ASSERT_EQUAL_UINT32(7, stats.missedSlots);
+    TEST_ASSERT_TRUE(local.getJobStats(ids[3], stats));
+    TEST_ASSERT_EQUAL_UINT32(10, stats.missedSlots);
+    JobInfo info{};
+    TEST_ASSERT_TRUE(local.getJobInfo(3, info));
+    TEST_ASSERT_EQUAL_INT64(date.fromUtc(2025, 1, 1, 10, 11, 0).epochSeconds, info.nextRunUtc.epochSeconds);
+
+    // 45 s late is within the threshold, so even the skipping job runs.
+    local.tick(date.fromUtc(2025, 1, 1, 10, 11, 45));
+    TEST_ASSERT_EQUAL(3, hits[0]);
+    TEST_ASSERT_EQUAL(3, hits[1]);
+    TEST_ASSERT_EQUAL(5, hits[2]);
+    TEST_ASSERT_EQUAL(2, hits[3]);
+    local.deinit();
+
+    // A one-shot that is an hour overdue when a worker picks it up is dropped.
+    workerHits = 0;
+    const Schedule stale = Schedule::onceUtc(date.fromUtc(2025, 1, 1, 9, 0, 0));
+    const JobOptions skip = JobOptions{}.withMisfire(SchedulerMisfirePolicy::Skip);
+    ESPScheduler worker(date);
+    worker.setMinValidUnixSeconds(0);
+    TEST_ASSERT_NOT_EQUAL(0u, worker.addJob(stale, skip, SchedulerJobMode::WorkerTask, &workerCallback));
+    ESPSchedulerConfig poolCfg{};
+    poolCfg.workerPoolSize = 1;
+    ESPScheduler pool(date, poolCfg);
+    pool.setMinValidUnixSeconds(0);
+    TEST_ASSERT_NOT_EQUAL(0u, pool.addJob(stale, skip, SchedulerJobMode::WorkerTask, &workerCallback));
+
+    JobInfo remaining{};
+    const unsigned long start = millis();
+    do {
+        delay(10);
+        worker.cleanup();
+        pool.cleanup();
+    } while ((worker.getJobInfo(0, remaining) || pool.getJobInfo(0, remaining)) && millis() - start < 3000);
+    TEST_ASSERT_FALSE(worker.getJobInfo(0, remaining));
+    TEST_ASSERT_FALSE(pool.getJobInfo(0, remaining));
+    TEST_ASSERT_EQUAL(0, workerHits.load());
+}
+
+static void test_catch_up_replays_one_occurrence_per_tick_after_a_clock_jump() {
+    ESPSchedulerConfig cfg{};
+    cfg.clockStepThresholdSeconds = 5;
+    ESPScheduler local(date, cfg);
+    int catchUp = 0;
+    int runOnce = 0;
+    const Schedule hourly = Schedule::custom(ScheduleField::only(0), ScheduleField::any(), ScheduleField::any(),
+                                             ScheduleField::any(), ScheduleField::any());
+    const uint32_t id = local.addJob(hourly, SchedulerJobMode::Inline, [&catchUp] { ++catchUp; });
+    TEST_ASSERT_NOT_EQUAL(0u, id);
+    TEST_ASSERT_NOT_EQUAL(0u, local.addJob(hourly, JobOptions{}.withMisfire(SchedulerMisfirePolicy::RunOnce),
+                                           SchedulerJobMode::Inline, [&runOnce] { ++runOnce; }));
+    local.tick(date.fromUtc(2025, 1, 1, 10, 0, 0));
+    TEST_ASSERT_EQUAL(1, catchUp);
+
+    // SNTP steps the clock 30 days forward: 720 hourly slots are overdue, and each
+    // tick replays exactly one of them.
+    const DateTime later = date.fromUtc(2025, 1, 31, 10, 30, 0);
+    for (int tick = 1; tick <= 5; ++tick) {
+        local.tick(later);
+        TEST_ASSERT_EQUAL(1 + tick, catchUp);
+    }
+    TEST_ASSERT_EQUAL(2, runOnce);
+    JobStats stats{};
+    TEST_ASSERT_TRUE(local.getJobStats(id, stats));
+    TEST_ASSERT_EQUAL_UINT32(0, stats.missedSlots);
+    JobInfo info{};
+    TEST_ASSERT_TRUE(local.getJobInfo(0, info));
+    TEST_ASSERT_EQUAL_INT64(date.fromUtc(2025, 1, 1, 16, 0, 0).epochSeconds, info.nextRunUtc.epochSeconds);
+    local.deinit();
+}
+
+static void test_clock_steps_reschedule_calendar_jobs_in_one_pass() {
+    ESPSchedulerConfig cfg{};
+    cfg.clockStepThresholdSeconds = 5;
+    ESPScheduler local(date, cfg);
+    inlineHits = 0;
+    for (int i = 0; i < 3; ++i) {
+        TEST_ASSERT_NOT_EQUAL(0u, local.addJob(Schedule::dailyAtLocal(9, 0), SchedulerJobMode::Inline, &inlineCallback));
+    }
+    local.tick(date.fromUtc(2025, 1, 1, 10, 0, 0));
+
+    // SNTP corrects a clock that ran seven months fast: deadlines come back to the present.
+    local.tick(date.fromUtc(2024, 6, 1, 8, 0, 0));
+    JobInfo info{};
+    for (size_t i = 0; i < 3; ++i) {
+        TEST_ASSERT_TRUE(local.getJobInfo(i, info));
+        TEST_ASSERT_EQUAL_INT64(date.fromUtc(2024, 6, 1, 9, 0, 0).epochSeconds, info.nextRunUtc.epochSeconds);
+    }
+    local.tick(date.fromUtc(2024, 6, 1, 9, 0, 0));
+    TEST_ASSERT_EQUAL(3, inlineHits);
+
+    // A small step back does not replay the 9:00 runs, and stepping forward again keeps tomorrow's.
+    local.tick(date.fromUtc(2024, 6, 1, 8, 30, 0));
+    local.tick(date.fromUtc(2024, 6, 1, 9, 0, 0));
+    TEST_ASSERT_EQUAL(3, inlineHits);
+    TEST_ASSERT_TRUE(local.getJobInfo(0, info));
+    TEST_ASSERT_EQUAL_INT64(date.fromUtc(2024, 6, 2, 9, 0, 0).epochSeconds, info.nextRunUtc.epochSeconds);
+
+    // A TZ change is picked up without waiting for the old deadline.
+    setenv("TZ", "IST-5:30", 1);
+    tzset();
+    local.tick(date.fromUtc(2024, 6, 1, 9, 0, 0));
+    const bool hasInfo = local.getJobInfo(2, info);
+    setenv("TZ", "UTC", 1);
+    tzset();
+    TEST_ASSERT_TRUE(hasInfo);
+    TEST_ASSERT_EQUAL_INT64(date.fromUtc(2024, 6, 2, 3, 30, 0).epochSeconds, info.nextRunUtc.epochSeconds);
+    local.deinit();
+}
+
+static void test_notify_clock_changed_reschedules_workers() {
+    ESPSchedulerConfig poolCfg{};
+    poolCfg.workerPoolSize = 1;
+    ESPScheduler dedicated(date);
+    ESPScheduler pool(date, poolCfg);
+    dedicated.setMinValidUnixSeconds(0);
+    pool.setMinValidUnixSeconds(0);
+    // Half a day away, so the TZ shift below cannot make it due.
+    const int hour = (date.now().hourUtc() + 12) % 24;
+    dedicated.addJob(Schedule::dailyAtLocal(hour, 0), SchedulerJobMode::WorkerTask, &workerCallback);
+    pool.addJob(Schedule::dailyAtLocal(hour, 0), SchedulerJobMode::WorkerTask, &workerCallback);
+
+    JobInfo before[2]{};
+    unsigned long start = millis();
+    while ((!dedicated.getJobInfo(0, before[0]) || before[0].nextRunUtc.epochSeconds == 0 ||
+            !pool.getJobInfo(0, before[1]) || before[1].nextRunUtc.epochSeconds == 0) &&
+           millis() - start < 2000) {
+        delay(10);
+    }
+
+    setenv("TZ", "IST-5:30", 1);
+    tzset();
+    dedicated.notifyClockChanged();
+    pool.notifyClockChanged();
+    JobInfo after[2]{};
+    start = millis();
+    do {
+        delay(10);
+        dedicated.getJobInfo(0, after[0]);
+        pool.getJobInfo(0, after[1]);
+    } while ((after[0].nextRunUtc.epochSeconds == before[0].nextRunUtc.epochSeconds ||
+              after[1].nextRunUtc.epochSeconds == before[1].nextRunUtc.epochSeconds) &&
+             millis() - start < 2000);
+    dedicated.deinit();
+    pool.deinit();
+    setenv("TZ", "UTC", 1);
+    tzset();
+    TEST_ASSERT_EQUAL_INT64(before[0].nextRunUtc.epochSeconds - 19800, after[0].nextRunUtc.epochSeconds);
+    TEST_ASSERT_EQUAL_INT64(before[1].nextRunUtc.epochSeconds - 19800, after[1].nextRunUtc.epochSeconds);
+}
+
+static void test_pool_reschedules_paused_jobs_on_clock_change() {
+    ESPSchedulerConfig poolCfg{};
+    poolCfg.workerPoolSize = 1;
+    ESPScheduler pool(date, poolCfg);
+    pool.setMinValidUnixSeconds(0);
+    workerHits = 0;
+    const int hour = (date.now().hourUtc() + 12) % 24;
+    const uint32_t id = pool.addJob(Schedule::dailyAtLocal(hour, 0), SchedulerJobMode::WorkerTask, &workerCallback);
+    delay(50);  // let the dispatcher resolve the first deadline before the job leaves its heap
+    TEST_ASSERT_TRUE(pool.pauseJob(id));
+    JobInfo before{};
+    TEST_ASSERT_TRUE(pool.getJobInfo(0, before));
+    unsigned long start = millis();
+
+    // The step lands while the job is off the deadline heap; resuming must not bring back the old deadline.
+    setenv("TZ", "IST-5:30", 1);
+    tzset();
+    pool.notifyClockChanged();
+    JobInfo after{};
+    start = millis();
+    do {
+        delay(10);
+        pool.getJobInfo(0, after);
+    } while (after.nextRunUtc.epochSeconds == before.nextRunUtc.epochSeconds && millis() - start < 2000);
+    TEST_ASSERT_TRUE(pool.resumeJob(id));
+    delay(50);
+    pool.getJobInfo(0, after);
+    pool.deinit();
+    setenv("TZ", "UTC", 1);
+    tzset();
+    TEST_ASSERT_EQUAL_INT64(before.nextRunUtc.epochSeconds - 19800, after.nextRunUtc.epochSeconds);
+    TEST_ASSERT_EQUAL(0, workerHits.load());
+}
+
+// Keeps blobs in memory and counts writes, standing in for NVS or a file system.
+struct MemorySnapshotStore : SchedulerSnapshotStore {
+    std::map<std::string, std::vector<uint8_t>> blobs;
+    int writes = 0;
+
+    bool load(const char* key, uint8_t* out, size_t size) override {
+        const auto it = blobs.find(key);
+        if (it == blobs.end() || it->second.size() != size) {
+            return false;
+        }
+        std::memcpy(out, it->second.data(), size);
+        return true;
+    }
+    bool save(const char* key, const uint8_t* data, size_t size) override {
+        blobs[key].assign(data, data + size);
+        ++writes;
+        return true;
+    }
+    bool erase(const char* key) override {
+        blobs.erase(key);
+        return true;
+    }
+};
+
+static void test_snapshot_restores_jobs_and_writes_only_changes() {
+    MemorySnapshotStore store;
+    const Schedule daily = Schedule::dailyAtLocal(9, 0);
+    const Schedule once = Schedule::onceUtc(date.fromUtc(2025, 1, 1, 10, 0, 0));
+    const Schedule noon = Schedule::dailyAtLocal(12, 0);
+    const JobOptions dailyKey = JobOptions{}.persistAs(1);
+    const JobOptions onceKey = JobOptions{}.persistAs(2);
+    const JobOptions noonKey = JobOptions{}.persistAs(3);
+    inlineHits = 0;
+    {
+        ESPScheduler before(date);
+        TEST_ASSERT_FALSE(before.loadSnapshot(store));
+        TEST_ASSERT_NOT_EQUAL(0u, before.addJob(daily, dailyKey, SchedulerJobMode::Inline, &inlineCallback));
+        TEST_ASSERT_EQUAL(0u, before.addJob(daily, dailyKey, SchedulerJobMode::Inline, &inlineCallback));  // key in use
+        TEST_ASSERT_NOT_EQUAL(0u, before.addJob(once, onceKey, SchedulerJobMode::Inline, &inlineCallback));
+        TEST_ASSERT_TRUE(before.pauseJob(before.addJob(noon, noonKey, SchedulerJobMode::Inline, &inlineCallback)));
+        before.tick(date.fromUtc(2025, 1, 1, 8, 0, 0));
+        before.tick(date.fromUtc(2025, 1, 1, 10, 0, 0));
+        TEST_ASSERT_EQUAL(2, inlineHits);
+
+        TEST_ASSERT_TRUE(before.saveSnapshot(store));
+        TEST_ASSERT_EQUAL(5, store.writes);  // three records, the key list and the header
+        TEST_ASSERT_TRUE(before.saveSnapshot(store));
+        TEST_ASSERT_EQUAL(5, store.writes);
+        before.tick(date.fromUtc(2025, 1, 2, 9, 0, 0));
+        TEST_ASSERT_TRUE(before.saveSnapshot(store));
+        TEST_ASSERT_EQUAL(6, store.writes);  // only the daily job moved on
+    }
+
+    // Reboot: the one-shot already ran, the others resume without a tick.
+    ESPScheduler after(date);
+    TEST_ASSERT_TRUE(after.loadSnapshot(store));
+    TEST_ASSERT_EQUAL(0u, after.addJob(once, onceKey, SchedulerJobMode::Inline, &inlineCallback));
+    const uint32_t dailyId = after.addJob(daily, dailyKey, SchedulerJobMode::Inline, &inlineCallback);
+    TEST_ASSERT_NOT_EQUAL(0u, dailyId);
+    TEST_ASSERT_NOT_EQUAL(0u, after.addJob(noon, noonKey, SchedulerJobMode::Inline, &inlineCallback));
+    JobInfo info{};
+    TEST_ASSERT_TRUE(after.getJobInfo(0, info));
+    TEST_ASSERT_EQUAL_INT64(date.fromUtc(2025, 1, 3, 9, 0, 0).epochSeconds, info.nextRunUtc.epochSeconds);
+    TEST_ASSERT_TRUE(after.getJobInfo(1, info));
+    TEST_ASSERT_FALSE(info.enabled);
+    TEST_ASSERT_TRUE(after.saveSnapshot(store));
+    TEST_ASSERT_EQUAL(6, store.writes);
+
+    // Cancelled recurring jobs leave the snapshot.
+    TEST_ASSERT_TRUE(after.cancelJob(dailyId));
+    TEST_ASSERT_TRUE(after.saveSnapshot(store));
+    TEST_ASSERT_EQUAL(0u, store.blobs.count("sched.00000001"));
+    TEST_ASSERT_EQUAL(4u, store.blobs.size());
+    after.deinit();
+}
+
+// Gives a stored calendar record a deadline, as if its job had been saved before the
+// schedule stopped matching. Layout: flags@4, nextRunUtc@40, CRC-32 of bytes 0..59 @60.
+static void forceSnapshotDeadline(std::vector<uint8_t>& record, int64_t nextRunUtc) {
+    record[4] |= SchedulerSnapshotRecord::kHasNext;
+    for (int i = 0; i < 8; ++i) {
+        record[40 + i] = static_cast<uint8_t>(static_cast<uint64_t>(nextRunUtc) >> (8 * i));
+    }
+    uint32_t crc = 0xFFFFFFFFu;
+    for (int i = 0; i < 60; ++i) {
+        crc ^= record[i];
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+        }
+    }
+    for (int i = 0; i < 4; ++i) {
+        record[60 + i] = static_cast<uint8_t>(~crc >> (8 * i));
+    }
+}
+
+static void test_pool_retires_a_calendar_job_whose_skipped_run_was_its_last() {
+    MemorySnapshotStore store;
+    // February 30th never comes, so once the restored deadline is skipped nothing is left.
+    const Schedule never = Schedule::custom(ScheduleField::only(0), ScheduleField::only(9), ScheduleField::only(30),
+                                            ScheduleField::only(2), ScheduleField::any());
+    const JobOptions skip = JobOptions{}.withMisfire(SchedulerMisfirePolicy::Skip).persistAs(5);
+    ESPSchedulerConfig poolCfg{};
+    poolCfg.workerPoolSize = 1;
+    {
+        ESPScheduler before(date, poolCfg);
+        before.setMinValidUnixSeconds(date.fromUtc(2100, 1, 1, 0, 0, 0).epochSeconds);  // keep the pool idle
+        TEST_ASSERT_NOT_EQUAL(0u, before.addJob(never, skip, SchedulerJobMode::WorkerTask, &workerCallback));
+        TEST_ASSERT_TRUE(before.saveSnapshot(store));
+        before.deinit();
+    }
+    forceSnapshotDeadline(store.blobs["sched.00000005"], date.fromUtc(2025, 1, 1, 9, 0, 0).epochSeconds);
+
+    workerHits = 0;
+    ESPScheduler pool(date, poolCfg);
+    pool.setMinValidUnixSeconds(0);
+    TEST_ASSERT_TRUE(pool.loadSnapshot(store));
+    const uint32_t id = pool.addJob(never, skip, SchedulerJobMode::WorkerTask, &workerCallback);
+    TEST_ASSERT_NOT_EQUAL(0u, id);
+
+    JobInfo remaining{};
+    const unsigned long start = millis();
+    do {
+        delay(10);
+        pool.cleanup();
+    } while (pool.getJobInfo(0, remaining) && millis() - start < 3000);
+    TEST_ASSERT_FALSE(pool.getJobInfo(0, remaining));
+    TEST_ASSERT_EQUAL(0, workerHits.load());
+    pool.deinit();
+}
+
+// Budget tests need every callback to outlast a 1 us budget, however fast the host is.
+static void spinPastBudget() {
+    const int64_t startUs = esp_timer_get_time();
+    while (esp_timer_get_time() - startUs < 2) {
+    }
+}
+
+static void test_budgeted_tick_runs_high_priority_first_and_carries_over() {
+    ESPScheduler local(date);
+    std::vector<int> order;
+    const Schedule nine = Schedule::dailyAtLocal(9, 0);
+    for (int i = 0; i < 4; ++i) {
+        TEST_ASSERT_NOT_EQUAL(0u, local.addJob(nine, JobOptions{}.withPriority(static_cast<uint8_t>(i * 10)),
+                                               SchedulerJobMode::Inline, [&order, i] {
+                                                   order.push_back(i);
+                                                   spinPastBudget();
+                                               }));
+    }
+    local.tick(date.fromUtc(2025, 1, 1, 8, 0, 0));
+
+    // A 1 us budget is spent by the first callback: one job per call, highest priority first.
+    TEST_ASSERT_TRUE(local.tick(date.fromUtc(2025, 1, 1, 9, 0, 0), 1));
+    TEST_ASSERT_TRUE(local.tick(date.fromUtc(2025, 1, 1, 9, 0, 1), 1));
+    TEST_ASSERT_TRUE(local.tick(date.fromUtc(2025, 1, 1, 9, 0, 2), 1));
+    TEST_ASSERT_FALSE(local.tick(date.fromUtc(2025, 1, 1, 9, 0, 3), 1));
+    TEST_ASSERT_EQUAL(4, static_cast<int>(order.size()));
+    for (int i = 0; i < 4; ++i) {
+        TEST_ASSERT_EQUAL(3 - i, order[i]);
+    }
+
+    // A paused job leaves the carried-over work; a generous budget finishes the rest.
+    TEST_ASSERT_TRUE(local.tick(date.fromUtc(2025, 1, 2, 9, 0, 0), 1));
+    JobInfo info{};
+    TEST_ASSERT_TRUE(local.getJobInfo(0, info));
+    TEST_ASSERT_TRUE(local.pauseJob(info.id));
+    TEST_ASSERT_FALSE(local.tick(date.fromUtc(2025, 1, 2, 9, 0, 1), 1000000));
+    TEST_ASSERT_EQUAL(7, static_cast<int>(order.size()));
+    TEST_ASSERT_EQUAL(0, std::count(order.begin() + 4, order.end(), 0));
+    local.deinit();
+}
+
+static void test_budgeted_tick_counts_triggered_runs() {
+    ESPSchedulerConfig cfg{};
+    cfg.commandQueueSize = 8;
+    ESPScheduler local(date, cfg);
+    std::vector<int> order;
+    TEST_ASSERT_NOT_EQUAL(0u, local.addJob(Schedule::dailyAtLocal(9, 0), SchedulerJobMode::Inline,
+                                           [&order] {
+                                               order.push_back(9);
+                                               spinPastBudget();
+                                           }));
+    uint32_t ids[3]{};
+    for (int i = 0; i < 3; ++i) {
+        ids[i] = local.addJob(Schedule::onDemand(), SchedulerJobMode::Inline, [&order, i] {
+            order.push_back(i);
+            spinPastBudget();
+        });
+        TEST_ASSERT_NOT_EQUAL(0u, ids[i]);
+    }
+    local.tick(date.fromUtc(2025, 1, 1, 8, 0, 0));
+    for (uint32_t id : ids) {
+        TEST_ASSERT_TRUE(local.postTrigger(id));
+    }
+
+    // Triggered runs spend the budget like due ones: one callback per call, triggers first.
+    TEST_ASSERT_TRUE(local.tick(date.fromUtc(2025, 1, 1, 9, 0, 0), 1));
+    TEST_ASSERT_EQUAL(1, static_cast<int>(order.size()));
+    TEST_ASSERT_TRUE(local.tick(date.fromUtc(2025, 1, 1, 9, 0, 1), 1));
+    TEST_ASSERT_TRUE(local.tick(date.fromUtc(2025, 1, 1, 9, 0, 2), 1));
+    TEST_ASSERT_FALSE(local.tick(date.fromUtc(2025, 1, 1, 9, 0, 3), 1));
+    TEST_ASSERT_EQUAL(4, static_cast<int>(order.size()));
+    for (int i = 0; i < 3; ++i) {
+        TEST_ASSERT_EQUAL(i, order[i]);
+    }
+    TEST_ASSERT_EQUAL(9, order[3]);
+    local.deinit();
+}
+
+static void test_splay_spreads_runs_deterministically_across_the_window() {
+    const Schedule nine = Schedule::dailyAtLocal(9, 0);
+    const JobOptions none{};
+    TEST_ASSERT_EQUAL_UINT32(none.withSplay(600, 7).splayOffsetFor(nine), none.withSplay(600, 7).splayOffsetFor(nine));
+    TEST_ASSERT_EQUAL_UINT32(0, none.splayOffsetFor(nine));
+    TEST_ASSERT_EQUAL_UINT32(0, none.withSplay(600, 7).splayOffsetFor(Schedule::everyMs(1000)));
+
+    ESPScheduler local(date);
+    inlineHits = 0;
+    uint32_t latest = 0;
+    bool spread = false;
+    for (uint32_t key = 1; key <= 8; ++key) {
+        const JobOptions splayed = none.withSplay(600, key);
+        TEST_ASSERT_TRUE(splayed.splayOffsetFor(nine) < 600);
+        spread = spread || splayed.splayOffsetFor(nine) != none.withSplay(600, 1).splayOffsetFor(nine);
+        latest = std::max(latest, splayed.splayOffsetFor(nine));
+        TEST_ASSERT_NOT_EQUAL(0u, local.addJob(nine, splayed, SchedulerJobMode::Inline, &inlineCallback));
+    }
+    TEST_ASSERT_TRUE(spread);
+    local.tick(date.fromUtc(2025, 1, 1, 8, 0, 0));
+    JobInfo info{};
+    for (size_t i = 0; i < 8; ++i) {
+        TEST_ASSERT_TRUE(local.getJobInfo(i, info));
+        const int64_t nineUtc = date.fromUtc(2025, 1, 1, 9, 0, 0).epochSeconds;
+        TEST_ASSERT_EQUAL_INT64(nineUtc + info.options.splayOffsetFor(info.schedule), info.nextRunUtc.epochSeconds);
+    }
+    local.tick(date.fromUtc(2025, 1, 1, 9, 0, 0));
+    TEST_ASSERT_TRUE(inlineHits < 8);
+    local.tick(date.addSeconds(date.fromUtc(2025, 1, 1, 9, 0, 0), latest));
+    TEST_ASSERT_EQUAL(8, inlineHits);
+    local.deinit();
+
+    // Added after 9:00 but before its splayed run: it still runs today.
+    uint32_t key = 1;
+    while (none.withSplay(600, key).splayOffsetFor(nine) < 120) {
+        ++key;
+    }
+    const JobOptions late = none.withSplay(600, key);
+    ESPScheduler later(date);
+    TEST_ASSERT_NOT_EQUAL(0u, later.addJob(nine, late, SchedulerJobMode::Inline, &inlineCallback));
+    later.tick(date.fromUtc(2025, 1, 1, 9, 1, 0));
+    TEST_ASSERT_TRUE(later.getJobInfo(0, info));
+    TEST_ASSERT_EQUAL_INT64(date.fromUtc(2025, 1, 1, 9, 0, 0).epochSeconds + late.splayOffsetFor(nine),
+                            info.nextRunUtc.epochSeconds);
+    later.deinit();
+}
+
+static void test_identical_schedules_share_occurrences_but_keep_day_semantics() {
+    // Three spellings of 9:00 daily intern together; the two day-15 schedules must not,
+    // because a restricted weekday field ORs with the day of month.
+    const Schedule spellings[] = {
+        Schedule::dailyAtLocal(9, 0),
+        Schedule::cron("0 9 * * *"),
+        Schedule::custom(ScheduleField::only(0), ScheduleField::only(9), ScheduleField::any(),
+                         ScheduleField::range(1, 12), ScheduleField::any()),
+    };
+    const Schedule fifteenth = Schedule::monthlyOnDayLocal(15, 9, 0);
+    const Schedule fifteenthOrAnyWeekday = Schedule::custom(ScheduleField::only(0), ScheduleField::only(9),
+                                                            ScheduleField::only(15), ScheduleField::any(),
+                                                            ScheduleField::range(0, 6));
+
+    ESPScheduler local(date);
+    inlineHits = 0;
+    for (int i = 0; i < 30; ++i) {
+        // Per-job options (priority here) do not split the shared searches.
+        const JobOptions options = JobOptions{}.withPriority(static_cast<uint8_t>(i));
+        TEST_ASSERT_NOT_EQUAL(0u, local.addJob(spellings[i % 3], options, SchedulerJobMode::Inline, &inlineCallback));
+    }
+    TEST_ASSERT_NOT_EQUAL(0u, local.addJob(fifteenth, SchedulerJobMode::Inline, &inlineCallback));
+    TEST_ASSERT_NOT_EQUAL(0u, local.addJob(fifteenthOrAnyWeekday, SchedulerJobMode::Inline, &inlineCallback));
+
+    local.tick(date.fromUtc(2025, 1, 1, 8, 0, 0));
+    local.tick(date.fromUtc(2025, 1, 1, 9, 0, 0));
+    TEST_ASSERT_EQUAL(31, inlineHits);
+    JobInfo info{};
+    for (size_t i = 0; i < 30; ++i) {
+        TEST_ASSERT_TRUE(local.getJobInfo(i, info));
+        TEST_ASSERT_EQUAL_INT64(date.fromUtc(2025, 1, 2, 9, 0, 0).epochSeconds, info.nextRunUtc.epochSeconds);
+    }
+    TEST_ASSERT_TRUE(local.getJobInfo(30, info));
+    TEST_ASSERT_EQUAL_INT64(date.fromUtc(2025, 1, 15, 9, 0, 0).epochSeconds, info.nextRunUtc.epochSeconds);
+    TEST_ASSERT_TRUE(local.getJobInfo(31, info));
+    TEST_ASSERT_EQUAL_INT64(date.fromUtc(2025, 1, 2, 9, 0, 0).epochSeconds, info.nextRunUtc.epochSeconds);
+
+    // Occurrences remembered under the old TZ are not reused after it changes.
+    setenv("TZ", "IST-5:30", 1);
+    tzset();
+    local.tick(date.fromUtc(2025, 1, 2, 9, 0, 0));
+    const int hitsAfterTz = inlineHits;
+    bool allAtLocalNine = true;
+    for (size_t i = 0; i < 30; ++i) {
+        allAtLocalNine = allAtLocalNine && local.getJobInfo(i, info) &&
+                         info.nextRunUtc.epochSeconds == date.fromUtc(2025, 1, 3, 3, 30, 0).epochSeconds;
+    }
+    setenv("TZ", "UTC", 1);
+    tzset();
+    TEST_ASSERT_EQUAL(62, hitsAfterTz);
+    TEST_ASSERT_TRUE(allAtLocalNine);
+    local.deinit();
+}
+
+static void test_interned_schedules_are_recycled_with_their_jobs() {
+    // Two jobs per schedule. Cancelling both frees the entry for the next distinct
+    // schedule, cancelling one must not; twelve distinct ones also grow the table.
+    ESPScheduler local(date);
+    uint32_t ids[24] = {};
+    for (int i = 0; i < 24; ++i) {
+        ids[i] = local.addJob(Schedule::dailyAtLocal(i / 2, 0), SchedulerJobMode::Inline, &inlineCallback);
+        TEST_ASSERT_NOT_EQUAL(0u, ids[i]);
+    }
+    for (int i = 0; i < 13; ++i) {
+        TEST_ASSERT_TRUE(local.cancelJob(ids[i]));
+    }
+    for (int i = 0; i < 12; ++i) {
+        TEST_ASSERT_NOT_EQUAL(0u,
+                              local.addJob(Schedule::dailyAtLocal(12 + i / 2, 30), SchedulerJobMode::Inline,
+                                           &inlineCallback));
+    }
+
+    local.tick(date.fromUtc(2025, 1, 1, 0, 0, 0));
+    const int64_t midnight = date.fromUtc(2025, 1, 1, 0, 0, 0).epochSeconds;
+    JobInfo info{};
+    size_t onTheHour = 0;
+    size_t atHalfPast = 0;
+    for (size_t i = 0; local.getJobInfo(i, info); ++i) {
+        const int hour = __builtin_ctzll(info.schedule.hour.rawMask());
+        const int minute = __builtin_ctzll(info.schedule.minute.rawMask());
+        TEST_ASSERT_TRUE(hour >= 6 && minute == (hour < 12 ? 0 : 30));
+        TEST_ASSERT_EQUAL_INT64(midnight + hour * 3600 + minute * 60, info.nextRunUtc.epochSeconds);
+        ++(minute == 0 ? onTheHour : atHalfPast);
+    }
+    TEST_ASSERT_EQUAL(11, onTheHour);
+    TEST_ASSERT_EQUAL(12, atHalfPast);
+    local.deinit();
+}
+
+static bool countEnabledJob(const JobSummary& job, void* userData) {
+    *static_cast<int*>(userData) += job.enabled ? 1 : 0;
+    return true;
+}
+
+static void test_for_each_job_walks_the_table_once_with_cached_next_runs() {
+    ESPScheduler local(date);
+    const JobOptions keyed = JobOptions{}.persistAs(7);
+    const uint32_t daily = local.addJob(Schedule::dailyAtLocal(9, 0), keyed, SchedulerJobMode::Inline, &inlineCallback);
+    const uint32_t once = local.addJobOnceUtc(date.fromUtc(2025, 3, 1, 0, 0, 0), SchedulerJobMode::Inline, &inlineCallback);
+    const uint32_t interval = local.addJob(Schedule::everyMs(1000), SchedulerJobMode::Inline, &inlineCallback);
+    TEST_ASSERT_TRUE(daily != 0 && once != 0 && interval != 0);
+    TEST_ASSERT_TRUE(local.pauseJob(interval));
+
+    // Before the first tick the daily job has no resolved run, and the walk does not search for one.
+    JobSummary jobs[4]{};
+    TEST_ASSERT_EQUAL(3, local.listJobs(jobs, 4));
+    TEST_ASSERT_FALSE(jobs[0].hasNext);
+    TEST_ASSERT_TRUE(jobs[1].hasNext);
+    TEST_ASSERT_EQUAL_INT64(date.fromUtc(2025, 3, 1, 0, 0, 0).epochSeconds, jobs[1].nextRunUtc.epochSeconds);
+
+    local.tick(date.fromUtc(2025, 1, 1, 8, 0, 0));
+    TEST_ASSERT_EQUAL(3, local.listJobs(jobs, 4));
+    JobInfo info{};
+    for (size_t i = 0; i < 3; ++i) {
+        TEST_ASSERT_TRUE(local.getJobInfo(i, info));
+        TEST_ASSERT_EQUAL_UINT32(info.id, jobs[i].id);
+        TEST_ASSERT_EQUAL(info.enabled, jobs[i].enabled);
+        TEST_ASSERT_TRUE(jobs[i].hasNext);
+    }
+    TEST_ASSERT_EQUAL_UINT32(7, jobs[0].persistKey);
+    TEST_ASSERT_EQUAL_INT64(date.fromUtc(2025, 1, 1, 9, 0, 0).epochSeconds, jobs[0].nextRunUtc.epochSeconds);
+    TEST_ASSERT_FALSE(jobs[2].enabled);
+
+    // A short array and a visitor returning false both stop the walk early.
+    TEST_ASSERT_EQUAL(2, local.listJobs(jobs, 2));
+    size_t seen = 0;
+    TEST_ASSERT_EQUAL(1, local.forEachJob([&seen](const JobSummary&) { return ++seen < 1; }));
+    int enabled = 0;
+    TEST_ASSERT_EQUAL(3, local.forEachJob(&countEnabledJob, &enabled));
+    TEST_ASSERT_EQUAL(2, enabled);
+
+    local.tick(date.fromUtc(2025, 1, 1, 9, 0, 0));
+    TEST_ASSERT_EQUAL(3, local.listJobs(jobs, 4));
+    TEST_ASSERT_EQUAL_INT64(date.fromUtc(2025, 1, 1, 9, 0, 0).epochSeconds, jobs[0].lastRunUtc);
+    local.deinit();
+    TEST_ASSERT_EQUAL(0, local.forEachJob([](const JobSummary&) {}));
+}
+
+static void test_per_core_pool_keeps_pinned_jobs_on_their_core() {
+    ESPSchedulerConfig cfg{};
+    cfg.workerPoolSize = 2;  // one dispatcher per core
+    cfg.workerPoolPerCore = true;
+    ESPScheduler pool(date, cfg);
+    pool.setMinValidUnixSeconds(0);
+
+    static std::atomic<unsigned long> slowEnd{0};
+    static std::atomic<unsigned long> pinnedStart{0};
+    static std::atomic<unsigned long> freeStart{0};
+    slowEnd = 0;
+    pinnedStart = 0;
+    freeStart = 0;
+    SchedulerTaskConfig coreZero{};
+    coreZero.coreId = 0;
+    SchedulerTaskConfig missingCore{};
+    missingCore.coreId = 5;
+    TEST_ASSERT_EQUAL_UINT32(0, pool.addJobOnceUtc(date.now(), SchedulerJobMode::WorkerTask, []() {}, &missingCore));
+
+    // Core 0's only dispatcher is busy with the slow job: the second core-0 job waits
+    // for it, while an unpinned job is picked up by the idle core-1 dispatcher.
+    const DateTime now = date.now();
+    TEST_ASSERT_NOT_EQUAL(0u, pool.addJobOnceUtc(now, SchedulerJobMode::WorkerTask, []() {
+        delay(300);
+        slowEnd = millis();
+    }, &coreZero));
+    delay(100);
+    TEST_ASSERT_NOT_EQUAL(0u, pool.addJobOnceUtc(now, SchedulerJobMode::WorkerTask, []() { pinnedStart = millis(); }, &coreZero));
+    TEST_ASSERT_NOT_EQUAL(0u, pool.addJobOnceUtc(now, SchedulerJobMode::WorkerTask, []() { freeStart = millis(); }));
+
+    const unsigned long start = millis();
+    while (pinnedStart.load() == 0 && millis() - start < 3000) {
+        delay(5);
+    }
+    TEST_ASSERT_NOT_EQUAL(0u, freeStart.load());
+    TEST_ASSERT_NOT_EQUAL(0u, pinnedStart.load());
+    TEST_ASSERT_TRUE(freeStart.load() < slowEnd.load());
+    TEST_ASSERT_TRUE(pinnedStart.load() >= slowEnd.load());
+    pool.deinit();
+}
+
+static void test_completion_triggered_jobs_chain_and_fan_in() {
+    ESPScheduler local(date);
+    std::string order;
+    const uint32_t first = local.addJob(Schedule::dailyAtLocal(9, 0), SchedulerJobMode::Inline, [&order]() { order += '1'; });
+    const uint32_t second = local.addJob(Schedule::dailyAtLocal(10, 0), SchedulerJobMode::Inline, [&order]() { order += '2'; });
+    const uint32_t aggregate =
+        local.addJobAfter({first, second}, SchedulerJobMode::Inline, [&order]() { order += 'A'; });
+    const uint32_t upload = local.addJobAfter({aggregate}, SchedulerJobMode::Inline, [&order]() { order += 'U'; });
+    TEST_ASSERT_TRUE(first != 0 && second != 0 && aggregate != 0 && upload != 0);
+    TEST_ASSERT_EQUAL_UINT32(0, local.addJobAfter({}, SchedulerJobMode::Inline, []() {}));
+    TEST_ASSERT_EQUAL_UINT32(0, local.addJobAfter({first, first}, SchedulerJobMode::Inline, []() {}));
+    TEST_ASSERT_EQUAL_UINT32(0, local.addJobAfter({first, 0x1234u}, SchedulerJobMode::Inline, []() {}));
+
+    // Dependents are ordinary jobs that are never due on their own.
+    JobInfo info{};
+    TEST_ASSERT_TRUE(local.getJobInfo(2, info));
+    TEST_ASSERT_EQUAL_UINT32(aggregate, info.id);
+    TEST_ASSERT_TRUE(info.schedule.isOnDemand);
+    TEST_ASSERT_EQUAL_INT64(0, info.nextRunUtc.epochSeconds);
+
+    // The fan-in waits for both predecessors, then the chain runs out in the same tick.
+    local.tick(date.fromUtc(2025, 1, 1, 9, 0, 0));
+    TEST_ASSERT_TRUE(order == "1");
+    local.tick(date.fromUtc(2025, 1, 1, 10, 0, 0));
+    TEST_ASSERT_TRUE(order == "12AU");
+
+    // A paused dependent skips its turn rather than running late.
+    TEST_ASSERT_TRUE(local.pauseJob(upload));
+    local.tick(date.fromUtc(2025, 1, 2, 9, 0, 0));
+    local.tick(date.fromUtc(2025, 1, 2, 10, 0, 0));
+    TEST_ASSERT_TRUE(local.resumeJob(upload));
+    local.tick(date.fromUtc(2025, 1, 2, 10, 0, 30));
+    TEST_ASSERT_TRUE(order == "12AU12A");
+
+    // A cancelled predecessor no longer holds back the fan-in.
+    TEST_ASSERT_TRUE(local.cancelJob(second));
+    local.tick(date.fromUtc(2025, 1, 3, 9, 0, 0));
+    TEST_ASSERT_TRUE(order == "12AU12A1AU");
+    local.deinit();
+
+    // A worker predecessor wakes the tick loop when it completes.
+    ESPSchedulerConfig cfg{};
+    cfg.commandQueueSize = 4;
+    ESPScheduler mixed(date, cfg);
+    static std::atomic<int> dependentRuns{0};
+    dependentRuns = 0;
+    const uint32_t worker = mixed.addJob(Schedule::onDemand(), SchedulerJobMode::WorkerTask, []() { delay(20); });
+    TEST_ASSERT_NOT_EQUAL(0u, mixed.addJobAfter({worker}, SchedulerJobMode::Inline, []() { dependentRuns++; }));
+    TEST_ASSERT_TRUE(mixed.postTrigger(worker));
+    const unsigned long start = millis();
+    while (dependentRuns.load() == 0 && millis() - start < 2000) {
+        mixed.waitForWork(100);
+        mixed.tick();
+    }
+    TEST_ASSERT_EQUAL(1, dependentRuns.load());
+    mixed.deinit();
+}
+
+static void test_worker_predecessor_cancelled_after_its_run_still_fires_dependent() {
+    // The run completes, then the predecessor is cancelled before any tick() collects it.
+    ESPSchedulerConfig cfg{};
+    cfg.commandQueueSize = 4;
+    ESPScheduler local(date, cfg);
+    static std::atomic<bool> predecessorDone{false};
+    static std::atomic<int> dependentRuns{0};
+    predecessorDone = false;
+    dependentRuns = 0;
+    const uint32_t worker =
+        local.addJob(Schedule::onDemand(), SchedulerJobMode::WorkerTask, []() { predecessorDone = true; });
+    TEST_ASSERT_NOT_EQUAL(0u, local.addJobAfter({worker}, SchedulerJobMode::Inline, []() { dependentRuns++; }));
+    TEST_ASSERT_TRUE(local.postTrigger(worker));
+    local.tick(date.fromUtc(2025, 1, 1, 0, 0, 0));  // hands the trigger to the worker task
+    const unsigned long start = millis();
+    while (!predecessorDone.load() && millis() - start < 2000) {
+        delay(5);
+    }
+    TEST_ASSERT_TRUE(predecessorDone.load());
+    delay(20);  // let the task publish the completed run
+    TEST_ASSERT_TRUE(local.cancelJob(worker));
+    local.tick(date.fromUtc(2025, 1, 1, 0, 0, 1));
+    TEST_ASSERT_EQUAL(1, dependentRuns.load());
+    local.deinit();
+}
+
+static void test_worker_interval_jobs_run_fixed_delay_and_fixed_rate() {
+    ESPSchedulerConfig cfg{};
+    cfg.workerPoolSize = 1;
+    ESPScheduler pooled(date, cfg);
+    ESPScheduler dedicated(date);
+    workerHits = 0;
+
+    // workerCallback takes 50 ms, so fixed-delay 30 ms repeats roughly every 80 ms.
+    uint32_t pooledId = pooled.addJob(
+        Schedule::everyMs(30, SchedulerIntervalMode::FixedDelay), SchedulerJobMode::WorkerTask, &workerCallback, nullptr);
+    uint32_t dedicatedId =
+        dedicated.addJob(Schedule::everyMs(30), SchedulerJobMode::WorkerTask, &workerCallback, nullptr);
+    TEST_ASSERT_NOT_EQUAL(0u, pooledId);
+    TEST_ASSERT_NOT_EQUAL(0u, dedicatedId);
+    TEST_ASSERT_TRUE(waitForWorkerHits(6, 2000));
+
+    TEST_ASSERT_TRUE(pooled.cancelJob(pooledId));
+    TEST_ASSERT_TRUE(dedicated.cancelJob(dedicatedId));
+    delay(100);
+    const int settled = workerHits.load();
+    delay(150);
+    TEST_ASSERT_EQUAL(settled, workerHits.load());
+}
+
 static void test_deinit_is_idempotent_and_safe_when_uninitialized() {
     ESPScheduler localScheduler(date);
     TEST_ASSERT_TRUE(localScheduler.isInitialized());
@@ -178,10 +1734,57 @@ void setup() {
     RUN_TEST(test_weekly_mask_advances_to_next_weekday);
     RUN_TEST(test_weekly_zero_mask_defaults_to_any_day);
     RUN_TEST(test_dom_dow_or_logic_matches_either);
+    RUN_TEST(test_sparse_schedule_skips_to_matching_month);
+    RUN_TEST(test_leap_day_schedule_finds_next_leap_year);
+    RUN_TEST(test_dst_gap_runs_after_transition);
+    RUN_TEST(test_schedule_iterator_matches_repeated_compute);
+    RUN_TEST(test_compute_next_occurrences_fills_batch);
+    RUN_TEST(test_cron_expression_is_parsed_at_compile_time);
+    RUN_TEST(test_cron_runtime_parse_reports_errors_and_rejects_bad_jobs);
+    RUN_TEST(test_tick_reschedules_hourly_job_across_dst_fall_back);
+    RUN_TEST(test_tick_picks_up_timezone_change);
     RUN_TEST(test_inline_tick_runs_and_reschedules);
+    RUN_TEST(test_inline_queue_fires_in_deadline_order_with_pause_and_cancel);
+    RUN_TEST(test_job_still_due_after_its_run_waits_for_the_next_tick);
+    RUN_TEST(test_callback_can_cancel_itself_during_tick);
+    RUN_TEST(test_stale_job_id_is_rejected_after_slot_reuse);
+    RUN_TEST(test_job_ids_address_their_own_job_among_many);
     RUN_TEST(test_get_job_info_reports_next_run);
     RUN_TEST(test_tick_waits_until_clock_valid);
     RUN_TEST(test_psram_buffer_config_constructor_adds_inline_job);
+    RUN_TEST(test_callable_keeps_small_targets_inline);
+    RUN_TEST(test_add_job_accepts_lambdas_member_bindings_and_user_data);
+    RUN_TEST(test_static_scheduler_runs_captures_and_reports_full);
+    RUN_TEST(test_static_scheduler_holds_max_jobs_next_to_the_command_queue);
+#if ESP_SCHEDULER_TEST_COUNTS_ALLOCATIONS
+    RUN_TEST(test_static_scheduler_does_not_allocate_after_construction);
+#endif
+    RUN_TEST(test_posted_commands_apply_on_next_tick_in_order);
+    RUN_TEST(test_jobs_posted_from_other_tasks_are_applied_by_tick);
+    RUN_TEST(test_trigger_from_isr_runs_job_early_without_moving_schedule);
+    RUN_TEST(test_isr_submission_wakes_tick_task_and_worker);
+    RUN_TEST(test_trace_records_job_lifecycle_and_dispatch);
+    RUN_TEST(test_worker_pool_runs_jobs_on_shared_dispatchers);
+    RUN_TEST(test_worker_task_wakes_on_resume_and_clock_guard_change);
+    RUN_TEST(test_inline_interval_job_runs_on_monotonic_clock);
+    RUN_TEST(test_worker_interval_jobs_run_fixed_delay_and_fixed_rate);
+    RUN_TEST(test_job_stats_track_runs_lateness_and_overruns);
+    RUN_TEST(test_misfire_policies_bound_catch_up_after_a_stall);
+    RUN_TEST(test_catch_up_replays_one_occurrence_per_tick_after_a_clock_jump);
+    RUN_TEST(test_clock_steps_reschedule_calendar_jobs_in_one_pass);
+    RUN_TEST(test_notify_clock_changed_reschedules_workers);
+    RUN_TEST(test_pool_reschedules_paused_jobs_on_clock_change);
+    RUN_TEST(test_snapshot_restores_jobs_and_writes_only_changes);
+    RUN_TEST(test_pool_retires_a_calendar_job_whose_skipped_run_was_its_last);
+    RUN_TEST(test_budgeted_tick_runs_high_priority_first_and_carries_over);
+    RUN_TEST(test_budgeted_tick_counts_triggered_runs);
+    RUN_TEST(test_splay_spreads_runs_deterministically_across_the_window);
+    RUN_TEST(test_identical_schedules_share_occurrences_but_keep_day_semantics);
+    RUN_TEST(test_interned_schedules_are_recycled_with_their_jobs);
+    RUN_TEST(test_for_each_job_walks_the_table_once_with_cached_next_runs);
+    RUN_TEST(test_per_core_pool_keeps_pinned_jobs_on_their_core);
+    RUN_TEST(test_completion_triggered_jobs_chain_and_fan_in);
+    RUN_TEST(test_worker_predecessor_cancelled_after_its_run_still_fires_dependent);
     RUN_TEST(test_deinit_is_idempotent_and_safe_when_uninitialized);
     RUN_TEST(test_scheduler_reinitializes_after_deinit);
     UNITY_END();
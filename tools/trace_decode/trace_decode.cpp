@@ -0,0 +1,183 @@
+// Turns bytes written by ESPScheduler::drainTrace(sink) into a readable timeline:
+//   trace_decode capture.bin          (or pipe a capture in: trace_decode < capture.bin)
+// The input may start mid-record and may contain several drains back to back;
+// decoding starts at the first Sync record and resynchronises after garbage.
+// Build it with the host CMake project (target esp_scheduler_trace_decode).
+#include <esp_scheduler/scheduler_trace.h>
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <vector>
+
+namespace {
+
+constexpr uint8_t kLastEvent = static_cast<uint8_t>(SchedulerTraceEvent::ClockStepped);
+
+const char* eventName(uint8_t event) {
+    static const char* const kNames[] = {"sync",
+                                         "added",
+                                         "cancelled",
+                                         "paused",
+                                         "resumed",
+                                         "triggered",
+                                         "dispatch",
+                                         "rescheduled",
+                                         "clock-invalid",
+                                         "worker-created",
+                                         "worker-exited",
+                                         "clock-stepped"};
+    return event <= kLastEvent ? kNames[event] : "unknown";
+}
+
+const char* runnerName(uint8_t detail) {
+    switch (detail & 0x7F) {
+        case static_cast<uint8_t>(SchedulerTraceRunner::Inline):
+            return "inline";
+        case static_cast<uint8_t>(SchedulerTraceRunner::Worker):
+            return "worker";
+        case static_cast<uint8_t>(SchedulerTraceRunner::Pool):
+            return "pool";
+        default:
+            return "?";
+    }
+}
+
+SchedulerTraceRecord readRecord(const uint8_t* bytes) {
+    SchedulerTraceRecord record{};
+    std::memcpy(&record, bytes, sizeof(record));  // host and ESP32 are both little-endian
+    return record;
+}
+
+bool isSync(const uint8_t* bytes) {
+    const SchedulerTraceRecord record = readRecord(bytes);
+    return record.event == static_cast<uint8_t>(SchedulerTraceEvent::Sync) &&
+           record.jobId == kSchedulerTraceSyncMagic;
+}
+
+void printWallClock(int64_t micros) {
+    const time_t seconds = static_cast<time_t>(micros >= 0 ? micros / 1000000 : (micros - 999999) / 1000000);
+    const int64_t fraction = micros - static_cast<int64_t>(seconds) * 1000000;
+    std::tm tm{};
+    gmtime_r(&seconds, &tm);
+    char text[32];
+    std::strftime(text, sizeof(text), "%Y-%m-%dT%H:%M:%S", &tm);
+    std::printf("%s.%06" PRId64 "Z", text, fraction);
+}
+
+void printDetail(const SchedulerTraceRecord& record) {
+    const auto event = static_cast<SchedulerTraceEvent>(record.event);
+    switch (event) {
+        case SchedulerTraceEvent::JobAdded:
+            std::printf(" %s", record.detail == 0 ? "inline" : "worker");
+            if (record.value > 0) {
+                std::printf(" every %" PRId32 " ms", record.value);
+            }
+            break;
+        case SchedulerTraceEvent::Dispatch:
+            std::printf(" %s%s late %+.6f s",
+                        runnerName(record.detail),
+                        (record.detail & static_cast<uint8_t>(SchedulerTraceRunner::Triggered)) ? " (triggered)" : "",
+                        record.value / 1e6);
+            break;
+        case SchedulerTraceEvent::Rescheduled:
+            if (record.detail == static_cast<uint8_t>(SchedulerTraceReschedule::Done)) {
+                std::printf(" no further runs");
+            } else if (record.detail == static_cast<uint8_t>(SchedulerTraceReschedule::Seconds)) {
+                std::printf(" next in %" PRId32 " s", record.value);
+            } else {
+                std::printf(" next in %.3f ms", record.value / 1e3);
+            }
+            break;
+        case SchedulerTraceEvent::ClockInvalid:
+            std::printf(" %s saw epoch %" PRId32, runnerName(record.detail), record.value);
+            break;
+        case SchedulerTraceEvent::WorkerCreated:
+            std::printf(" %s stack %" PRId32, record.detail ? "pool dispatcher" : "dedicated", record.value);
+            break;
+        case SchedulerTraceEvent::ClockStepped:
+            std::printf(" %s rescheduled after %+" PRId32 " s", runnerName(record.detail), record.value);
+            break;
+        case SchedulerTraceEvent::WorkerExited:
+            std::printf(" %s", record.detail ? "pool dispatcher" : "dedicated");
+            break;
+        default:
+            break;
+    }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    FILE* in = stdin;
+    if (argc > 1) {
+        in = std::fopen(argv[1], "rb");
+        if (!in) {
+            std::fprintf(stderr, "trace_decode: cannot open %s\n", argv[1]);
+            return 1;
+        }
+    }
+    std::vector<uint8_t> bytes;
+    uint8_t buffer[4096];
+    size_t got = 0;
+    while ((got = std::fread(buffer, 1, sizeof(buffer), in)) > 0) {
+        bytes.insert(bytes.end(), buffer, buffer + got);
+    }
+    if (in != stdin) {
+        std::fclose(in);
+    }
+
+    const size_t recordSize = sizeof(SchedulerTraceRecord);
+    bool synced = false;
+    uint32_t syncTimeUs = 0;
+    int64_t syncWallUs = 0;
+    bool haveSequence = false;
+    uint16_t lastSequence = 0;
+    size_t records = 0;
+    size_t dropped = 0;
+    size_t pos = 0;
+    while (pos + recordSize <= bytes.size()) {
+        if (isSync(&bytes[pos])) {
+            const SchedulerTraceRecord sync = readRecord(&bytes[pos]);
+            syncTimeUs = sync.timeUs;
+            syncWallUs = static_cast<int64_t>(static_cast<uint32_t>(sync.value)) * 1000000;
+            synced = true;
+            pos += recordSize;
+            continue;
+        }
+        const SchedulerTraceRecord record = readRecord(&bytes[pos]);
+        if (!synced || record.event > kLastEvent) {
+            synced = false;
+            ++pos;  // scan byte by byte for the next Sync record
+            continue;
+        }
+        // Tasks racing to record may land one or two places out of order; only a
+        // forward jump means the ring was full.
+        const int16_t gap = static_cast<int16_t>(record.sequence - lastSequence - 1);
+        if (haveSequence && gap > 0) {
+            std::printf("-- %d record(s) dropped --\n", gap);
+            dropped += static_cast<size_t>(gap);
+        }
+        if (!haveSequence || gap >= 0) {
+            lastSequence = record.sequence;
+        }
+        haveSequence = true;
+
+        // The Sync heading a drain is stamped when the drain starts, so records lie up
+        // to one timeUs wrap (~71.6 min) before it; a record that raced the drain may
+        // be a little after it.
+        const int32_t aheadUs = static_cast<int32_t>(record.timeUs - syncTimeUs);
+        const int64_t offsetUs = (aheadUs >= 0 && aheadUs < 1000000)
+                                     ? aheadUs
+                                     : -static_cast<int64_t>(static_cast<uint32_t>(syncTimeUs - record.timeUs));
+        printWallClock(syncWallUs + offsetUs);
+        std::printf("  #%-5u job=0x%08" PRIx32 "  %s", record.sequence, record.jobId, eventName(record.event));
+        printDetail(record);
+        std::printf("\n");
+        ++records;
+        pos += recordSize;
+    }
+    std::fprintf(stderr, "trace_decode: %zu records, %zu dropped\n", records, dropped);
+    return 0;
+}